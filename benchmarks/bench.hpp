@@ -0,0 +1,190 @@
+/***************************************************************************
+ *            bench.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file bench.hpp
+ *  \brief Minimal measurement harness shared by the benchmarks.
+ */
+
+#ifndef ARIADNE_BENCHMARKS_BENCH_HPP
+#define ARIADNE_BENCHMARKS_BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Ariadne::Bench {
+
+/**
+ * \brief Make a value observable, so that the computation of it is not 
+ * optimized out.
+ * \param value
+ */
+template <typename T>
+inline void keep(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * \brief Measure of a benchmark case.
+ */
+struct Result
+{
+    std::string name;   ///< Kernel or workload.
+    std::string type;   ///< Scalar type or variant.
+    std::string size;   ///< Problem size.
+    double ns_per_op;   ///< Median time of one call.
+    double gflops;      ///< Floating point operations per second, 1e9.
+    double gbps;        ///< Compulsory memory traffic per second, 1e9 B.
+};
+
+/**
+ * \brief Run benchmark cases and report them as a table or as JSON.
+ *
+ * Each case is called until a batch lasts at least a fifth of the minimum 
+ * time, then SAMPLES batches are timed and the median is reported, which 
+ * is robust to the occasional preemption.
+ */
+class Runner
+{
+public:
+    static constexpr size_t SAMPLES = 5;
+
+    /**
+     * \brief Construct a new Runner object.
+     * \param min_time Minimum time spent on each case.
+     * \param filter   Only the cases whose name contains it run.
+     */
+    explicit Runner(std::chrono::nanoseconds min_time = 
+        std::chrono::milliseconds{100}, std::string filter = "")
+        : _min_time{min_time}
+        , _filter{std::move(filter)}
+    {}
+
+    /**
+     * \brief Measure a case.
+     * \param name  Kernel or workload.
+     * \param type  Scalar type or variant.
+     * \param size  Problem size.
+     * \param flops Floating point operations of one call.
+     * \param bytes Bytes read and written by one call.
+     * \param body  Function running one call.
+     */
+    template <typename F>
+    void run(std::string const& name, std::string const& type, 
+        std::string const& size, double flops, double bytes, F&& body)
+    {
+        if (!_filter.empty() && name.find(_filter) == std::string::npos)
+        {
+            return;
+        }
+
+        using Clock = std::chrono::steady_clock;
+        body();
+        size_t iterations = 1;
+        for (;;)
+        {
+            auto start = Clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                body();
+            }
+            if (Clock::now() - start >= _min_time / SAMPLES)
+            {
+                break;
+            }
+            iterations *= 2;
+        }
+
+        std::vector<double> samples;
+        for (size_t s = 0; s < SAMPLES; ++s)
+        {
+            auto start = Clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                body();
+            }
+            std::chrono::duration<double, std::nano> elapsed = 
+                Clock::now() - start;
+            samples.push_back(elapsed.count() 
+                / static_cast<double>(iterations));
+        }
+        std::sort(samples.begin(), samples.end());
+        double ns = samples[SAMPLES / 2];
+        _results.push_back({name, type, size, ns, flops / ns, bytes / ns});
+    }
+
+    [[nodiscard]] std::vector<Result> const& results() const noexcept 
+    { 
+        return _results; 
+    }
+
+    /**
+     * \brief Print the results as an aligned table.
+     * \param out
+     */
+    void print_table(std::FILE* out = stdout) const
+    {
+        std::fprintf(out, "%-24s %-8s %-12s %14s %10s %10s\n", "name", 
+            "type", "size", "ns/op", "GFLOP/s", "GB/s");
+        for (auto& r: _results)
+        {
+            std::fprintf(out, "%-24s %-8s %-12s %14.1f %10.3f %10.3f\n", 
+                r.name.c_str(), r.type.c_str(), r.size.c_str(), r.ns_per_op, 
+                r.gflops, r.gbps);
+        }
+    }
+
+    /**
+     * \brief Print the results as a JSON object with a "benchmarks" array.
+     * \param out
+     */
+    void print_json(std::FILE* out = stdout) const
+    {
+        std::fprintf(out, "{\n  \"benchmarks\": [");
+        for (size_t i = 0; i < _results.size(); ++i)
+        {
+            auto& r = _results[i];
+            std::fprintf(out, "%s\n    {\"name\": \"%s\", \"type\": \"%s\", "
+                "\"size\": \"%s\", \"ns_per_op\": %.3f, \"gflops\": %.6f, "
+                "\"gbps\": %.6f}", i > 0 ? "," : "", r.name.c_str(), 
+                r.type.c_str(), r.size.c_str(), r.ns_per_op, r.gflops, 
+                r.gbps);
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+    }
+
+private:
+    std::chrono::nanoseconds _min_time;
+    std::string _filter;
+    std::vector<Result> _results;
+};
+
+} // namespace Ariadne::Bench
+
+#endif // ARIADNE_BENCHMARKS_BENCH_HPP
@@ -0,0 +1,282 @@
+/***************************************************************************
+ *            bench_csv.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file bench_csv.cpp
+ *  \brief Throughput of the CSV parser on synthetic files.
+ *
+ *  Files are generated deterministically for each workload: narrow (4 
+ *  columns) or wide (64 columns), numeric-only or mixed with booleans and 
+ *  strings, quoted or unquoted fields. Sizes start at 1 MB and grow by 8x 
+ *  up to max_mb, 8 by default; pass some thousands for multi-GB files. 
+ *  For each file it measures, in MB/s of the file:
+ *  - construct: CSV constructor, which counts rows and infers types;
+ *  - scan:      sequential read of the rows with CSVIterator;
+ *  - random:    CSV::operator[] on random rows, counting the bytes skipped
+ *               to reach the row, since the access reads the file from the
+ *               beginning;
+ *  - convert:   sequential read with conversion of every field to its type.
+ *
+ *  Usage: ariadnedl-bench-csv [max_mb] [directory]
+ */
+
+#include "bench.hpp"
+#include "parser/csv.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Ariadne;
+using namespace Ariadne::Bench;
+
+namespace {
+
+using Clock    = std::chrono::steady_clock;
+using Duration = std::chrono::duration<double>;
+
+constexpr size_t NARROW_COLS     = 4;
+constexpr size_t WIDE_COLS       = 64;
+constexpr size_t SIZE_STEP       = 8;
+constexpr size_t RANDOM_ACCESSES = 8;
+constexpr double MB              = 1024.0 * 1024.0;
+constexpr std::mt19937_64::result_type SEED = 1;
+
+/**
+ * \brief Shape and content of a synthetic file.
+ */
+struct Workload
+{
+    char const* name;
+    size_t cols;
+    bool mixed;   ///< Columns cycle float, int, bool and string.
+    bool quoted;  ///< Every field is enclosed in double quotes.
+};
+
+constexpr Workload WORKLOADS[] = {
+    {"narrow-numeric",        NARROW_COLS, false, false},
+    {"narrow-numeric-quoted", NARROW_COLS, false, true},
+    {"narrow-mixed",          NARROW_COLS, true,  false},
+    {"narrow-mixed-quoted",   NARROW_COLS, true,  true},
+    {"wide-numeric",          WIDE_COLS,   false, false},
+    {"wide-numeric-quoted",   WIDE_COLS,   false, true},
+    {"wide-mixed",            WIDE_COLS,   true,  false},
+    {"wide-mixed-quoted",     WIDE_COLS,   true,  true},
+};
+
+/**
+ * \brief Write a file of the workload of at least the given size.
+ * \return size_t Amount of data rows written.
+ */
+size_t generate(std::filesystem::path const& path, Workload const& w, 
+    size_t bytes)
+{
+    std::mt19937_64 rne{SEED};
+    std::uniform_real_distribution<double> real{-1000.0, 1000.0};
+    std::uniform_int_distribution<int> integer{-100000, 100000};
+    std::uniform_int_distribution<int> letter{'a', 'z'};
+
+    std::ofstream out{path, std::ios::binary};
+    if (!out)
+    {
+        throw std::runtime_error("could not create " + path.string());
+    }
+
+    std::string line;
+    for (size_t c = 0; c < w.cols; ++c)
+    {
+        line += (c > 0 ? ",c" : "c") + std::to_string(c);
+    }
+    line += '\n';
+    out << line;
+    size_t written = line.size();
+
+    size_t rows = 0;
+    char field[32];
+    while (written < bytes)
+    {
+        line.clear();
+        for (size_t c = 0; c < w.cols; ++c)
+        {
+            size_t kind = w.mixed ? c % 4 : c % 2;
+            if (kind == 0)
+            {
+                std::snprintf(field, sizeof(field), "%.6f", real(rne));
+            }
+            else if (kind == 1)
+            {
+                std::snprintf(field, sizeof(field), "%d", integer(rne));
+            }
+            else if (kind == 2)
+            {
+                std::snprintf(field, sizeof(field), "%s", 
+                    rne() % 2 ? "true" : "false");
+            }
+            else
+            {
+                size_t n = 0;
+                for (; n < 8; ++n)
+                {
+                    field[n] = static_cast<char>(letter(rne));
+                }
+                field[n] = '\0';
+            }
+
+            if (c > 0)
+            {
+                line += ',';
+            }
+            if (w.quoted)
+            {
+                line += '"';
+                line += field;
+                line += '"';
+            }
+            else
+            {
+                line += field;
+            }
+        }
+        line += '\n';
+        out << line;
+        written += line.size();
+        ++rows;
+    }
+    return rows;
+}
+
+/**
+ * \brief Convert every field of a row to the type inferred for its column.
+ * \param row
+ * \param types Column types, as inferred by the constructor of CSV.
+ */
+void convert_row(CSVRow& row, std::vector<ParserType> const& types)
+{
+    for (size_t i = 0; i < row.size(); ++i)
+    {
+        CSVField field = row[i];
+        if (types[i] == ParserType::FLOAT)
+        {
+            double value = 0;
+            field.as(&value);
+            keep(value);
+        }
+        else if (types[i] == ParserType::INT)
+        {
+            long value = 0;
+            field.as(&value);
+            keep(value);
+        }
+        else if (types[i] == ParserType::BOOL)
+        {
+            bool value = false;
+            field.as(&value);
+            keep(value);
+        }
+        else
+        {
+            keep(field.idx());
+        }
+    }
+}
+
+void report(Workload const& w, size_t mb, char const* phase, double bytes, 
+    Duration elapsed)
+{
+    std::printf("%-22s %8zu %-10s %12.3f %12.1f\n", w.name, mb, phase, 
+        elapsed.count(), bytes / MB / elapsed.count());
+}
+
+void run(Workload const& w, size_t mb, std::filesystem::path const& dir)
+{
+    auto path = dir / (std::string{"ariadnedl-bench-"} + w.name + "-" 
+        + std::to_string(mb) + "mb.csv");
+    size_t rows = generate(path, w, mb * static_cast<size_t>(MB));
+    double const bytes = static_cast<double>(std::filesystem::file_size(path));
+
+    auto start = Clock::now();
+    CSV csv{path.string()};
+    report(w, mb, "construct", bytes, Clock::now() - start);
+
+    // Rows built by the iterators reset the types shared with the CSV.
+    std::vector<ParserType> types = csv.types();
+
+    start = Clock::now();
+    for (auto it = csv.begin(); it != csv.end(); ++it)
+    {
+        keep(it->size());
+    }
+    report(w, mb, "scan", bytes, Clock::now() - start);
+
+    // Access rows past the cached first one, the offset is estimated from 
+    // the average row length.
+    std::mt19937_64 rne{SEED};
+    std::uniform_int_distribution<size_t> index{2, rows};
+    double skipped = 0.0;
+    start = Clock::now();
+    for (size_t a = 0; a < RANDOM_ACCESSES; ++a)
+    {
+        size_t i = index(rne);
+        keep(csv[i].size());
+        skipped += bytes * static_cast<double>(i) 
+            / static_cast<double>(rows + 1);
+    }
+    report(w, mb, "random", skipped, Clock::now() - start);
+
+    start = Clock::now();
+    for (auto it = csv.begin(); it != csv.end(); ++it)
+    {
+        convert_row(*it, types);
+    }
+    report(w, mb, "convert", bytes, Clock::now() - start);
+
+    std::filesystem::remove(path);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t max_mb = argc > 1 ? std::stoul(argv[1]) : 8;
+    std::filesystem::path dir = argc > 2 
+        ? std::filesystem::path{argv[2]} 
+        : std::filesystem::temp_directory_path();
+
+    std::printf("%-22s %8s %-10s %12s %12s\n", "workload", "size_mb", 
+        "phase", "seconds", "MB/s");
+    for (auto const& w: WORKLOADS)
+    {
+        for (size_t mb = 1; mb <= max_mb; mb *= SIZE_STEP)
+        {
+            run(w, mb, dir);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+/***************************************************************************
+ *            bench_hogwild.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*! \file bench_hogwild.cpp
+ *  \brief Convergence and throughput of Hogwild against synchronous
+ *  data-parallel training.
+ *
+ *  Usage: ariadnedl-bench-hogwild [epochs] [max_threads]
+ */
+
+#include "dnn/dense.hpp"
+#include "dnn/gd_optimizer.hpp"
+#include "dnn/model.hpp"
+#include "dnn/mse_loss.hpp"
+#include "dnn/parallel_trainer.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Ariadne;
+
+namespace {
+
+constexpr size_t INPUT_SIZE   = 16;
+constexpr size_t HIDDEN_SIZE  = 32;
+constexpr size_t ACTIVE_SIZE  = 3;
+constexpr size_t SAMPLES      = 8192;
+constexpr size_t BATCH_SIZE   = 16;
+constexpr NumType ETA         = 0.01;
+constexpr RneType::result_type SEED = 1;
+
+/**
+ * \brief Sparse synthetic regression: each sample has ACTIVE_SIZE non-zero
+ * features and the target is a fixed linear combination of them.
+ */
+void make_dataset(std::vector<std::vector<NumType>>& inputs,
+    std::vector<std::vector<NumType>>& targets)
+{
+    RneType rne{SEED};
+    std::vector<NumType> coefficients(INPUT_SIZE);
+    for (size_t i = 0; i < INPUT_SIZE; ++i)
+    {
+        coefficients[i] = static_cast<NumType>(rne() % 200) / 100.0 - 1.0;
+    }
+
+    for (size_t s = 0; s < SAMPLES; ++s)
+    {
+        std::vector<NumType> x(INPUT_SIZE, NumType{0.0});
+        NumType y{0.0};
+        for (size_t a = 0; a < ACTIVE_SIZE; ++a)
+        {
+            size_t feature = rne() % INPUT_SIZE;
+            x[feature] = static_cast<NumType>(rne() % 100) / 100.0;
+            y += coefficients[feature] * x[feature];
+        }
+        inputs.push_back(std::move(x));
+        targets.push_back({y});
+    }
+}
+
+void run(ParallelMode mode, size_t threads, size_t epochs,
+    std::vector<std::vector<NumType>> const& inputs,
+    std::vector<std::vector<NumType>> const& targets)
+{
+    Model m{"estimator"};
+    auto& hidden = m.add_node<DenseLayer>("hidden", Activation::ReLU,
+        HIDDEN_SIZE, INPUT_SIZE);
+    auto& output = m.add_node<DenseLayer>("output", Activation::Linear,
+        1, HIDDEN_SIZE);
+    auto& loss = m.add_node<MSELossLayer>("loss", 1, BATCH_SIZE);
+    m.create_edge(output, hidden);
+    m.create_edge(loss, output);
+    m.init(SEED);
+
+    GDOptimizer o{ETA};
+    ParallelTrainer t{m, loss, o, inputs, targets, BATCH_SIZE,
+        threads, mode};
+
+    char const* name = mode == ParallelMode::Hogwild ? "hogwild" : "sync";
+    std::chrono::duration<double> elapsed{0};
+    for (size_t e = 0; e < epochs; ++e)
+    {
+        auto start = std::chrono::steady_clock::now();
+        t.run_epoch();
+        elapsed += std::chrono::steady_clock::now() - start;
+        std::printf("%-8s threads=%zu epoch=%zu loss=%.6f\n", name, threads,
+            e, t.avg_loss());
+    }
+
+    double samples_per_sec =
+        static_cast<double>(epochs * inputs.size()) / elapsed.count();
+    std::printf("%-8s threads=%zu samples/s=%.0f final_loss=%.6f\n\n", name,
+        threads, samples_per_sec, t.avg_loss());
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t epochs      = argc > 1 ? std::stoul(argv[1]) : 10;
+    size_t max_threads = argc > 2 ? std::stoul(argv[2]) : 4;
+
+    std::vector<std::vector<NumType>> inputs;
+    std::vector<std::vector<NumType>> targets;
+    make_dataset(inputs, targets);
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        run(ParallelMode::Synchronous, threads, epochs, inputs, targets);
+        run(ParallelMode::Hogwild, threads, epochs, inputs, targets);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+/***************************************************************************
+ *            bench_kernels.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file bench_kernels.cpp
+ *  \brief Micro-benchmarks of the DLMath kernels across sizes and scalar 
+ *  types.
+ *
+ *  Usage: ariadnedl-bench [--json] [--filter name] [--min-time ms]
+ *
+ *  Operations count multiplications, additions, comparisons and 
+ *  transcendental functions as one each; bytes count the compulsory 
+ *  traffic, every operand read and every result written once.
+ */
+
+#include "bench.hpp"
+#include "dnn/dlmath.hpp"
+#include "dnn/thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Ariadne;
+using namespace Ariadne::Bench;
+
+namespace {
+
+constexpr size_t VECTOR_SIZES[] = {64, 1024, 16384, 262144};
+constexpr size_t SOFTMAX_1_SIZES[] = {16, 64, 256, 1024};
+constexpr size_t MATRIX_SIZES[] = {16, 64, 256, 1024};
+constexpr size_t INPUT_GRADIENT_SIZES[] = {512, 1024, 2048, 4096};
+
+template <typename T>
+std::vector<T> random_vector(size_t length, T low, T high)
+{
+    static std::mt19937_64 rne{1};
+    std::uniform_real_distribution<T> dist{low, high};
+    std::vector<T> v(length);
+    for (auto& x: v)
+    {
+        x = dist(rne);
+    }
+    return v;
+}
+
+template <typename T>
+void run_vector_kernels(Runner& r, char const* type, size_t n)
+{
+    auto a = random_vector<T>(n, T{-1}, T{1});
+    auto b = random_vector<T>(n, T{0.01}, T{1});
+    std::vector<T> dst(n);
+    double const s = sizeof(T);
+    double const len = static_cast<double>(n);
+    std::string size = std::to_string(n);
+
+    r.run("arr_sum", type, size, len, 3 * len * s, [&]()
+    {
+        keep(DLMath::arr_sum(dst.data(), a.data(), b.data(), n));
+    });
+    r.run("arr_mul", type, size, len, 3 * len * s, [&]()
+    {
+        keep(DLMath::arr_mul(dst.data(), a.data(), b.data(), n));
+    });
+    r.run("relu", type, size, len, 2 * len * s, [&]()
+    {
+        keep(DLMath::relu(dst.data(), a.data(), n));
+    });
+    r.run("relu_1", type, size, len, 2 * len * s, [&]()
+    {
+        keep(DLMath::relu_1(dst.data(), a.data(), n));
+    });
+    // exp and accumulation, then the normalization.
+    r.run("softmax", type, size, 3 * len, 2 * len * s, [&]()
+    {
+        keep(DLMath::softmax(dst.data(), a.data(), n));
+    });
+    // log, multiplication and accumulation.
+    r.run("cross_entropy", type, size, 3 * len, 2 * len * s, [&]()
+    {
+        keep(DLMath::cross_entropy(a.data(), b.data(), n));
+    });
+    // max, division and two multiplications.
+    r.run("cross_entropy_1", type, size, 4 * len, 3 * len * s, [&]()
+    {
+        keep(DLMath::cross_entropy_1(dst.data(), a.data(), b.data(), 
+            T{0.5}, n));
+    });
+    r.run("mean_squared_error", type, size, 3 * len, 2 * len * s, [&]()
+    {
+        keep(DLMath::mean_squared_error(a.data(), b.data(), n));
+    });
+    r.run("mean_squared_error_1", type, size, 3 * len, 3 * len * s, [&]()
+    {
+        keep(DLMath::mean_squared_error_1(dst.data(), a.data(), b.data(), 
+            T{0.5}, n));
+    });
+    r.run("max_and_argmax", type, size, len, len * s, [&]()
+    {
+        keep(DLMath::max_and_argmax(a.data(), n));
+    });
+}
+
+template <typename T>
+void run_softmax_1(Runner& r, char const* type, size_t n)
+{
+    auto a = random_vector<T>(n, T{0.01}, T{1});
+    std::vector<T> dst(n);
+    double const s = sizeof(T);
+    double const len = static_cast<double>(n);
+    std::string size = std::to_string(n);
+
+    // n x n terms of one multiplication and one accumulation.
+    r.run("softmax_1_opt", type, size, 2 * len * len, 2 * len * s, [&]()
+    {
+        keep(DLMath::softmax_1_opt(dst.data(), a.data(), n));
+    });
+    r.run("softmax_1", type, size, (2 * len * len) + (3 * len), 
+        2 * len * s, [&]()
+    {
+        keep(DLMath::softmax_1(dst.data(), a.data(), n));
+    });
+}
+
+template <typename T>
+void run_matrix_kernels(Runner& r, char const* type, size_t n)
+{
+    auto mat = random_vector<T>(n * n, T{-1}, T{1});
+    auto x = random_vector<T>(n, T{-1}, T{1});
+    auto y = random_vector<T>(n, T{-1}, T{1});
+    std::vector<T> dst(n);
+    double const s = sizeof(T);
+    double const len = static_cast<double>(n);
+    std::string size = std::to_string(n) + "x" + std::to_string(n);
+
+    r.run("matarr_mul", type, size, 2 * len * len, 
+        ((len * len) + (2 * len)) * s, [&]()
+    {
+        keep(DLMath::matarr_mul(dst.data(), mat.data(), x.data(), n, n));
+    });
+    r.run("outer_sum", type, size, 2 * len * len, 
+        ((2 * len * len) + (2 * len)) * s, [&]()
+    {
+        keep(DLMath::outer_sum(mat.data(), x.data(), y.data(), n, n));
+    });
+}
+
+/**
+ * \brief Input gradient of a dense layer, dJ/dx = W^T * dJ/dz, with the 
+ * row-order loops that rewrite the whole destination for every row, as 
+ * reference for transposed_matarr_mul.
+ */
+template <typename T>
+T* input_gradient_rows(T* dst, T const* mat, T const* src, size_t rows, 
+    size_t cols)
+{
+    std::fill_n(dst, cols, T{0});
+    for (size_t i = 0; i < rows; ++i)
+    {
+        for (size_t j = 0; j < cols; ++j)
+        {
+            dst[j] += src[i] * mat[(i * cols) + j];
+        }
+    }
+    return dst;
+}
+
+template <typename T>
+void run_input_gradient(Runner& r, char const* type, size_t n)
+{
+    auto mat = random_vector<T>(n * n, T{-1}, T{1});
+    auto x = random_vector<T>(n, T{-1}, T{1});
+    std::vector<T> dst(n);
+    double const s = sizeof(T);
+    double const len = static_cast<double>(n);
+    std::string size = std::to_string(n) + "x" + std::to_string(n);
+
+    r.run("input_gradient_rows", type, size, 2 * len * len, 
+        ((len * len) + (2 * len)) * s, [&]()
+    {
+        keep(input_gradient_rows(dst.data(), mat.data(), x.data(), n, n));
+    });
+    r.run("transposed_matarr_mul", type, size, 2 * len * len, 
+        ((len * len) + (2 * len)) * s, [&]()
+    {
+        keep(DLMath::transposed_matarr_mul(dst.data(), mat.data(), x.data(), 
+            n, n));
+    });
+
+    // The same kernel on the calling thread alone: the gap to the row above
+    // is the gain of splitting the column blocks on the pool.
+    size_t const threads = ThreadPool::global().size();
+    ThreadPool::configure(0);
+    r.run("transposed_serial", type, size, 2 * len * len, 
+        ((len * len) + (2 * len)) * s, [&]()
+    {
+        keep(DLMath::transposed_matarr_mul(dst.data(), mat.data(), x.data(), 
+            n, n));
+    });
+    ThreadPool::configure(threads);
+}
+
+template <typename T>
+void run_all(Runner& r, char const* type)
+{
+    for (size_t n: VECTOR_SIZES)
+    {
+        run_vector_kernels<T>(r, type, n);
+    }
+    for (size_t n: SOFTMAX_1_SIZES)
+    {
+        run_softmax_1<T>(r, type, n);
+    }
+    for (size_t n: MATRIX_SIZES)
+    {
+        run_matrix_kernels<T>(r, type, n);
+    }
+    for (size_t n: INPUT_GRADIENT_SIZES)
+    {
+        run_input_gradient<T>(r, type, n);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    bool json = false;
+    std::string filter;
+    long min_time_ms = 100;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+        {
+            min_time_ms = std::stol(argv[++i]);
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--json] [--filter name] "
+                "[--min-time ms]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Runner r{std::chrono::milliseconds{min_time_ms}, filter};
+    run_all<float>(r, "float");
+    run_all<double>(r, "double");
+
+    if (json)
+    {
+        r.print_json();
+    }
+    else
+    {
+        std::printf("threads=%zu (matrix kernels above %zu multiply-adds "
+            "run on the pool, transposed_matarr_mul splits 512 double "
+            "columns in blocks of %zu)\n\n", ThreadPool::global().size() + 1, 
+            DLMath::parallel_threshold, 
+            DLMath::transposed_block<double>(512, 512));
+        r.print_table();
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/***************************************************************************
+ *            bench_precision.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file bench_precision.cpp
+ *  \brief Throughput and accuracy of float64 and float32 models on the 
+ *  execution-time dataset.
+ *
+ *  Usage: ariadnedl-bench-precision [epochs] [csv]
+ */
+
+#include "dnn/gd_optimizer.hpp"
+#include "dnn/trainer.hpp"
+#include "execution_time.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Ariadne;
+using namespace Ariadne::Bench;
+
+namespace {
+
+constexpr size_t HIDDEN_SIZE  = 64;
+constexpr size_t BATCH_SIZE   = 16;
+constexpr double ETA          = 0.001;
+constexpr RneType::result_type SEED = 1;
+
+template <typename T>
+void run(char const* name, size_t epochs, Dataset const& d)
+{
+    BasicModel<T> m{"estimator"};
+    auto& loss = build_estimator(m, HIDDEN_SIZE, BATCH_SIZE);
+    m.init(SEED);
+
+    auto inputs  = convert<T>(d.train_inputs);
+    auto targets = convert<T>(d.train_targets);
+    auto tests   = convert<T>(d.test_inputs);
+
+    BasicGDOptimizer<T> o{static_cast<T>(ETA)};
+    BasicTrainer<T> t{m, loss, o, inputs, targets, BATCH_SIZE};
+
+    auto start = std::chrono::steady_clock::now();
+    while (t.epoch() < epochs)
+    {
+        t.step();
+    }
+    std::chrono::duration<double> elapsed = 
+        std::chrono::steady_clock::now() - start;
+
+    double error = 0.0;
+    for (size_t i = 0; i < tests.size(); ++i)
+    {
+        T* prediction = m.predict(tests[i].data());
+        error += std::pow(static_cast<double>(prediction[0]) 
+            - d.test_targets[i][0], 2);
+    }
+    error = std::sqrt(error / static_cast<double>(tests.size()));
+
+    double samples_per_sec = 
+        static_cast<double>(epochs * inputs.size()) / elapsed.count();
+    std::printf("%-12s samples/s=%-10.0f test_rmse=%.6f\n", name, 
+        samples_per_sec, error);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t epochs = argc > 1 ? std::stoul(argv[1]) : 20;
+    Dataset d = load_dataset(argc > 2 ? argv[2] : default_dataset());
+    std::printf("train=%zu test=%zu epochs=%zu\n\n", 
+        d.train_inputs.size(), d.test_inputs.size(), epochs);
+
+    run<double>("float64", epochs, d);
+    run<float>("float32", epochs, d);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+/***************************************************************************
+ *            bench_quantized.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file bench_quantized.cpp
+ *  \brief Prediction latency and error of a float64 model and of its int8 
+ *  post-training quantization on the execution-time dataset.
+ *
+ *  Usage: ariadnedl-bench-quantized [epochs] [hidden_size] [csv]
+ */
+
+#include "dnn/gd_optimizer.hpp"
+#include "dnn/quantized_dense.hpp"
+#include "dnn/trainer.hpp"
+#include "execution_time.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Ariadne;
+using namespace Ariadne::Bench;
+
+namespace {
+
+constexpr size_t BATCH_SIZE   = 16;
+constexpr size_t CALIBRATION  = 256;
+constexpr size_t REPEATS      = 50;
+constexpr double ETA          = 0.001;
+constexpr RneType::result_type SEED = 1;
+
+/**
+ * \brief Report the mean latency of predict() over the test set and the 
+ * root mean squared error of the predictions.
+ */
+void report(char const* name, Model& m, Dataset const& d)
+{
+    auto tests = d.test_inputs;
+    double error = 0.0;
+    for (size_t i = 0; i < tests.size(); ++i)
+    {
+        error += std::pow(m.predict(tests[i].data())[0] 
+            - d.test_targets[i][0], 2);
+    }
+    error = std::sqrt(error / static_cast<double>(tests.size()));
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < REPEATS; ++r)
+    {
+        for (auto& x: tests)
+        {
+            m.predict(x.data());
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = 
+        std::chrono::steady_clock::now() - start;
+    double latency = elapsed.count() 
+        / static_cast<double>(REPEATS * tests.size());
+
+    std::printf("%-18s latency_ns=%-10.1f test_rmse=%.6f\n", name, latency, 
+        error);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t epochs = argc > 1 ? std::stoul(argv[1]) : 20;
+    size_t hidden = argc > 2 ? std::stoul(argv[2]) : 64;
+    Dataset d = load_dataset(argc > 3 ? argv[3] : default_dataset());
+
+    Model m{"estimator"};
+    auto& loss = build_estimator(m, hidden, BATCH_SIZE);
+    m.init(SEED);
+
+    GDOptimizer o{ETA};
+    Trainer t{m, loss, o, d.train_inputs, d.train_targets, BATCH_SIZE};
+    while (t.epoch() < epochs)
+    {
+        t.step();
+    }
+    m.freeze();
+
+    auto samples = std::min(CALIBRATION, d.train_inputs.size());
+    std::vector<std::vector<NumType>> calibration(d.train_inputs.begin(), 
+        d.train_inputs.begin() + static_cast<std::ptrdiff_t>(samples));
+    auto q = QuantizedDenseLayer::quantize(m, calibration);
+
+    std::printf("hidden=%zu epochs=%zu calibration=%zu\n\n", hidden, epochs, 
+        calibration.size());
+    report("float64", m, d);
+    for (auto kernel: {Int8Kernel::Scalar, Int8Kernel::AVX2, 
+        Int8Kernel::AVX512VNNI})
+    {
+        if (!Int8Math::supported(kernel))
+        {
+            continue;
+        }
+        for (size_t i = 0; i < q->node_count(); ++i)
+        {
+            if (auto* layer = dynamic_cast<QuantizedDenseLayer*>(&q->node(i)))
+            {
+                layer->set_kernel(kernel);
+            }
+        }
+        std::string name = std::string{"int8."} + Int8Math::name(kernel);
+        report(name.c_str(), *q, d);
+    }
+    return EXIT_SUCCESS;
+}
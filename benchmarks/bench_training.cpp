@@ -0,0 +1,230 @@
+/***************************************************************************
+ *            bench_training.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file bench_training.cpp
+ *  \brief End-to-end training throughput of the estimator on the execution
+ *  time dataset, split into data loading, forward, backward and optimizer.
+ *
+ *  The phase breakdown runs the training loop of the Trainer by hand, for
+ *  several mini-batch sizes, with the intra-op thread pool disabled: the 
+ *  kernels of the estimator are below DLMath::parallel_threshold, so the 
+ *  pool would not change them. Whole epochs are timed, and the time is
+ *  split into the phases with the proportions measured on one mini-batch 
+ *  every SAMPLE_PERIOD, so that the clock is not read around every sample.
+ *  The data-parallel section runs the synchronous ParallelTrainer with an 
+ *  increasing amount of threads. The last line is the end-to-end samples/s 
+ *  of the default configuration.
+ *
+ *  Usage: ariadnedl-bench-training [epochs] [max_threads] [csv]
+ */
+
+#include "dnn/gd_optimizer.hpp"
+#include "dnn/parallel_trainer.hpp"
+#include "dnn/thread_pool.hpp"
+#include "execution_time.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Ariadne;
+using namespace Ariadne::Bench;
+
+namespace {
+
+using Clock    = std::chrono::steady_clock;
+using Duration = std::chrono::duration<double>;
+
+constexpr size_t HIDDEN_SIZE   = 64;
+constexpr size_t DEFAULT_BATCH = 16;
+constexpr size_t BATCH_SIZES[] = {1, DEFAULT_BATCH, 64};
+constexpr size_t SAMPLE_PERIOD = 16;
+constexpr NumType ETA          = 0.001;
+constexpr RneType::result_type SEED = 1;
+
+/**
+ * \brief Time of the training and of its phases in the sampled mini-batches.
+ */
+struct Phases
+{
+    Duration total{0};
+    Duration forward{0};
+    Duration backward{0};
+    Duration optimizer{0};
+    size_t samples{0};
+    NumType loss{0.0};
+
+    /**
+     * \brief Share of the training time spent in a phase, estimated from 
+     * the sampled mini-batches.
+     * \param phase Sampled time of the phase.
+     * \return double
+     */
+    [[nodiscard]] double share(Duration phase) const
+    {
+        Duration sampled = forward + backward + optimizer;
+        return sampled.count() > 0 ? phase / sampled : 0.0;
+    }
+};
+
+double per_sec(size_t count, Duration d)
+{
+    return d.count() > 0 ? static_cast<double>(count) / d.count() : 0.0;
+}
+
+/**
+ * \brief Train a new estimator with the loop of the Trainer, timing whole 
+ * epochs and the phases of one mini-batch every SAMPLE_PERIOD. The forward
+ * phase includes setting the target.
+ */
+Phases run_phases(Dataset const& d, size_t batch_size, size_t epochs)
+{
+    Model m{"estimator"};
+    auto& loss = build_estimator(m, HIDDEN_SIZE, batch_size);
+    m.init(SEED);
+    GDOptimizer o{ETA};
+
+    auto const& inputs  = d.train_inputs;
+    auto const& targets = d.train_targets;
+
+    Phases p;
+    size_t batch = 0;
+    for (size_t e = 0; e < epochs; ++e)
+    {
+        auto start = Clock::now();
+        loss.reset_score();
+        for (size_t begin = 0; begin < inputs.size(); begin += batch_size)
+        {
+            size_t end = std::min(begin + batch_size, inputs.size());
+            if (batch++ % SAMPLE_PERIOD != 0)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    loss.set_target(targets[i].data());
+                    m.forward(const_cast<NumType*>(inputs[i].data()));
+                    m.reverse();
+                }
+                m.train(o);
+                continue;
+            }
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                auto t0 = Clock::now();
+                loss.set_target(targets[i].data());
+                m.forward(const_cast<NumType*>(inputs[i].data()));
+                auto t1 = Clock::now();
+                m.reverse();
+                auto t2 = Clock::now();
+                p.forward  += t1 - t0;
+                p.backward += t2 - t1;
+            }
+
+            auto t0 = Clock::now();
+            m.train(o);
+            p.optimizer += Clock::now() - t0;
+        }
+        p.total   += Clock::now() - start;
+        p.samples += inputs.size();
+    }
+    p.loss = loss.avg_loss();
+    return p;
+}
+
+/**
+ * \brief Train a new estimator with the synchronous data-parallel trainer.
+ * \return Phases Only the total time is known.
+ */
+Phases run_parallel(Dataset const& d, size_t threads, size_t epochs)
+{
+    Model m{"estimator"};
+    auto& loss = build_estimator(m, HIDDEN_SIZE, DEFAULT_BATCH);
+    m.init(SEED);
+    GDOptimizer o{ETA};
+
+    ParallelTrainer t{m, loss, o, d.train_inputs, d.train_targets, 
+        DEFAULT_BATCH, threads, ParallelMode::Synchronous};
+
+    Phases p;
+    auto start = Clock::now();
+    for (size_t e = 0; e < epochs; ++e)
+    {
+        t.run_epoch();
+    }
+    p.total   = Clock::now() - start;
+    p.samples = epochs * d.train_inputs.size();
+    p.loss    = t.avg_loss();
+    return p;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t epochs      = argc > 1 ? std::stoul(argv[1]) : 5;
+    size_t max_threads = argc > 2 ? std::stoul(argv[2]) : 4;
+    std::string path   = argc > 3 ? argv[3] : default_dataset();
+
+    auto start = Clock::now();
+    Dataset d = load_dataset(path);
+    Duration load = Clock::now() - start;
+    std::printf("load: samples=%zu time_ms=%.3f\n\n", 
+        d.train_inputs.size() + d.test_inputs.size(), load.count() * 1e3);
+
+    double score = 0.0;
+    ThreadPool::configure(0);
+    std::printf("%-8s %5s %14s %14s %12s %14s %12s\n", "phases", "batch", 
+        "forward/s", "backward/s", "optimizer_%", "samples/s", "final_loss");
+    for (size_t batch_size: BATCH_SIZES)
+    {
+        Phases p = run_phases(d, batch_size, epochs);
+        double samples_per_sec = per_sec(p.samples, p.total);
+        std::printf("%-8s %5zu %14.0f %14.0f %12.1f %14.0f %12.6f\n",
+            "serial", batch_size, 
+            per_sec(p.samples, p.total * p.share(p.forward)), 
+            per_sec(p.samples, p.total * p.share(p.backward)), 
+            p.share(p.optimizer) * 100.0, samples_per_sec, p.loss);
+        if (batch_size == DEFAULT_BATCH)
+        {
+            score = samples_per_sec;
+        }
+    }
+
+    std::printf("\n%-8s %5s %7s %14s %12s\n", "parallel", "batch", 
+        "threads", "samples/s", "final_loss");
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        Phases p = run_parallel(d, threads, epochs);
+        std::printf("%-8s %5zu %7zu %14.0f %12.6f\n", "sync", DEFAULT_BATCH, 
+            threads, per_sec(p.samples, p.total), p.loss);
+    }
+
+    std::printf("\nsamples/s (batch=%zu, threads=1): %.0f\n", DEFAULT_BATCH, 
+        score);
+    return EXIT_SUCCESS;
+}
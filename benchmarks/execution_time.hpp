@@ -0,0 +1,174 @@
+/***************************************************************************
+ *            execution_time.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file execution_time.hpp
+ *  \brief Loader of the execution-time dataset shared by the benchmarks.
+ */
+
+#ifndef ARIADNE_BENCHMARKS_EXECUTION_TIME_HPP
+#define ARIADNE_BENCHMARKS_EXECUTION_TIME_HPP
+
+#include "dnn/dense.hpp"
+#include "dnn/model.hpp"
+#include "dnn/mse_loss.hpp"
+#include "parser/csv.hpp"
+
+#include <cmath>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+namespace Ariadne::Bench {
+
+/// \brief Features of a row: integration step and four coordinates.
+constexpr size_t EXECUTION_TIME_FEATURES = 5;
+/// \brief One row every TEST_STRIDE is held out for testing.
+constexpr size_t TEST_STRIDE = 5;
+
+/**
+ * \brief Standardized training and test splits, one target per row.
+ */
+struct Dataset
+{
+    std::vector<std::vector<double>> train_inputs;
+    std::vector<std::vector<double>> train_targets;
+    std::vector<std::vector<double>> test_inputs;
+    std::vector<std::vector<double>> test_targets;
+};
+
+/**
+ * \brief Load the dataset, standardize the features and the logarithm of 
+ * the execution time, and hold out one row every TEST_STRIDE for testing.
+ */
+inline Dataset load_dataset(std::filesystem::path const& path)
+{
+    std::vector<std::vector<double>> rows;
+    CSV csv{path.string()};
+    for (auto& row: csv)
+    {
+        std::vector<double> values = row;
+        values.back() = std::log(values.back());
+        rows.push_back(std::move(values));
+    }
+
+    size_t const cols = EXECUTION_TIME_FEATURES + 1;
+    std::vector<double> mean(cols, 0.0);
+    std::vector<double> std_dev(cols, 0.0);
+    for (auto& r: rows)
+    {
+        for (size_t c = 0; c < cols; ++c)
+        {
+            mean[c] += r[c] / static_cast<double>(rows.size());
+        }
+    }
+    for (auto& r: rows)
+    {
+        for (size_t c = 0; c < cols; ++c)
+        {
+            std_dev[c] += std::pow(r[c] - mean[c], 2) 
+                / static_cast<double>(rows.size());
+        }
+    }
+
+    Dataset d;
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        std::vector<double> x(EXECUTION_TIME_FEATURES);
+        for (size_t c = 0; c < cols; ++c)
+        {
+            double s = std_dev[c] > 0.0 ? std::sqrt(std_dev[c]) : 1.0;
+            double v = (rows[i][c] - mean[c]) / s;
+            if (c < EXECUTION_TIME_FEATURES)
+            {
+                x[c] = v;
+            }
+            else if (i % TEST_STRIDE == 0)
+            {
+                d.test_inputs.push_back(std::move(x));
+                d.test_targets.push_back({v});
+            }
+            else
+            {
+                d.train_inputs.push_back(std::move(x));
+                d.train_targets.push_back({v});
+            }
+        }
+    }
+    return d;
+}
+
+/**
+ * \brief Default location of the dataset in the source tree.
+ */
+inline std::filesystem::path default_dataset()
+{
+    return std::filesystem::path(__FILE__).parent_path() / ".." / "data" 
+        / "execution-time.csv";
+}
+
+/**
+ * \brief Convert rows to another scalar type.
+ */
+template <typename T>
+inline std::vector<std::vector<T>> convert(
+    std::vector<std::vector<double>> const& v)
+{
+    std::vector<std::vector<T>> ret;
+    for (auto& row: v)
+    {
+        ret.emplace_back(row.begin(), row.end());
+    }
+    return ret;
+}
+
+/**
+ * \brief Add the estimator topology to an empty model: two ReLU hidden 
+ * layers and a linear output trained with the mean squared error.
+ * \param m           Model.
+ * \param hidden      Width of the hidden layers.
+ * \param batch_size  Mini-batch size of the loss.
+ * \return BasicMSELossLayer<T>& The loss layer.
+ */
+template <typename T>
+BasicMSELossLayer<T>& build_estimator(BasicModel<T>& m, size_t hidden, 
+    size_t batch_size)
+{
+    auto& hidden1 = m.template add_node<BasicDenseLayer<T>>("hidden1", 
+        Activation::ReLU, hidden, EXECUTION_TIME_FEATURES);
+    auto& hidden2 = m.template add_node<BasicDenseLayer<T>>("hidden2", 
+        Activation::ReLU, hidden, hidden);
+    auto& output = m.template add_node<BasicDenseLayer<T>>("output", 
+        Activation::Linear, 1, hidden);
+    auto& loss = m.template add_node<BasicMSELossLayer<T>>("loss", 1, 
+        batch_size);
+    m.create_edge(hidden2, hidden1);
+    m.create_edge(output, hidden2);
+    m.create_edge(loss, output);
+    return loss;
+}
+
+} // namespace Ariadne::Bench
+
+#endif // ARIADNE_BENCHMARKS_EXECUTION_TIME_HPP
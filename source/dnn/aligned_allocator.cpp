@@ -0,0 +1,86 @@
+/***************************************************************************
+ *            aligned_allocator.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "aligned_allocator.hpp"
+
+#include <atomic>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace Ariadne {
+
+namespace {
+
+std::atomic<bool> huge_pages_enabled{false};
+
+/**
+ * \brief Alignment of a block of the given size.
+ * \param bytes Size of the block.
+ * \return std::align_val_t
+ */
+std::align_val_t block_alignment(size_t bytes) noexcept
+{
+    return std::align_val_t{bytes >= AlignedStorage::huge_page_size 
+        ? AlignedStorage::huge_page_size 
+        : AlignedStorage::alignment};
+}
+
+} // namespace
+
+void* AlignedStorage::allocate(size_t bytes)
+{
+    void* block = ::operator new(bytes, block_alignment(bytes));
+
+#if defined(__linux__)
+    if (bytes >= huge_page_size 
+        && huge_pages_enabled.load(std::memory_order_relaxed))
+    {
+        // Only a hint: the block works the same if it is refused.
+        size_t length = bytes / huge_page_size * huge_page_size;
+        ::madvise(block, length, MADV_HUGEPAGE);
+    }
+#endif
+    return block;
+}
+
+void AlignedStorage::deallocate(void* block, size_t bytes) noexcept
+{
+    ::operator delete(block, block_alignment(bytes));
+}
+
+void AlignedStorage::use_huge_pages(bool enable) noexcept
+{
+    huge_pages_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool AlignedStorage::huge_pages() noexcept
+{
+    return huge_pages_enabled.load(std::memory_order_relaxed);
+}
+
+} // namespace Ariadne
@@ -0,0 +1,124 @@
+/***************************************************************************
+ *            aligned_allocator.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file aligned_allocator.hpp
+ *  \brief Cache-line aligned storage of the layer buffers.
+ */
+
+#ifndef ARIADNE_DNN_ALIGNED_ALLOCATOR_HPP
+#define ARIADNE_DNN_ALIGNED_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <vector>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Allocation of blocks aligned to a cache line.
+ *
+ * Blocks of at least huge_page_size bytes are aligned to huge_page_size, so 
+ * that the kernel can back them with transparent huge pages. Whether it is 
+ * asked to, with madvise(MADV_HUGEPAGE), is chosen with use_huge_pages() and 
+ * applies to the blocks allocated afterwards (Linux only).
+ */
+class AlignedStorage
+{
+public:
+    /// \brief Alignment of every block, a cache line.
+    static constexpr size_t alignment = 64;
+    /// \brief Size of a transparent huge page.
+    static constexpr size_t huge_page_size = size_t{2} << 20;
+
+    /**
+     * \brief Allocate a block.
+     * \param bytes Size of the block.
+     * \return void* Block aligned to alignment.
+     */
+    static void* allocate(size_t bytes);
+
+    /**
+     * \brief Free a block.
+     * \param block Block returned by allocate().
+     * \param bytes Size passed to allocate().
+     */
+    static void deallocate(void* block, size_t bytes) noexcept;
+
+    /**
+     * \brief Ask for huge pages for the large blocks allocated from now on.
+     * \param enable Whether to ask for them.
+     */
+    static void use_huge_pages(bool enable) noexcept;
+
+    /**
+     * \brief Whether huge pages are asked for the large blocks.
+     * \return bool
+     */
+    static bool huge_pages() noexcept;
+};
+
+/**
+ * \brief Standard allocator on AlignedStorage.
+ * \tparam T Type of the values.
+ */
+template <typename T>
+class AlignedAllocator
+{
+public:
+    using value_type = T;
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(AlignedAllocator<U> const&) noexcept 
+    { }
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(AlignedStorage::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* block, size_t count) noexcept
+    {
+        AlignedStorage::deallocate(block, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(AlignedAllocator<U> const&) const noexcept 
+    { 
+        return true; 
+    }
+};
+
+/**
+ * \brief Vector whose data is aligned to AlignedStorage::alignment.
+ * \tparam T Type of the values.
+ */
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_ALIGNED_ALLOCATOR_HPP
@@ -0,0 +1,168 @@
+/***************************************************************************
+ *            allocation_tracker.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "allocation_tracker.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace Ariadne {
+
+namespace {
+
+// Plain thread-local integers: updating them never allocates.
+thread_local uint64_t thread_count = 0;
+thread_local uint64_t thread_bytes = 0;
+std::atomic<uint64_t> process_count{0};
+std::atomic<uint64_t> process_bytes{0};
+
+void note(size_t size) noexcept
+{
+    ++thread_count;
+    thread_bytes += size;
+    process_count.fetch_add(1, std::memory_order_relaxed);
+    process_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void* allocate(size_t size) noexcept
+{
+    note(size);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* allocate(size_t size, std::align_val_t align) noexcept
+{
+    note(size);
+    auto alignment = static_cast<size_t>(align);
+    size_t rounded = (size + alignment - 1) / alignment * alignment;
+    return std::aligned_alloc(alignment, rounded > 0 ? rounded : alignment);
+}
+
+template <typename... Args>
+void* allocate_or_throw(Args... args)
+{
+    void* ptr = allocate(args...);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc{};
+    }
+    return ptr;
+}
+
+} // namespace
+
+AllocationStats AllocationTracker::thread_stats() noexcept
+{
+    return {thread_count, thread_bytes};
+}
+
+AllocationStats AllocationTracker::process_stats() noexcept
+{
+    return {process_count.load(std::memory_order_relaxed), 
+        process_bytes.load(std::memory_order_relaxed)};
+}
+
+} // namespace Ariadne
+
+// Replacements of the global allocation functions.
+
+void* operator new(size_t size)
+{
+    return Ariadne::allocate_or_throw(size);
+}
+
+void* operator new[](size_t size)
+{
+    return Ariadne::allocate_or_throw(size);
+}
+
+void* operator new(size_t size, std::align_val_t align)
+{
+    return Ariadne::allocate_or_throw(size, align);
+}
+
+void* operator new[](size_t size, std::align_val_t align)
+{
+    return Ariadne::allocate_or_throw(size, align);
+}
+
+void* operator new(size_t size, std::nothrow_t const&) noexcept
+{
+    return Ariadne::allocate(size);
+}
+
+void* operator new[](size_t size, std::nothrow_t const&) noexcept
+{
+    return Ariadne::allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t align, 
+    std::nothrow_t const&) noexcept
+{
+    return Ariadne::allocate(size, align);
+}
+
+void* operator new[](size_t size, std::align_val_t align, 
+    std::nothrow_t const&) noexcept
+{
+    return Ariadne::allocate(size, align);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept 
+{ 
+    std::free(ptr); 
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept 
+{ 
+    std::free(ptr); 
+}
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept 
+{ 
+    std::free(ptr); 
+}
+void operator delete(void* ptr, std::nothrow_t const&) noexcept 
+{ 
+    std::free(ptr); 
+}
+void operator delete[](void* ptr, std::nothrow_t const&) noexcept 
+{ 
+    std::free(ptr); 
+}
+void operator delete(void* ptr, std::align_val_t, 
+    std::nothrow_t const&) noexcept 
+{ 
+    std::free(ptr); 
+}
+void operator delete[](void* ptr, std::align_val_t, 
+    std::nothrow_t const&) noexcept 
+{ 
+    std::free(ptr); 
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *            allocation_tracker.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file allocation_tracker.hpp
+ *  \brief Counters of the heap allocations, per thread and per scope.
+ *
+ *  The counters are updated by replacements of the global operator new 
+ *  that are not part of the ariadnedl library: a program tracks its 
+ *  allocations by linking the ariadnedl-alloc-tracking object library, 
+ *  otherwise it must not use these classes.
+ */
+
+#ifndef ARIADNE_DNN_ALLOCATION_TRACKER_HPP
+#define ARIADNE_DNN_ALLOCATION_TRACKER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Amount of allocations and of bytes requested.
+ */
+struct AllocationStats
+{
+    uint64_t count{0};
+    uint64_t bytes{0};
+};
+
+/**
+ * \brief Totals of the allocations made through any form of operator new 
+ * and new[].
+ */
+class AllocationTracker
+{
+public:
+    /**
+     * \brief Allocations of the calling thread since it started.
+     * \return AllocationStats
+     */
+    static AllocationStats thread_stats() noexcept;
+
+    /**
+     * \brief Allocations of all the threads since the program started.
+     * \return AllocationStats
+     */
+    static AllocationStats process_stats() noexcept;
+};
+
+/**
+ * \brief Allocations of the calling thread since the construction of the 
+ * scope, e.g. to assert that a hot path does not allocate.
+ */
+class AllocationScope
+{
+public:
+    AllocationScope() noexcept 
+        : _start{AllocationTracker::thread_stats()} 
+    {}
+
+    /**
+     * \brief Allocations since the construction.
+     * \return AllocationStats
+     */
+    [[nodiscard]] AllocationStats stats() const noexcept
+    {
+        AllocationStats now = AllocationTracker::thread_stats();
+        return {now.count - _start.count, now.bytes - _start.bytes};
+    }
+
+    /**
+     * \brief Amount of allocations since the construction.
+     * \return uint64_t
+     */
+    [[nodiscard]] uint64_t count() const noexcept { return stats().count; }
+
+private:
+    AllocationStats _start;
+};
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_ALLOCATION_TRACKER_HPP
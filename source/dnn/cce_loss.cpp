@@ -31,25 +31,24 @@
 
 namespace Ariadne {
 
-CCELossLayer::CCELossLayer(Model& model, std::string name, 
-    uint16_t input_size, size_t batch_size)
-    : Layer(model, name)
+template <typename T>
+BasicCCELossLayer<T>::BasicCCELossLayer(BasicModel<T>& model, 
+    std::string name, uint16_t input_size, size_t batch_size)
+    : BasicLossLayer<T>(model, name)
     , _input_size{input_size}
-    , _inv_batch_size{NumType{1.0} / batch_size}
-{ 
-    /* 
-     * When we deliver a gradient back, we deliver just the loss gradient with
-     * respect to any input and the index that was "hot" in the second argument.
-     */
-    _gradients.resize(_input_size);
-}
+    , _inv_batch_size{T{1.0} / batch_size}
+{ }
 
-void CCELossLayer::forward(NumType* inputs)
+template <typename T>
+void BasicCCELossLayer<T>::forward(BasicTensorView<T const> inputs)
 {
-    _loss = DLMath::cross_entropy(_target, inputs, _input_size);
+    this->_check_size(inputs, _input_size, "inputs");
+    ScratchScope scratch;
+    T const* y_hat = DLMath::contiguous(inputs, scratch);
+    _loss = DLMath::cross_entropy(_target, y_hat, _input_size);
     _cumulative_loss += _loss;
     
-    auto max = DLMath::max_and_argmax(inputs, _input_size);
+    auto max = DLMath::max_and_argmax(y_hat, _input_size);
     // NumType max_value = std::get<0>(max);
     size_t max_index = std::get<1>(max);
 
@@ -67,50 +66,79 @@ void CCELossLayer::forward(NumType* inputs)
     _last_input = inputs;
 }
 
-void CCELossLayer::reverse(NumType* gradients)
+template <typename T>
+void BasicCCELossLayer<T>::reverse(BasicTensorView<T const> gradients)
 {
     // Parameter ignored because it is a loss layer.
     (void) gradients;
 
-    DLMath::cross_entropy_1(_gradients.data(), _target, _last_input, 
-        _inv_batch_size, _input_size);
+    ScratchScope scratch;
+    DLMath::cross_entropy_1(_gradients, _target, 
+        DLMath::contiguous(_last_input, scratch), _inv_batch_size, 
+        _input_size);
+}
 
-    for (auto* l: _antecedents)
+template <typename T>
+LayerCost BasicCCELossLayer<T>::cost(Phase phase) const noexcept
+{
+    double const inputs = _input_size;
+    if (phase == Phase::Forward)
+    {
+        return {3.0 * inputs, 2.0 * sizeof(T) * inputs};
+    }
+    if (phase == Phase::Reverse)
     {
-        l->reverse(_gradients.data());
+        return {2.0 * inputs, 3.0 * sizeof(T) * inputs};
     }
+    return BasicLayer<T>::cost(phase);
 }
 
-void CCELossLayer::print() const
+template <typename T>
+void BasicCCELossLayer<T>::print() const
 {
     std::printf("avg loss: %f\t%f%% correct\n", avg_loss(), accuracy() * 100.0);
 }
 
-void CCELossLayer::set_target(NumType const* target)
+template <typename T>
+std::unique_ptr<BasicLayer<T>> BasicCCELossLayer<T>::clone(
+    BasicModel<T>& model) const
+{
+    auto layer = std::make_unique<BasicCCELossLayer>(model, _name, 
+        _input_size, 1);
+    layer->_inv_batch_size = _inv_batch_size;
+    return layer;
+}
+
+template <typename T>
+void BasicCCELossLayer<T>::set_target(T const* target)
 {
     _target = target;
 }
 
-NumType CCELossLayer::accuracy() const
+template <typename T>
+T BasicCCELossLayer<T>::accuracy() const
 {
-    return static_cast<NumType>(_correct) 
-         / static_cast<NumType>(_correct + _incorrect);
+    return static_cast<T>(_correct) 
+         / static_cast<T>(_correct + _incorrect);
 }
 
-NumType CCELossLayer::avg_loss() const
+template <typename T>
+T BasicCCELossLayer<T>::avg_loss() const
 {
-    return static_cast<NumType>(_cumulative_loss) 
-         / static_cast<NumType>(_correct + _incorrect);
+    return static_cast<T>(_cumulative_loss) 
+         / static_cast<T>(_correct + _incorrect);
 }
 
-void CCELossLayer::reset_score()
+template <typename T>
+void BasicCCELossLayer<T>::reset_score()
 {
     _cumulative_loss = 0.0;
     _correct         = 0.0;
     _incorrect       = 0.0;
 }
 
-size_t CCELossLayer::_argactive() const
+template <typename T>
+size_t BasicCCELossLayer<T>::_argactive() const
 {
     if (_target == nullptr)
     {
@@ -119,7 +147,7 @@ size_t CCELossLayer::_argactive() const
 
     for (size_t i = 0; i < _input_size; ++i)
     {
-        if (_target[i] != NumType{0.0})
+        if (_target[i] != T{0.0})
         {
             return i;
         }
@@ -129,4 +157,7 @@ size_t CCELossLayer::_argactive() const
     return 0;
 }
 
+template class BasicCCELossLayer<float>;
+template class BasicCCELossLayer<double>;
+
 } // namespace Ariadne
\ No newline at end of file
@@ -29,17 +29,22 @@
 #ifndef ARIADNE_DNN_CCE_LOSS_HPP
 #define ARIADNE_DNN_CCE_LOSS_HPP
 
-#include "layer.hpp"
+#include "loss.hpp"
 #include "model.hpp"
 
 #include <string>
 
 namespace Ariadne {
 
-class CCELossLayer : public Layer {
+/**
+ * \brief Categorical cross-entropy loss layer.
+ * \tparam T Scalar type of the model.
+ */
+template <typename T>
+class BasicCCELossLayer : public BasicLossLayer<T> {
 public:
-    CCELossLayer(Model& model, std::string name, uint16_t input_size, 
-        size_t batch_size);
+    BasicCCELossLayer(BasicModel<T>& model, std::string name, 
+        uint16_t input_size, size_t batch_size);
 
     /**
      * \brief No initiallization is needed for this layer.
@@ -47,30 +52,44 @@ public:
      */
     void init(RneType& rne) override { (void) rne; };
 
-    void forward(NumType* inputs) override;
+    void forward(BasicTensorView<T const> inputs) override;
 
     /**
      * \brief As a loss node, the argument to this method is ignored (the 
      * gradient of the loss with respect to itself is unity).
      * \param gradients
      */
-    void reverse(NumType* gradients = nullptr) override;
+    void reverse(BasicTensorView<T const> gradients = {}) override;
+
+    T* input_gradient() override { return _gradients; }
+    size_t input_size() const noexcept override { return _input_size; }
+
+    void bind_buffers(BasicLayerBuffers<T> const& buffers) override
+    {
+        _gradients = buffers.input_gradient;
+    }
 
+    LayerCost cost(Phase phase) const noexcept override;
+    std::string type() const override { return "cce_loss"; }
     void print() const override;
 
+    std::unique_ptr<BasicLayer<T>> clone(BasicModel<T>& model) const override;
+
     /**
      * \brief Set the target object.
      * During training, this must be set to the expected target distribution for 
      * a given sample.
      * \param target
      */
-    void set_target(NumType const* target);
+    void set_target(T const* target) override;
 
-    NumType accuracy() const;
-    NumType avg_loss() const;
-    void reset_score();
+    T accuracy() const override;
+    T avg_loss() const override;
+    void reset_score() override;
 
 private:
+    using BasicLayer<T>::_name;
+
     /**
      * \brief Find the argument of _target array that is active.
      * \return size_t
@@ -78,23 +97,25 @@ private:
     size_t _argactive() const;
 
     uint16_t _input_size;
-    NumType _loss;
-    const NumType* _target;
-    NumType* _last_input;
+    T _loss;
+    const T* _target;
+    BasicTensorView<T const> _last_input;
 
-    std::vector<NumType> _gradients;
+    T* _gradients{nullptr}; ///< Input gradients, bound by the Model.
 
-    NumType _inv_batch_size; ///< Used to scale with batch size.
+    T _inv_batch_size; ///< Used to scale with batch size.
 
     // Last active classification in the target one-hot encoding. 
     size_t _active; 
-    NumType _cumulative_loss{0.0};
+    T _cumulative_loss{0.0};
     
     // Running counts of correct and incorrect predictions.
     size_t _correct{0};
     size_t _incorrect{0};
 };
 
+using CCELossLayer = BasicCCELossLayer<NumType>;
+
 } // namespace Ariadne
  
 #endif // ARIADNE_DNN_CCE_LOSS_HPP
\ No newline at end of file
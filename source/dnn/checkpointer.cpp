@@ -0,0 +1,473 @@
+/***************************************************************************
+ *            checkpointer.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "checkpointer.hpp"
+
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Ariadne {
+
+template <typename T>
+BasicCheckpointer<T>::BasicCheckpointer(BasicModel<T>& model, 
+    std::filesystem::path path, size_t keep, CheckpointMode mode, 
+    size_t full_interval)
+    : _model{model}
+    , _path{std::move(path)}
+    , _keep{std::max(keep, size_t{1})}
+    , _mode{mode}
+    , _full_interval{std::max(full_interval, size_t{1})}
+{
+    size_t size  = 0;
+    size_t pages = 0;
+    for (size_t i = 0; i < _model.node_count(); ++i)
+    {
+        BasicLayer<T>& layer = _model.node(i);
+        _layers.push_back(&layer);
+        _offsets.push_back(layer.param_block_size() > 0 ? size : _none);
+        _first_pages.push_back(pages);
+        size  += layer.param_block_size();
+        pages += ModelFormat::pages(layer.param_block_size() * sizeof(T));
+    }
+    _first_pages.push_back(pages); // One past the last layer: all the pages.
+    _records = ModelFormat::describe(_layers);
+    _snapshots[0].resize(size);
+    _snapshots[1].resize(size);
+
+    // Continue the sequence of the checkpoints already on disk, and rotate 
+    // them with the new ones. A file whose header cannot be read counts as 
+    // a delta, so that it never becomes the base of a kept chain.
+    for (uint64_t sequence: _sequences(_path))
+    {
+        ModelFormat::Header header;
+        std::ifstream in{_file(sequence), std::ios::binary};
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        bool const full = in && (header.flags & ModelFormat::delta) == 0;
+        _history.emplace_back(sequence, full);
+        _since_full = full ? 0 : _since_full + 1;
+        _sequence = sequence + 1;
+    }
+
+    _thread = std::thread{&BasicCheckpointer<T>::_loop, this};
+}
+
+template <typename T>
+BasicCheckpointer<T>::~BasicCheckpointer()
+{
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _stop = true;
+    }
+    _cv.notify_all();
+    _thread.join();
+}
+
+template <typename T>
+void BasicCheckpointer<T>::checkpoint()
+{
+    ARIADNE_TRACE_SCOPE("checkpoint", "snapshot");
+    std::lock_guard<std::mutex> lock{_mutex};
+    _rethrow();
+
+    // A snapshot not written yet is replaced by the newer one.
+    size_t snapshot = _pending != _none ? _pending : (_writing == 0 ? 1 : 0);
+    T* data = _snapshots[snapshot].data();
+    for (size_t i = 0; i < _layers.size(); ++i)
+    {
+        if (_offsets[i] != _none)
+        {
+            std::copy_n(_layers[i]->param(0), _layers[i]->param_block_size(), 
+                data + _offsets[i]);
+        }
+    }
+    _pending = snapshot;
+    _cv.notify_all();
+}
+
+template <typename T>
+void BasicCheckpointer<T>::flush()
+{
+    std::unique_lock<std::mutex> lock{_mutex};
+    _cv.wait(lock, [this]()
+    {
+        return (_pending == _none && _writing == _none) || _error;
+    });
+    _rethrow();
+}
+
+template <typename T>
+size_t BasicCheckpointer<T>::written() const
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _written;
+}
+
+template <typename T>
+std::filesystem::path BasicCheckpointer<T>::last() const
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _history.empty() ? std::filesystem::path{} 
+                            : _file(_history.back().first);
+}
+
+template <typename T>
+void BasicCheckpointer<T>::_loop()
+{
+    std::unique_lock<std::mutex> lock{_mutex};
+    for (;;)
+    {
+        _cv.wait(lock, [this]() { return _stop || _pending != _none; });
+        if (_pending == _none)
+        {
+            return;
+        }
+
+        _writing = std::exchange(_pending, _none);
+        lock.unlock();
+        try
+        {
+            _write(_writing);
+        }
+        catch (...)
+        {
+            lock.lock();
+            _error = std::current_exception();
+            _writing = _none;
+            _cv.notify_all();
+            continue;
+        }
+        lock.lock();
+        _writing = _none;
+        ++_written;
+        _cv.notify_all();
+    }
+}
+
+template <typename T>
+void BasicCheckpointer<T>::_write(size_t snapshot)
+{
+    ARIADNE_TRACE_SCOPE("checkpoint", "write");
+    // The checksums of the pages on disk are only known after a first 
+    // write: a checkpointer starts with a full checkpoint.
+    bool const full = _mode == CheckpointMode::Full || _checksums.empty() 
+        || _since_full + 1 >= _full_interval;
+
+    T const* data = _snapshots[snapshot].data();
+    auto records = _records;
+    std::vector<T const*> blocks(_layers.size(), nullptr);
+    std::vector<ModelFormat::PageRecord> pages;
+    std::vector<uint64_t> checksums(_first_pages.back());
+    for (size_t i = 0; i < _layers.size(); ++i)
+    {
+        if (_offsets[i] == _none)
+        {
+            continue;
+        }
+        blocks[i] = data + _offsets[i];
+        size_t const bytes = records[i].block_size * sizeof(T);
+        records[i].checksum = ModelFormat::checksum(blocks[i], bytes);
+
+        auto const* block = reinterpret_cast<char const*>(blocks[i]);
+        for (uint64_t p = 0; p < ModelFormat::pages(bytes); ++p)
+        {
+            uint64_t& checksum = checksums[_first_pages[i] + p];
+            checksum = ModelFormat::checksum(block + p * ModelFormat::page_size,
+                ModelFormat::page_bytes(bytes, p));
+            if (!full && checksum != _checksums[_first_pages[i] + p])
+            {
+                pages.push_back({i, p, 0, checksum});
+            }
+        }
+    }
+
+    ModelFormat::Header header;
+    ModelFormat::layout<T>(header, records, full ? nullptr : &pages);
+
+    // Write aside, persist and publish with an atomic rename.
+    std::filesystem::path tmp = _path;
+    tmp += ".tmp";
+    {
+        std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+        ModelFormat::write(out, header, records, blocks, pages);
+    }
+    int fd = ::open(tmp.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        ::fsync(fd);
+        ::close(fd);
+    }
+    uint64_t sequence = _sequence++;
+    std::filesystem::rename(tmp, _file(sequence));
+
+    // Persist the rename itself: the directory entry lives in the parent.
+    std::filesystem::path dir = _path.parent_path();
+    fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0)
+    {
+        ::fsync(fd);
+        ::close(fd);
+    }
+
+    _checksums  = std::move(checksums);
+    _since_full = full ? 0 : _since_full + 1;
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _history.emplace_back(sequence, full);
+
+        // Keep the last checkpoints and the full one they start from.
+        if (_history.size() > _keep)
+        {
+            uint64_t oldest = _history[_history.size() - _keep].first;
+            uint64_t base = oldest;
+            for (auto& [s, f]: _history)
+            {
+                if (s <= oldest && f)
+                {
+                    base = s;
+                }
+            }
+            while (_history.front().first < base)
+            {
+                std::filesystem::remove(_file(_history.front().first));
+                _history.pop_front();
+            }
+        }
+    }
+}
+
+template <typename T>
+void BasicCheckpointer<T>::_rethrow()
+{
+    if (_error)
+    {
+        std::rethrow_exception(std::exchange(_error, nullptr));
+    }
+}
+
+template <typename T>
+std::filesystem::path BasicCheckpointer<T>::restore(BasicModel<T>& model, 
+    std::filesystem::path const& path)
+{
+    ARIADNE_TRACE_SCOPE("checkpoint", "restore");
+    auto sequences = _sequences(path);
+    if (sequences.empty())
+    {
+        throw std::runtime_error("no checkpoint " + path.string());
+    }
+
+    std::vector<BasicLayer<T>*> layers;
+    std::vector<std::vector<bool>> restored;
+    size_t missing = 0;
+    for (size_t i = 0; i < model.node_count(); ++i)
+    {
+        layers.push_back(&model.node(i));
+        size_t const pages = ModelFormat::pages(
+            layers.back()->param_block_size() * sizeof(T));
+        restored.emplace_back(pages, false);
+        missing += pages;
+    }
+
+    // Newest first: each page comes from the newest checkpoint storing it.
+    std::filesystem::path newest;
+    std::vector<uint64_t> checksums(layers.size(), 0);
+    for (auto it = sequences.rbegin(); it != sequences.rend(); ++it)
+    {
+        std::filesystem::path file = path;
+        file += ".";
+        file += std::to_string(*it);
+        std::ifstream in{file, std::ios::binary};
+
+        ModelFormat::Header header;
+        std::vector<ModelFormat::LayerRecord> records;
+        std::vector<ModelFormat::PageRecord> pages;
+        try
+        {
+            records = ModelFormat::read_records<T>(in, header);
+            pages   = ModelFormat::read_pages(in, header);
+        }
+        catch (std::runtime_error const& e)
+        {
+            throw std::runtime_error(file.string() + ": " + e.what());
+        }
+        auto indices = ModelFormat::check_records(header, records, layers, 
+            pages);
+        std::vector<size_t> layer_of(records.size(), ModelFormat::npos);
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            if (indices[i] != ModelFormat::npos)
+            {
+                layer_of[indices[i]] = i;
+            }
+        }
+        if (newest.empty())
+        {
+            // The blocks restored have to match the newest checkpoint.
+            newest = file;
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                if (indices[i] != ModelFormat::npos)
+                {
+                    checksums[i] = records[indices[i]].checksum;
+                }
+            }
+        }
+        auto corrupted = [&](size_t i)
+        {
+            return std::runtime_error("parameters of layer " 
+                + layers[i]->name() + " in " + file.string() 
+                + " are corrupted");
+        };
+
+        for (auto& page: pages)
+        {
+            size_t const i = layer_of[page.layer];
+            if (restored[i][page.page])
+            {
+                continue;
+            }
+            size_t const bytes = ModelFormat::page_bytes(
+                records[page.layer].block_size * sizeof(T), page.page);
+            char* data = reinterpret_cast<char*>(layers[i]->param(0)) 
+                + page.page * ModelFormat::page_size;
+            in.seekg(static_cast<std::streamoff>(page.offset));
+            in.read(data, static_cast<std::streamsize>(bytes));
+            if (!in || ModelFormat::checksum(data, bytes) != page.checksum)
+            {
+                throw corrupted(i);
+            }
+            restored[i][page.page] = true;
+            --missing;
+        }
+
+        // Whole blocks fill the pages not found in the newer checkpoints.
+        std::vector<char> block;
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            if (indices[i] == ModelFormat::npos 
+                || records[indices[i]].offset == 0
+                || std::find(restored[i].begin(), restored[i].end(), false) 
+                    == restored[i].end())
+            {
+                continue;
+            }
+            auto& record = records[indices[i]];
+            size_t const bytes = record.block_size * sizeof(T);
+            block.resize(bytes);
+            in.seekg(static_cast<std::streamoff>(record.offset));
+            in.read(block.data(), static_cast<std::streamsize>(bytes));
+            if (!in 
+                || ModelFormat::checksum(block.data(), bytes) 
+                    != record.checksum)
+            {
+                throw corrupted(i);
+            }
+            char* data = reinterpret_cast<char*>(layers[i]->param(0));
+            for (size_t p = 0; p < restored[i].size(); ++p)
+            {
+                if (!restored[i][p])
+                {
+                    size_t const offset = p * ModelFormat::page_size;
+                    std::copy_n(block.data() + offset, 
+                        ModelFormat::page_bytes(bytes, p), data + offset);
+                    restored[i][p] = true;
+                    --missing;
+                }
+            }
+        }
+
+        if (missing == 0)
+        {
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                if (!restored[i].empty() 
+                    && ModelFormat::checksum(layers[i]->param(0), 
+                        layers[i]->param_block_size() * sizeof(T)) 
+                        != checksums[i])
+                {
+                    throw std::runtime_error("checkpoint " + newest.string() 
+                        + " does not match the checkpoints of its chain");
+                }
+            }
+            return newest;
+        }
+    }
+    throw std::runtime_error("checkpoints " + path.string() + " miss the "
+                             "full checkpoint of their chain");
+}
+
+template <typename T>
+std::vector<uint64_t> BasicCheckpointer<T>::_sequences(
+    std::filesystem::path const& path)
+{
+    std::filesystem::path dir = path.parent_path();
+    if (dir.empty())
+    {
+        dir = ".";
+    }
+    std::string prefix = path.filename().string() + ".";
+
+    std::vector<uint64_t> sequences;
+    if (!std::filesystem::is_directory(dir))
+    {
+        return sequences;
+    }
+    for (auto& entry: std::filesystem::directory_iterator{dir})
+    {
+        std::string name = entry.path().filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), 
+            prefix) != 0)
+        {
+            continue;
+        }
+        std::string suffix = name.substr(prefix.size());
+        if (suffix.find_first_not_of("0123456789") == std::string::npos)
+        {
+            sequences.push_back(std::stoull(suffix));
+        }
+    }
+    std::sort(sequences.begin(), sequences.end());
+    return sequences;
+}
+
+template <typename T>
+std::filesystem::path BasicCheckpointer<T>::_file(uint64_t sequence) const
+{
+    std::filesystem::path file = _path;
+    file += ".";
+    file += std::to_string(sequence);
+    return file;
+}
+
+template class BasicCheckpointer<float>;
+template class BasicCheckpointer<double>;
+
+} // namespace Ariadne
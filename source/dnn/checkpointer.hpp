@@ -0,0 +1,203 @@
+/***************************************************************************
+ *            checkpointer.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file checkpointer.hpp
+ *  \brief Asynchronous checkpoints of the model parameters.
+ */
+
+#ifndef ARIADNE_DNN_CHECKPOINTER_HPP
+#define ARIADNE_DNN_CHECKPOINTER_HPP
+
+#include "aligned_allocator.hpp"
+#include "model.hpp"
+#include "model_format.hpp"
+#include "type.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace Ariadne {
+
+enum class CheckpointMode
+{
+    Full,  ///< Every checkpoint stores all the parameter blocks.
+    Delta  ///< Checkpoints store the pages changed since the previous one.
+};
+
+/**
+ * \brief Write checkpoints of a model from a background thread.
+ *
+ * checkpoint() copies the parameters in one of two snapshot buffers and 
+ * returns: the training thread never waits for the disk. If a snapshot is 
+ * still waiting to be written when the next one is taken, the newest one 
+ * replaces it.
+ *
+ * Checkpoints are written in the model file format to "<path>.<sequence>", 
+ * through a temporary file renamed once complete, so that a checkpoint is 
+ * either absent or whole. Only the last keep checkpoints, and the older 
+ * ones they depend on in delta mode, are kept; the checkpoints found on 
+ * disk at construction take part in the rotation.
+ *
+ * In delta mode the parameter blocks are compared in pages of 
+ * ModelFormat::page_size bytes, and a checkpoint stores only the pages 
+ * whose checksum changed since the previous checkpoint; every 
+ * full_interval checkpoints a full one is written to bound the chain read 
+ * by restore(). Frozen layers, sparse updates and parameters that 
+ * converged are not written again.
+ */
+template <typename T>
+class BasicCheckpointer
+{
+public:
+    /**
+     * \brief Construct a new BasicCheckpointer object.
+     * \param model         Model to checkpoint, it has to outlive the 
+     *                      checkpointer and keep its topology.
+     * \param path          Path of the checkpoints, without sequence.
+     * \param keep          Amount of checkpoints kept.
+     * \param mode          Full or incremental checkpoints.
+     * \param full_interval In delta mode, checkpoints between two full ones.
+     */
+    BasicCheckpointer(BasicModel<T>& model, std::filesystem::path path, 
+        size_t keep = 3, CheckpointMode mode = CheckpointMode::Full, 
+        size_t full_interval = 8);
+
+    /**
+     * \brief Write the pending snapshot, if any, and stop the writer.
+     */
+    ~BasicCheckpointer();
+
+    BasicCheckpointer(BasicCheckpointer const&) = delete;
+    BasicCheckpointer& operator=(BasicCheckpointer const&) = delete;
+
+    /**
+     * \brief Snapshot the current parameters and queue them for writing. 
+     * It has to be called from the thread that trains the model, between 
+     * two updates. Errors of previous writes are rethrown here.
+     */
+    void checkpoint();
+
+    /**
+     * \brief Wait until all the snapshots taken have been written. Errors 
+     * of the writes are rethrown here.
+     */
+    void flush();
+
+    /**
+     * \brief Amount of checkpoints written.
+     * \return size_t
+     */
+    [[nodiscard]] size_t written() const;
+
+    /**
+     * \brief Path of the last checkpoint written, empty if none.
+     * \return std::filesystem::path
+     */
+    [[nodiscard]] std::filesystem::path last() const;
+
+    /**
+     * \brief Load the newest checkpoint of a path in a model, following the 
+     * chain of incremental checkpoints back to a full one.
+     * \param model Model with the checkpointed topology.
+     * \param path  Path of the checkpoints, without sequence.
+     * \return std::filesystem::path The newest checkpoint.
+     */
+    static std::filesystem::path restore(BasicModel<T>& model, 
+        std::filesystem::path const& path);
+
+private:
+    static constexpr size_t _none = static_cast<size_t>(-1);
+
+    /**
+     * \brief Body of the writer thread.
+     */
+    void _loop();
+
+    /**
+     * \brief Write a snapshot as the next checkpoint and rotate the files.
+     * \param snapshot Index of the snapshot buffer.
+     */
+    void _write(size_t snapshot);
+
+    /**
+     * \brief Rethrow the error of the writer thread, if any. The mutex 
+     * has to be locked.
+     */
+    void _rethrow();
+
+    /**
+     * \brief Sequences of the checkpoints of a path, in increasing order.
+     * \param path
+     * \return std::vector<uint64_t> 
+     */
+    static std::vector<uint64_t> _sequences(std::filesystem::path const& path);
+
+    /**
+     * \brief Path of a checkpoint.
+     * \param sequence
+     * \return std::filesystem::path 
+     */
+    std::filesystem::path _file(uint64_t sequence) const;
+
+    BasicModel<T>& _model;
+    std::filesystem::path _path;
+    size_t _keep;
+    CheckpointMode _mode;
+    size_t _full_interval;
+
+    std::vector<BasicLayer<T>*> _layers;            ///< Layers with params.
+    std::vector<size_t> _offsets;                   ///< Layer in snapshot.
+    std::vector<size_t> _first_pages;               ///< First page of layer.
+    std::vector<ModelFormat::LayerRecord> _records; ///< Layers description.
+    AlignedVector<T> _snapshots[2];                 ///< Double buffer.
+    std::vector<uint64_t> _checksums;               ///< Last written pages.
+
+    uint64_t _sequence{0};                          ///< Next sequence.
+    size_t _since_full{0};                          ///< Deltas since full.
+    std::deque<std::pair<uint64_t, bool>> _history; ///< Sequence, full.
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    size_t _pending{_none};                         ///< Snapshot to write.
+    size_t _writing{_none};                         ///< Snapshot in write.
+    size_t _written{0};
+    bool _stop{false};
+    std::exception_ptr _error;
+    std::thread _thread;
+};
+
+using Checkpointer = BasicCheckpointer<NumType>;
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_CHECKPOINTER_HPP
@@ -28,37 +28,54 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <stdexcept>
 
 namespace Ariadne {
 
-DenseLayer::DenseLayer(Model& model, std::string name, Activation activation, 
-    uint16_t output_size, uint16_t input_size)
-    : Layer(model, std::move(name))
+template <typename T>
+BasicDenseLayer<T>::BasicDenseLayer(BasicModel<T>& model, std::string name, 
+    Activation activation, uint16_t output_size, uint16_t input_size)
+    : BasicLayer<T>(model, std::move(name))
     , _activation{activation}
     , _output_size{output_size}
     , _input_size{input_size}
 {
     std::printf("%s: %d -> %d\n", _name.c_str(), _input_size, _output_size);
 
-    // The weight parameters of a FF-layer are an NxM matrix.
-    _weights.resize(_output_size * _input_size);
-
-    // Each node in this layer is assigned a bias.
-    _biases.resize(_output_size);
+    /*
+     * The weight parameters of a FF-layer are an NxM matrix and each node in 
+     * this layer is assigned a bias. Both are kept in a single block, so that
+     * the layer can be bound to an external parameter buffer.
+     */
+    _params.resize(param_block_size());
+    bind_params(_params.data());
 
-    // The outputs of each neuron within the layer is an "activation".
-    _activations.resize(_output_size);
+    /*
+     * Gradients accumulate over a mini-batch and are owned by the layer; 
+     * the activations and the per-sample gradients are transient buffers 
+     * bound by the Model. Layers of an inference model have no gradients.
+     */
+    if (!_inference)
+    {
+        _gradients.resize(param_block_size());
+        _weight_gradients = _gradients.data();
+        _bias_gradients   = _weight_gradients 
+            + bias_offset(_output_size, _input_size);
+    }
+}
 
-    _activation_gradients.resize(_output_size);
-    _weight_gradients.resize(_output_size * _input_size);
-    _bias_gradients.resize(_output_size);
-    _input_gradients.resize(_input_size);
+template <typename T>
+void BasicDenseLayer<T>::init(RneType& rne)
+{
+    init_params(_activation, _output_size, _input_size, _weights, rne);
 }
 
-void DenseLayer::init(RneType& rne)
+template <typename T>
+void BasicDenseLayer<T>::init_params(Activation activation, 
+    size_t output_size, size_t input_size, T* params, RneType& rne)
 {
-    NumType sigma;
-    switch (_activation)
+    T sigma;
+    switch (activation)
     {
         case Activation::ReLU:
         {   
@@ -67,7 +84,7 @@ void DenseLayer::init(RneType& rne)
              * https://arxiv.org/pdf/1502.01852.pdf
              * Nrmal distribution with variance := sqrt( 2 / n_in )
              */
-            sigma = std::sqrt(2.0 / static_cast<NumType>(_input_size));
+            sigma = std::sqrt(2.0 / static_cast<T>(input_size));
             break;
         }
         case Activation::Softmax:
@@ -79,7 +96,7 @@ void DenseLayer::init(RneType& rne)
              * https://arxiv.org/pdf/1706.02515.pdf
              * Normal distribution with variance := sqrt( 1 / n_in )
              */
-            sigma = std::sqrt(1.0 / static_cast<NumType>(_input_size));
+            sigma = std::sqrt(1.0 / static_cast<T>(input_size));
             break;
         }
     }
@@ -90,11 +107,12 @@ void DenseLayer::init(RneType& rne)
      * different compilers and platforms, therefore I use my own 
      * distributions to provide deterministic results.
      */
-    auto dist = DLMath::normal_pdf<NumType>(0.0, sigma);
+    auto dist = DLMath::normal_pdf<T>(0.0, sigma);
 
-    for (NumType& w: _weights)
+    T* weights = params;
+    for (size_t i = 0; i < output_size * input_size; ++i)
     {
-        w = dist(rne);
+        weights[i] = dist(rne);
     }
 
     /*
@@ -103,37 +121,49 @@ void DenseLayer::init(RneType& rne)
      * that a non-zero bias will ensure that the neuron always "fires" at 
      * the beginning to produce a signal.
      */
-    for (NumType& b: _biases)
+    T* biases = params + bias_offset(output_size, input_size);
+    for (size_t i = 0; i < output_size; ++i)
     {
-        b = 0.01; ///< You can try also with 0.0 or other strategies.
+        biases[i] = 0.01; ///< You can try also with 0.0 or other strategies.
     }
+
+    // The padding after the weights and the biases.
+    std::fill(weights + output_size * input_size, biases, T{0.0});
+    std::fill(biases + output_size, 
+        params + param_block_size(output_size, input_size), T{0.0});
 }
 
-void DenseLayer::forward(NumType* inputs) 
+template <typename T>
+void BasicDenseLayer<T>::forward(BasicTensorView<T const> inputs) 
 {
+    this->_check_size(inputs, _input_size, "inputs");
+
     // Remember the last input data for backpropagation.
-    _last_input = inputs;
+    if (!_inference)
+    {
+        _last_input = inputs;
+    }
 
     /* 
      * Compute the product of the input data with the weight add the bias.
      * z = W * x + b
      */
-    DLMath::matarr_mul<NumType>(_activations.data(), _weights.data(), inputs, 
-        _output_size, _input_size);
-    DLMath::arr_sum<NumType>(_activations.data(), _activations.data(), 
-        _biases.data(), _output_size);
+    DLMath::matarr_mul<T>({_activations, _output_size}, 
+        {_weights, _output_size, _input_size, _input_size}, inputs);
+    DLMath::arr_sum<T>(_activations, _activations, 
+        _biases, _output_size);
 
     switch (_activation)
     {
         case Activation::ReLU:
         {
-            DLMath::relu<NumType>(_activations.data(), _activations.data(), 
+            DLMath::relu<T>(_activations, _activations, 
                 size_t(_output_size));
             break;
         }
         case Activation::Softmax:
         {
-            DLMath::softmax<NumType>(_activations.data(), _activations.data(), 
+            DLMath::softmax<T>(_activations, _activations, 
                 size_t(_output_size));
             break;
         }
@@ -144,16 +174,18 @@ void DenseLayer::forward(NumType* inputs)
             break;
         }
     }
+}
 
-    // Forward to the next layers.
-    for (auto *layer: this->_subsequents)
+template <typename T>
+void BasicDenseLayer<T>::reverse(BasicTensorView<T const> gradients)
+{
+    if (gradients.empty())
     {
-        layer->forward(_activations.data());
+        throw std::runtime_error("layer " + _name + " has no subsequent "
+                                 "layers to receive gradients from");
     }
-}
+    this->_check_size(gradients, _output_size, "gradients");
 
-void DenseLayer::reverse(NumType* gradients)
-{
     // Calculate dg(z)/dz and put in _activation_gradients.
     switch (_activation)
     {
@@ -167,9 +199,9 @@ void DenseLayer::reverse(NumType* gradients)
              * viceversa, using ReLU of vector z or using directly the vector z
              * there is no differences.  
              */
-            DLMath::relu_1<NumType>(
-                _activation_gradients.data(), 
-                _activations.data(), 
+            DLMath::relu_1<T>(
+                _activation_gradients, 
+                _activations, 
                 _output_size);
             break;
         }
@@ -179,53 +211,58 @@ void DenseLayer::reverse(NumType* gradients)
              * The softmax derivation explits the calculus of softmax performed 
              * previously and saved in _activations vector.
              */
-            DLMath::softmax_1_opt<NumType>(
-                _activation_gradients.data(),
-                _activations.data(), 
+            DLMath::softmax_1_opt<T>(
+                _activation_gradients,
+                _activations, 
                 _output_size);
             break;
         }
         case Activation::Linear:
         default:
         {
-            std::fill(_activation_gradients.begin(), 
-                _activation_gradients.end(), NumType{1.0});
+            std::fill_n(_activation_gradients, _output_size, T{1.0});
             break;
         }
     }
 
     // Calculate dJ/dz = dJ/dg(z) * dg(z)/dz.
-    DLMath::arr_mul(_activation_gradients.data(), _activation_gradients.data(),
-        gradients, _output_size);
+    DLMath::arr_mul<T>({_activation_gradients, _output_size}, 
+        {_activation_gradients, _output_size}, gradients);
 
-    /*
-     * Bias gradient.
-     * Calculate dJ/db = dJ/dg(z) * dg(z)/db
-     *                 = dJ/dg(z) * dg(z)/dz * dz/db            <- z = Wx+b
-     *                 = dJ/dg(z) * dg(Wx+b)/dz * d(Wx+b)/db 
-     *                 = dJ/dg(z) * dg(Wx+b)/dz * 1
-     *                 = dJ/dg(z) * dg(z)/dz
-     *                 = dJ/dz
-     */
-    DLMath::arr_sum(_bias_gradients.data(), _bias_gradients.data(), 
-        _activation_gradients.data(), _output_size);
+    // Frozen layers keep their parameter gradients untouched.
+    if (_trainable)
+    {
+        /*
+         * Bias gradient.
+         * Calculate dJ/db = dJ/dg(z) * dg(z)/db
+         *                 = dJ/dg(z) * dg(z)/dz * dz/db            <- z = Wx+b
+         *                 = dJ/dg(z) * dg(Wx+b)/dz * d(Wx+b)/db 
+         *                 = dJ/dg(z) * dg(Wx+b)/dz * 1
+         *                 = dJ/dg(z) * dg(z)/dz
+         *                 = dJ/dz
+         */
+        DLMath::arr_sum(_bias_gradients, _bias_gradients, 
+            _activation_gradients, _output_size);
 
-    /*
-     * Weight gradient.
-     * Calculate dJ/dw_i_j = dJ/dg(z) * dg(z)/dw_i_j
-     *                     = dJ/dg(z) * dg(z)/dz * dz/dw_i_j    <- z = Wx+b
-     *                     = dJ/dg(z) * dg(Wx+b)/dz * d(Wx+b)/dw_i_j 
-     *                     = dJ/dg(z) * dg(Wx+b)/dz * x_j
-     *                     = dJ/dg(z) * dg(z)/dz * x_j
-     *                     = dJ/dz * x_j
-     */
-    for (size_t i = 0; i < _output_size; ++i)
+        /*
+         * Weight gradient.
+         * Calculate dJ/dw_i_j = dJ/dg(z) * dg(z)/dw_i_j
+         *                     = dJ/dg(z) * dg(z)/dz * dz/dw_i_j    <- z = Wx+b
+         *                     = dJ/dg(z) * dg(Wx+b)/dz * d(Wx+b)/dw_i_j 
+         *                     = dJ/dg(z) * dg(Wx+b)/dz * x_j
+         *                     = dJ/dg(z) * dg(z)/dz * x_j
+         *                     = dJ/dz * x_j
+         */
+        ScratchScope scratch;
+        DLMath::outer_sum(_weight_gradients, _activation_gradients, 
+            DLMath::contiguous(_last_input, scratch), _output_size, 
+            _input_size);
+    }
+
+    // The Model binds no input gradient when no antecedent needs it.
+    if (_input_gradients == nullptr)
     {
-        for (size_t j = 0; j < _input_size; ++j)
-        {
-            _weight_gradients[(i * _input_size) + j] += 
-                _activation_gradients[i] * _last_input[j];
-        }
+        return;
     }
 
     /* 
@@ -237,41 +274,117 @@ void DenseLayer::reverse(NumType* gradients)
      *                 = dJ/dg(z) * dg(z)/dz * W
      *                 = dJ/dz * W
      */
-    std::fill(_input_gradients.begin(), _input_gradients.end(), 0);
-    for (size_t i = 0; i < _output_size; ++i)
-    {
-        for (size_t j = 0; j < _input_size; ++j)
-        {
-            _input_gradients[j] += 
-                _activation_gradients[i] * _weights[(i * _input_size) + j];
-        }
-    }
+    DLMath::transposed_matarr_mul(_input_gradients, _weights, 
+        _activation_gradients, _output_size, _input_size);
+}
+
+template <typename T>
+T* BasicDenseLayer<T>::param(size_t index)
+{
+    return &_weights[_block_index(index)];
+}
+
+template <typename T>
+T* BasicDenseLayer<T>::gradient(size_t index)
+{
+    return _inference ? nullptr : &_weight_gradients[_block_index(index)];
+}
+
+template <typename T>
+void BasicDenseLayer<T>::bind_buffers(BasicLayerBuffers<T> const& buffers)
+{
+    _activations          = buffers.output;
+    _activation_gradients = buffers.scratch;
+    _input_gradients      = buffers.input_gradient;
+}
+
+template <typename T>
+void BasicDenseLayer<T>::bind_params(T* params)
+{
+    _weights = params;
+    _biases  = _weights + bias_offset(_output_size, _input_size);
 
-    for (auto *l: _antecedents)
+    // The own storage is not used anymore.
+    if (params != _params.data())
     {
-        l->reverse(_input_gradients.data());
+        AlignedVector<T>{}.swap(_params);
     }
 }
 
-NumType* DenseLayer::param(size_t index)
+template <typename T>
+void BasicDenseLayer<T>::drop_training_state()
 {
-    if (index < _weights.size())
+    BasicLayer<T>::drop_training_state();
+    AlignedVector<T>{}.swap(_gradients);
+    _weight_gradients     = nullptr;
+    _bias_gradients       = nullptr;
+    _activation_gradients = nullptr;
+    _input_gradients      = nullptr;
+    _last_input           = {};
+}
+
+template <typename T>
+std::unique_ptr<BasicLayer<T>> BasicDenseLayer<T>::clone(
+    BasicModel<T>& model) const
+{
+    auto layer = std::make_unique<BasicDenseLayer>(model, _name, _activation, 
+        _output_size, _input_size);
+    std::copy(_weights, _weights + param_block_size(), layer->_weights);
+    return layer;
+}
+
+template <typename T>
+LayerCost BasicDenseLayer<T>::cost(Phase phase) const noexcept
+{
+    double const value   = sizeof(T);
+    double const inputs  = _input_size;
+    double const outputs = _output_size;
+    double const weights = inputs * outputs;
+    if (phase == Phase::Forward)
+    {
+        // Product, bias and activation.
+        return {2.0 * weights + 2.0 * outputs, 
+            value * (weights + inputs + 2.0 * outputs)};
+    }
+    if (phase == Phase::Reverse)
     {
-        return &_weights[index];
+        // Activation derivative, weight gradients and input gradients.
+        double const gradients = _trainable ? 2.0 * weights : 0.0;
+        return {2.0 * weights + gradients + 3.0 * outputs, 
+            value * (weights + gradients + 2.0 * inputs + 4.0 * outputs)};
     }
-    return &_biases[index - _weights.size()];
+    return BasicLayer<T>::cost(phase);
 }
 
-NumType* DenseLayer::gradient(size_t index)
+template <typename T>
+std::string BasicDenseLayer<T>::type() const
 {
-    if (index < _weight_gradients.size())
+    return type_name(_activation);
+}
+
+template <typename T>
+std::string BasicDenseLayer<T>::type_name(Activation activation)
+{
+    switch (activation)
     {
-        return &_weight_gradients[index];
+        case Activation::ReLU:
+        {
+            return "dense.relu";
+        }
+        case Activation::Softmax:
+        {
+            return "dense.softmax";
+        }
+        case Activation::Linear:
+        default:
+        {
+            return "dense.linear";
+        }
     }
-    return &_bias_gradients[index - _weight_gradients.size()];
 }
 
-void DenseLayer::print() const 
+template <typename T>
+void BasicDenseLayer<T>::print() const 
 {
     std::printf("%s\n", _name.c_str());
 
@@ -293,4 +406,7 @@ void DenseLayer::print() const
     std::printf("\n");
 }
 
+template class BasicDenseLayer<float>;
+template class BasicDenseLayer<double>;
+
 } // namespace Ariadne
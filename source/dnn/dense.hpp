@@ -29,8 +29,10 @@
 #ifndef ARIADNE_DNN_DENSE_HPP
 #define ARIADNE_DNN_DENSE_HPP
 
+#include "aligned_allocator.hpp"
 #include "layer.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -44,11 +46,16 @@ enum class Activation
     Linear
 };
 
-class DenseLayer : public Layer 
+/**
+ * \brief Fully connected layer with an activation.
+ * \tparam T Scalar type of the model.
+ */
+template <typename T>
+class BasicDenseLayer : public BasicLayer<T> 
 {
 public: 
-    DenseLayer(Model& model, std::string name, Activation activation, 
-        uint16_t output_size, uint16_t input_size);
+    BasicDenseLayer(BasicModel<T>& model, std::string name, 
+        Activation activation, uint16_t output_size, uint16_t input_size);
 
     void init(RneType& rne) override;
 
@@ -56,7 +63,7 @@ public:
      * \brief The input data should have size _input_size.
      * \param inputs
      */
-    void forward(NumType* inputs) override;
+    void forward(BasicTensorView<T const> inputs) override;
 
     /**
      * \brief The gradient data should have size _output_size.
@@ -66,7 +73,20 @@ public:
      * _activation_gradients.
      * \param gradients
      */
-    void reverse(NumType* gradients) override;
+    void reverse(BasicTensorView<T const> gradients) override;
+
+    T* output() override { return _activations; }
+    T* input_gradient() override { return _input_gradients; }
+    size_t input_size() const noexcept override { return _input_size; }
+    size_t output_size() const noexcept override { return _output_size; }
+
+    /**
+     * \brief The scratch holds the activation gradients.
+     * \return size_t
+     */
+    size_t scratch_size() const noexcept override { return _output_size; }
+
+    void bind_buffers(BasicLayerBuffers<T> const& buffers) override;
 
     /**
      * \brief Weight matrix entries + bias entries.
@@ -77,45 +97,161 @@ public:
         return (_input_size + 1UL) * _output_size;
     }
 
-    NumType* param(size_t index) override;
-    NumType* gradient(size_t index) override;
+    /**
+     * \brief Weights and biases with their padding, see the static 
+     * param_block_size().
+     * \return size_t
+     */
+    size_t param_block_size() const noexcept override
+    {
+        return param_block_size(_output_size, _input_size);
+    }
+
+    T* param(size_t index) override;
+    T* gradient(size_t index) override;
+    void bind_params(T* params) override;
+    void drop_training_state() override;
+
+    std::unique_ptr<BasicLayer<T>> clone(BasicModel<T>& model) const override;
 
+    Activation activation() const noexcept { return _activation; }
+
+    /**
+     * \brief Weights, _output_size x _input_size row-major.
+     * \return T const*
+     */
+    T const* weights() const noexcept { return _weights; }
+    T const* biases() const noexcept { return _biases; }
+
+    LayerCost cost(Phase phase) const noexcept override;
+    std::string type() const override;
     void print() const override;
 
+    /**
+     * \brief Type name of the dense layers with an activation, as returned 
+     * by type().
+     * \param activation
+     * \return std::string
+     */
+    static std::string type_name(Activation activation);
+
+    /**
+     * \brief Offset of the biases in the parameter block of a DenseLayer: 
+     * the weights are padded to a cache line, so that the biases start on 
+     * one as the weights do.
+     * \param output_size
+     * \param input_size
+     * \return size_t
+     */
+    static constexpr size_t bias_offset(size_t output_size, 
+        size_t input_size) noexcept
+    {
+        return _padded(output_size * input_size);
+    }
+
+    /**
+     * \brief Size of the parameter block of a DenseLayer: weights and 
+     * biases, each one padded to a cache line. The padding values are zero 
+     * and have zero gradients, so they never change. Parameter index i of 
+     * param() is at offset i of the block for the weights, and at offset
+     * i + bias_offset() - output_size * input_size for the biases.
+     * \param output_size
+     * \param input_size
+     * \return size_t
+     */
+    static constexpr size_t param_block_size(size_t output_size, 
+        size_t input_size) noexcept
+    {
+        return bias_offset(output_size, input_size) + _padded(output_size);
+    }
+
+    /**
+     * \brief Initialize a parameter block laid out as the one of a 
+     * DenseLayer: weights followed by biases, at bias_offset().
+     * \param activation  Activation, it selects the weight distribution.
+     * \param output_size
+     * \param input_size
+     * \param params      Block of param_block_size() entries.
+     * \param rne         Random number engine.
+     */
+    static void init_params(Activation activation, size_t output_size, 
+        size_t input_size, T* params, RneType& rne);
+
 private:
+    /**
+     * \brief Round a count of values up to a multiple of a cache line.
+     * \param count
+     * \return size_t
+     */
+    static constexpr size_t _padded(size_t count) noexcept
+    {
+        constexpr size_t line = AlignedStorage::alignment / sizeof(T);
+        return (count + line - 1) / line * line;
+    }
+
+    /**
+     * \brief Offset in the parameter block of a parameter index.
+     * \param index
+     * \return size_t
+     */
+    size_t _block_index(size_t index) const noexcept
+    {
+        size_t const weights = size_t{_output_size} * _input_size;
+        return index < weights 
+            ? index 
+            : index - weights + bias_offset(_output_size, _input_size);
+    }
+
+    using BasicLayer<T>::_name;
+    using BasicLayer<T>::_inference;
+    using BasicLayer<T>::_trainable;
+
     Activation _activation;
     uint16_t _output_size;
     uint16_t _input_size;
 
     // == Layer parameters ==
+    /**
+     * \brief Storage of the parameters: weights followed by biases, both 
+     * aligned to a cache line. It is unused when the parameters are bound 
+     * to an external buffer.
+     */
+    AlignedVector<T> _params;
     /// \brief Weights of the layer. Size: _output_size * _input_size.
-    std::vector<NumType> _weights;
+    T* _weights;
     /// \brief Biases of the layer. Size: _output_size. 
-    std::vector<NumType> _biases;
-    /// \brief Activations of the layer. Size: _output_size. 
-    std::vector<NumType> _activations;
+    T* _biases;
+    /// \brief Activations of the layer, bound by the Model. Size: _output_size.
+    T* _activations{nullptr};
 
     // == Loss Gradients ==
+    /// \brief Storage of the gradients, with the same layout of _params.
+    AlignedVector<T> _gradients;
     /// \brief Weight gradients of the layer. Size: _output_size * _input_size.
-    std::vector<NumType> _weight_gradients;
+    T* _weight_gradients{nullptr};
     /// \brief Biase gradients of the layer. Size: _output_size. 
-    std::vector<NumType> _bias_gradients;
-    /// \brief Activation gradients of the layer. Size: _output_size. 
-    std::vector<NumType> _activation_gradients;
+    T* _bias_gradients{nullptr};
+    /**
+     * \brief Activation gradients of the layer, bound by the Model to the 
+     * reverse scratch. Size: _output_size. 
+     */
+    T* _activation_gradients{nullptr};
     /**
      * \brief Input gradients of the layer. Size: _input_size. 
      * This buffer is used to store temporary gradients used in a **singe** 
      * backpropagation pass. Note that this doed not accumulate like the weight 
-     * and bias gradients do.
+     * and bias gradients do. It is bound by the Model.
      */
-    std::vector<NumType> _input_gradients;
+    T* _input_gradients{nullptr};
     /**
      * \brief The last input passed to the layer. It is needed to compute loss 
      * gradients with respect to the weights during backpropagation.
      */
-    NumType* _last_input;
+    BasicTensorView<T const> _last_input;
 };
 
+using DenseLayer = BasicDenseLayer<NumType>;
+
 } // namespace Ariadne
 
 #endif // ARIADNE_DNN_DENSE_HPP
@@ -34,9 +34,16 @@
 #include <algorithm>
 #include <iterator>
 #include <limits>
+#include <string>
+#include <type_traits>
 
 #include <iostream>
 
+#include "scratch_arena.hpp"
+#include "tensor_view.hpp"
+#include "thread_pool.hpp"
+#include "type.hpp"
+
 #ifndef ARIADNE_DL_DLMATH_HPP
 #define ARIADNE_DL_DLMATH_HPP
 
@@ -48,6 +55,31 @@ public:
     static constexpr RneType::result_type max_rand = 
         std::numeric_limits<RneType::result_type>::max();
 
+    /**
+     * \brief Minimum amount of multiply-adds for a matrix kernel to be split
+     * on the global ThreadPool. Smaller calls run serially.
+     */
+    static constexpr size_t parallel_threshold = 1UL << 16;
+
+    /**
+     * \brief Minimum amount of multiply-adds of a chunk of rows run by a 
+     * thread of the pool.
+     */
+    static constexpr size_t parallel_grain = 1UL << 13;
+
+    /**
+     * \brief Largest bytes of a column block of transposed_matarr_mul(), 
+     * that stays in the L1 cache.
+     */
+    static constexpr size_t transposed_block_bytes = 1UL << 14;
+
+    /**
+     * \brief Smallest bytes of a column block of transposed_matarr_mul(): 
+     * the segments of the matrix rows read for a block stay long enough 
+     * for the L2 streaming prefetcher.
+     */
+    static constexpr size_t transposed_min_block_bytes = 1UL << 9;
+
     /**
      * \brief Gaussian Probability Density Function.
      * \tparam T      Input and output type.
@@ -59,7 +91,7 @@ public:
     template <typename T>
     static std::function<T(RneType&)> normal_pdf(double mean, double std_dev)
     {
-        T std_dev_coverage = T{3.0 * std_dev};
+        T std_dev_coverage = static_cast<T>(3.0 * std_dev);
         
         std::function<T(RneType&)> ret = 
             [std_dev_coverage, mean](RneType& x) 
@@ -130,14 +162,141 @@ public:
                                      "in order to perform matarr_mul");
         }
 
-        for (size_t i = 0; i < rows; ++i)
+        _parallel_rows(rows, cols, [=](size_t first, size_t last)
         {
-            arr_dst[i] = T{0};
-            for (size_t j = 0; j < cols; ++j)
+            for (size_t i = first; i < last; ++i)
+            {
+                arr_dst[i] = T{0};
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    arr_dst[i] += mat_src[(i * cols) + j] * arr_src[j];
+                }
+            }
+        });
+        return arr_dst;
+    }
+
+    /**
+     * \brief Accumulate the outer product of two arrays in a matrix.
+     * Used for dW += dz * x^T
+     * \tparam T      Type of each source and destination elements.
+     * \param mat_dst Matrix destination, rows x cols, to accumulate into.
+     * \param arr_row Array source of length rows, left operand.
+     * \param arr_col Array source of length cols, right operand.
+     * \param rows    Amount of rows.
+     * \param cols    Amount of columns.
+     * \return T* The destination matrix pointer.
+     */
+    template <typename T>
+    static T* outer_sum(T* mat_dst, const T* arr_row, const T* arr_col, 
+        size_t rows, size_t cols)
+    {
+        _parallel_rows(rows, cols, [=](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; ++i)
             {
-                arr_dst[i] += mat_src[(i * cols) + j] * arr_src[j];
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    mat_dst[(i * cols) + j] += arr_row[i] * arr_col[j];
+                }
             }
+        });
+        return mat_dst;
+    }
+
+    /**
+     * \brief Width in columns of the blocks of transposed_matarr_mul(). 
+     * Matrices large enough to be split on the global ThreadPool get a 
+     * block for each thread, within transposed_min_block_bytes and 
+     * transposed_block_bytes; the others a single block as wide as the L1 
+     * cache allows.
+     * \tparam T   Type of the matrix elements.
+     * \param rows Amount of rows.
+     * \param cols Amount of columns.
+     * \return size_t
+     */
+    template <typename T>
+    static size_t transposed_block(size_t rows, size_t cols)
+    {
+        size_t const max = transposed_block_bytes / sizeof(T);
+        if (rows * cols < parallel_threshold)
+        {
+            return max;
+        }
+        size_t const min = transposed_min_block_bytes / sizeof(T);
+        size_t const threads = ThreadPool::global().size() + 1;
+        size_t const share = (cols + threads - 1) / threads;
+        return std::clamp((share + min - 1) / min * min, min, max);
+    }
+
+    /**
+     * \brief Multiply the transpose of a matrix with an array.
+     * Used for dJ/dx = W^T * dJ/dz
+     * The columns are split in blocks of transposed_block() columns: a block
+     * of the destination stays in cache while the rows of the matrix stream
+     * through it, four at a time, and each block is computed by a single 
+     * thread, so results do not depend on the split.
+     * \tparam T      Type of each source and destination elements.
+     * \param arr_dst Array destination of length cols to write the result.
+     * \param mat_src Matrix source, rows x cols row-major.
+     * \param arr_src Array source of length rows.
+     * \param rows    Amount of rows.
+     * \param cols    Amount of columns.
+     * \return T* The destination array pointer.
+     */
+    template <typename T>
+    static T* transposed_matarr_mul(T* arr_dst, const T* mat_src, 
+        const T* arr_src, size_t rows, size_t cols)
+    {
+        if (arr_src == arr_dst) 
+        {
+            throw std::runtime_error("arr_src, arr_dst have to be different "
+                                     "in order to perform "
+                                     "transposed_matarr_mul");
         }
+
+        // Each block costs rows times its width multiply-adds.
+        size_t const block = transposed_block<T>(rows, cols);
+        size_t const blocks = (cols + block - 1) / block;
+        _parallel_rows(blocks, rows * std::min(block, cols), 
+            [=](size_t first, size_t last)
+        {
+            for (size_t b = first; b < last; ++b)
+            {
+                size_t const begin = b * block;
+                size_t const end = std::min(begin + block, cols);
+                T* dst = arr_dst + begin;
+                size_t const width = end - begin;
+                std::fill_n(dst, width, T{0});
+
+                size_t i = 0;
+                for (; i + 4 <= rows; i += 4)
+                {
+                    const T* r0 = mat_src + (i * cols) + begin;
+                    const T* r1 = r0 + cols;
+                    const T* r2 = r1 + cols;
+                    const T* r3 = r2 + cols;
+                    T const a0 = arr_src[i];
+                    T const a1 = arr_src[i + 1];
+                    T const a2 = arr_src[i + 2];
+                    T const a3 = arr_src[i + 3];
+                    for (size_t j = 0; j < width; ++j)
+                    {
+                        dst[j] += (a0 * r0[j]) + (a1 * r1[j]) 
+                            + (a2 * r2[j]) + (a3 * r3[j]);
+                    }
+                }
+                for (; i < rows; ++i)
+                {
+                    const T* r = mat_src + (i * cols) + begin;
+                    T const a = arr_src[i];
+                    for (size_t j = 0; j < width; ++j)
+                    {
+                        dst[j] += a * r[j];
+                    }
+                }
+            }
+        });
         return arr_dst;
     }
 
@@ -270,11 +429,10 @@ public:
     template <typename T>
     static T* softmax_1(T* dst, const T* src, size_t length)
     {
-        T* tmp = new T[length];
-        assert(tmp);
+        ScratchScope scratch;
+        T* tmp = scratch.allocate<T>(length);
         softmax(tmp, src, length);
         softmax_1_opt(dst, tmp, length);
-        delete[] tmp;
         return dst;
     }
 
@@ -458,12 +616,180 @@ public:
      * \return std::tuple<T, size_t> Tuple of max and argmax.
      */
     template <typename T>
-    static std::tuple<T, size_t> max_and_argmax(T* src, size_t length) 
+    static std::tuple<T, size_t> max_and_argmax(const T* src, size_t length) 
     {
         auto max_iter = std::max_element(src, src + length);
         auto dist = static_cast<size_t>(std::distance(src, max_iter));
         return {*max_iter, dist};
     }
+
+    // == Tensor views ==
+    /*
+     * The overloads on views check the shapes and run the array kernels 
+     * above when the views are contiguous, the strided loops otherwise.
+     */
+
+    /**
+     * \brief Values of a view in a contiguous row-major array: the data of
+     * the view if it is contiguous, otherwise a copy in the scratch arena.
+     * \tparam T      Type of the elements.
+     * \param src     Source view.
+     * \param scratch Scope that owns the copy.
+     * \return const T* The contiguous values.
+     */
+    template <typename T>
+    static const T* contiguous(BasicTensorView<const T> src, 
+        ScratchScope& scratch)
+    {
+        if (src.contiguous())
+        {
+            return src.data();
+        }
+
+        T* dst = scratch.allocate<T>(src.size());
+        size_t const cols = src.shape(1);
+        for (size_t i = 0; i < src.shape(0); ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                dst[(i * cols) + j] = src.rank() == 1 ? src[i] : src(i, j);
+            }
+        }
+        return dst;
+    }
+
+    /**
+     * \brief Multiply element-wise two vector views.
+     * \tparam T    Type of each source and destination elements.
+     * \param dst   Destination view.
+     * \param src1  Source view, left operand.
+     * \param src2  Source view, right operand.
+     * \return BasicTensorView<T> The destination view.
+     */
+    template <typename T>
+    static BasicTensorView<T> arr_mul(BasicTensorView<T> dst, 
+        std::type_identity_t<BasicTensorView<const T>> src1, 
+        std::type_identity_t<BasicTensorView<const T>> src2)
+    {
+        _check_shape(src1.size() == dst.size() && src2.size() == dst.size(),
+            "arr_mul");
+        if (dst.contiguous() && src1.contiguous() && src2.contiguous())
+        {
+            arr_mul(dst.data(), src1.data(), src2.data(), dst.size());
+            return dst;
+        }
+        for (size_t i = 0; i < dst.size(); ++i)
+        {
+            dst[i] = src1[i] * src2[i];
+        }
+        return dst;
+    }
+
+    /**
+     * \brief Sum element-wise two vector views.
+     * \tparam T    Type of each source and destination elements.
+     * \param dst   Destination view.
+     * \param src1  Source view, left operand.
+     * \param src2  Source view, right operand.
+     * \return BasicTensorView<T> The destination view.
+     */
+    template <typename T>
+    static BasicTensorView<T> arr_sum(BasicTensorView<T> dst, 
+        std::type_identity_t<BasicTensorView<const T>> src1, 
+        std::type_identity_t<BasicTensorView<const T>> src2)
+    {
+        _check_shape(src1.size() == dst.size() && src2.size() == dst.size(),
+            "arr_sum");
+        if (dst.contiguous() && src1.contiguous() && src2.contiguous())
+        {
+            arr_sum(dst.data(), src1.data(), src2.data(), dst.size());
+            return dst;
+        }
+        for (size_t i = 0; i < dst.size(); ++i)
+        {
+            dst[i] = src1[i] + src2[i];
+        }
+        return dst;
+    }
+
+    /**
+     * \brief Multiply a matrix view with a vector view.
+     * \tparam T      Type of each source and destination elements.
+     * \param arr_dst Destination vector of mat_src.shape(0) values.
+     * \param mat_src Matrix source, left operand.
+     * \param arr_src Vector source of mat_src.shape(1) values.
+     * \return BasicTensorView<T> The destination view.
+     */
+    template <typename T>
+    static BasicTensorView<T> matarr_mul(BasicTensorView<T> arr_dst, 
+        std::type_identity_t<BasicTensorView<const T>> mat_src, 
+        std::type_identity_t<BasicTensorView<const T>> arr_src)
+    {
+        _check_shape(mat_src.rank() == 2 
+            && mat_src.shape(0) == arr_dst.size() 
+            && mat_src.shape(1) == arr_src.size(), "matarr_mul");
+        size_t const rows = mat_src.shape(0);
+        size_t const cols = mat_src.shape(1);
+        if (arr_dst.contiguous() && mat_src.contiguous() 
+            && arr_src.contiguous())
+        {
+            matarr_mul(arr_dst.data(), mat_src.data(), arr_src.data(), 
+                rows, cols);
+            return arr_dst;
+        }
+
+        ScratchScope scratch;
+        const T* x = contiguous(arr_src, scratch);
+        for (size_t i = 0; i < rows; ++i)
+        {
+            T sum{0};
+            for (size_t j = 0; j < cols; ++j)
+            {
+                sum += mat_src(i, j) * x[j];
+            }
+            arr_dst[i] = sum;
+        }
+        return arr_dst;
+    }
+
+private:
+    /**
+     * \brief Throw if the shapes of the operands of a kernel do not match.
+     * \param match  Whether the shapes match.
+     * \param kernel Name of the kernel.
+     */
+    static void _check_shape(bool match, char const* kernel)
+    {
+        if (!match)
+        {
+            throw std::runtime_error(std::string{"operands of "} + kernel 
+                + " have mismatching shapes");
+        }
+    }
+
+    /**
+     * \brief Run a kernel on the rows of a rows x cols matrix, splitting the 
+     * rows on the global ThreadPool when the matrix is large enough. Each row
+     * is computed by a single thread, so results do not depend on the split.
+     * \tparam F     Kernel type, callable with a range of rows [first, last).
+     * \param rows   Amount of rows.
+     * \param cols   Amount of columns.
+     * \param kernel Kernel to run.
+     */
+    template <typename F>
+    static void _parallel_rows(size_t rows, size_t cols, F&& kernel)
+    {
+        if (rows * cols < parallel_threshold)
+        {
+            kernel(size_t{0}, rows);
+            return;
+        }
+
+        size_t grain = std::max(size_t{1}, parallel_grain / std::max(cols, 
+            size_t{1}));
+        // A reference wrapper fits in std::function without allocations.
+        ThreadPool::global().parallel_for(0, rows, grain, std::ref(kernel));
+    }
 };
 
 } // namespace Ariadne
@@ -24,25 +24,49 @@
 
 #include "gd_optimizer.hpp"
 
+#include <atomic>
+
 namespace Ariadne {
 
-GDOptimizer::GDOptimizer(NumType eta)
+template <typename T>
+BasicGDOptimizer<T>::BasicGDOptimizer(T eta)
     : _eta{eta}
 { }
 
-void GDOptimizer::train(Layer& layer) 
+template <typename T>
+void BasicGDOptimizer<T>::train(BasicLayer<T>& layer) 
 {
     size_t param_count = layer.param_count();
     for (size_t i = 0; i < param_count; ++i)
     {
-        NumType& param    = *layer.param(i);
-        NumType& gradient = *layer.gradient(i);
+        T& param    = *layer.param(i);
+        T& gradient = *layer.gradient(i);
 
         param -= _eta * gradient;
 
         // Reset the gradient accumulated again in the next training epoch.
-        gradient = NumType{0.0};
+        gradient = T{0.0};
+    }
+}
+
+template <typename T>
+void BasicGDOptimizer<T>::train_shared(BasicLayer<T>& layer, T* params) 
+{
+    // The whole block, padding included: it has the layout of params.
+    size_t block_size = layer.param_block_size();
+    T* gradients = layer.gradient(0);
+    for (size_t i = 0; i < block_size; ++i)
+    {
+        std::atomic_ref<T> param{params[i]};
+        T& gradient = gradients[i];
+
+        param.store(param.load(std::memory_order_relaxed) - _eta * gradient,
+            std::memory_order_relaxed);
+        gradient = T{0.0};
     }
 }
 
+template class BasicGDOptimizer<float>;
+template class BasicGDOptimizer<double>;
+
 } // namespace Ariadne
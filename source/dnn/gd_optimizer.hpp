@@ -38,8 +38,10 @@ namespace Ariadne {
  * \brief Class that defines the general gradient descent algorithm
  * It can be used as part of the *Stochastic* gradient descent algorithm (SGD) 
  * by invoking it after smaller batches of training data are evaluated.
+ * \tparam T Scalar type of the model.
  */
-class GDOptimizer : public Optimizer
+template <typename T>
+class BasicGDOptimizer : public BasicOptimizer<T>
 {
 public:
     /**
@@ -48,7 +50,7 @@ public:
      * descent, p will be adjusted such that p' = p - eta * dL/dp.
      * \param eta commonly accepted character used to denote the learning rate.
      */
-    GDOptimizer(NumType eta);
+    BasicGDOptimizer(T eta);
 
     /**
      * \brief Invoked at the end of each batch's evaluation.
@@ -56,12 +58,22 @@ public:
      * different segments of the computational graph.
      * \param layer
      */
-    void train(Layer& layer) override;
+    void train(BasicLayer<T>& layer) override;
+
+    /**
+     * \brief Apply the gradients of a layer to parameters shared with other 
+     * threads, see Optimizer::train_shared().
+     * \param layer
+     * \param params
+     */
+    void train_shared(BasicLayer<T>& layer, T* params) override;
 
 private:
-    NumType _eta; ///< Learning rate.
+    T _eta; ///< Learning rate.
 };
 
+using GDOptimizer = BasicGDOptimizer<NumType>;
+
 } // namespace Ariadne
  
 #endif // ARIADNE_DNN_GD_OPTIMIZER_HPP
\ No newline at end of file
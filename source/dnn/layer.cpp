@@ -24,13 +24,52 @@
 
 #include "layer.hpp"
 
+#include "model.hpp"
+
+#include <stdexcept>
+
 
 namespace Ariadne {
 
-Layer::Layer(Model& model, std::string name)
+template <typename T>
+BasicLayer<T>::BasicLayer(BasicModel<T>& model, std::string name)
     : _model(model)
     , _name{std::move(name)}
+    , _inference{model.mode() == ModelMode::Inference}
 { }
 
+template <typename T>
+void BasicLayer<T>::set_trainable(bool trainable)
+{
+    _trainable = trainable;
+    _model._compiled = false;
+}
+
+template <typename T>
+LayerCost BasicLayer<T>::cost(Phase phase) const noexcept
+{
+    double const value = sizeof(T);
+    if (phase == Phase::Optimizer)
+    {
+        double params = static_cast<double>(param_count());
+        return {2.0 * params, 4.0 * value * params};
+    }
+    return {0.0, value * static_cast<double>(input_size() + output_size())};
+}
+
+template <typename T>
+void BasicLayer<T>::_check_size(BasicTensorView<T const> const& view, 
+    size_t size, char const* what) const
+{
+    if (view.size() != size)
+    {
+        throw std::runtime_error("layer " + _name + " expects " 
+            + std::to_string(size) + " " + what + ", got " 
+            + std::to_string(view.size()));
+    }
+}
+
+template class BasicLayer<float>;
+template class BasicLayer<double>;
 
 } // namespace Ariadne
@@ -29,25 +29,44 @@
 #ifndef ARIADNE_DNN_LAYER_HPP
 #define ARIADNE_DNN_LAYER_HPP
 
+#include "profiler.hpp"
+#include "tensor_view.hpp"
 #include "type.hpp"
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 
 namespace Ariadne {
 
-class Model;
+template <typename T> class BasicModel;
+
+/**
+ * \brief Transient buffers of a layer, assigned by the Model memory planner.
+ * Buffers that the current execution plan does not need are nullptr, the 
+ * others start on a cache line.
+ * \tparam T Scalar type of the model.
+ */
+template <typename T>
+struct BasicLayerBuffers
+{
+    T* output{nullptr};         ///< output_size() values.
+    T* input_gradient{nullptr}; ///< input_size() values.
+    T* scratch{nullptr};        ///< scratch_size() values.
+};
 
 /**
  * \brief Base class of computational layers in a model.
+ * \tparam T Scalar type of the parameters and of the buffers.
  */
-class Layer 
+template <typename T>
+class BasicLayer 
 {
 public:
-    Layer(Model& model, std::string name);
-    virtual ~Layer() = default;
+    BasicLayer(BasicModel<T>& model, std::string name);
+    virtual ~BasicLayer() = default;
 
     /**
      * \brief Virtual method used to describe how a layer should be 
@@ -58,20 +77,87 @@ public:
 
     /**
      * \brief Virtual method used to perform forward propagations. During 
-     * forward propagation nodes transform input data and feed results to all 
-     * subsequent nodes.
-     * \param inputs NumType ptr
+     * forward propagation nodes transform input data and expose the results
+     * with output(). The Model feeds the outputs to the subsequent nodes.
+     * \param inputs View of input_size() values, valid until the next 
+     * forward propagation.
      */
-    virtual void forward(NumType* inputs) = 0;
+    virtual void forward(BasicTensorView<T const> inputs) = 0;
 
     /**
      * \brief Virtual method used to perform reverse propagations. During 
      * reverse propagation nodes receive loss gradients to its previous outputs
-     * and compute gradients with respect to each tunable parameter.
+     * and compute gradients with respect to each tunable parameter and to
+     * the inputs, exposed with input_gradient().
      * Compute dJ/dz = dJ/dg(z) * dg(z)/dz.
-     * \param gradients NumType ptr dJ/dg(z)
+     * \param gradients View of output_size() values dJ/dg(z), empty for 
+     * nodes without subsequents.
+     */
+    virtual void reverse(BasicTensorView<T const> gradients) = 0;
+
+    /**
+     * \brief Virtual method accessor for the result of the last forward 
+     * propagation.
+     * \return T* Output array of output_size() values, nullptr for 
+     * sink nodes.
+     */
+    virtual T* output() { return nullptr; }
+
+    /**
+     * \brief Virtual method accessor for the loss gradient with respect to 
+     * the inputs computed by the last reverse propagation.
+     * \return T* Gradient array of input_size() values.
+     */
+    virtual T* input_gradient() = 0;
+
+    /**
+     * \brief Size of the arrays accepted by forward().
+     * \return size_t
+     */
+    virtual size_t input_size() const noexcept = 0;
+
+    /**
+     * \brief Size of the array returned by output().
+     * \return size_t
+     */
+    virtual size_t output_size() const noexcept { return 0; }
+
+    /**
+     * \brief Size of the temporary buffer used by reverse().
+     * \return size_t
+     */
+    virtual size_t scratch_size() const noexcept { return 0; }
+
+    /**
+     * \brief Virtual method used by the Model to assign the transient 
+     * buffers of the layer: outputs, input gradients and reverse scratch live
+     * in an arena shared by all the layers and are valid only while the 
+     * execution plan that bound them is in use.
+     * \param buffers Buffers assigned to the layer.
+     */
+    virtual void bind_buffers(BasicLayerBuffers<T> const& buffers) = 0;
+
+    /**
+     * \brief Virtual method used to release the state needed only by reverse 
+     * propagation and training. Afterwards the layer supports forward() 
+     * only. Overrides have to call the base implementation.
      */
-    virtual void reverse(NumType* gradients) = 0;
+    virtual void drop_training_state() { _inference = true; }
+
+    /**
+     * \brief Freeze or unfreeze the parameters of the layer. The reverse 
+     * propagation computes no parameter gradients for a frozen layer and the
+     * Model optimizer leaves it unchanged; the layers upstream of frozen 
+     * ones are not reverse propagated at all.
+     * \param trainable Whether the parameters are trained.
+     */
+    void set_trainable(bool trainable);
+
+    /**
+     * \brief Whether the parameters of the layer are trained.
+     * \return bool
+     */
+    [[nodiscard]] bool trainable() const noexcept { return _trainable; }
 
     /**
      * \brief Virtual method that return the number of tunable parameters. 
@@ -81,20 +167,66 @@ public:
      */
     virtual size_t param_count() const noexcept { return 0; }
 
+    /**
+     * \brief Size in values of the block that stores the parameters, 
+     * param_count() and the padding of the layer layout. Gradients, bound 
+     * buffers, checkpoints and model files use blocks of this size.
+     * \return size_t
+     */
+    virtual size_t param_block_size() const noexcept { return param_count(); }
+
     /**
      * \brief Virtual method accessor for parameter by index.
+     * Parameters are stored in a block of param_block_size() values that 
+     * starts at param(0), index i is not always at offset i of it.
      * \param index size_t Parameter index.
-     * \return NumType* Pointer to parameter.
+     * \return T* Pointer to parameter.
      */
-    virtual NumType* param(size_t index) { (void) index; return nullptr; }
+    virtual T* param(size_t index) { (void) index; return nullptr; }
 
     /**
      * \brief Virtual method accessor for loss-gradient with respect to a 
      * parameter specified by index.
+     * Gradients are stored contiguously with the same layout of parameters.
      * \param index size_t Parameter index.
-     * \return NumType* Pointer to gradient value of parameter.
+     * \return T* Pointer to gradient value of parameter.
+     */
+    virtual T* gradient(size_t index) { (void) index; return nullptr; }
+
+    /**
+     * \brief Virtual method used to make the layer read and update its 
+     * parameters in an external buffer instead of its own storage. 
+     * The buffer has to hold param_block_size() values with the layout of 
+     * param() and has to outlive the layer.
+     * \param params Parameters buffer.
      */
-    virtual NumType* gradient(size_t index) { (void) index; return nullptr; }
+    virtual void bind_params(T* params) { (void) params; }
+
+    /**
+     * \brief Virtual method used to create a copy of the layer, with the same 
+     * configuration and parameters, that belongs to another model. 
+     * Edges are not copied.
+     * \param model Model that owns the copy.
+     * \return std::unique_ptr<BasicLayer> The copy.
+     */
+    virtual std::unique_ptr<BasicLayer> clone(BasicModel<T>& model) const = 0;
+
+    /**
+     * \brief Virtual method that estimates the work of a call of a phase,
+     * used by the profiler to report throughputs. The default counts the 
+     * inputs and outputs traffic of forward() and reverse() and two 
+     * operations and four accesses per parameter for the optimizer.
+     * \param phase
+     * \return LayerCost
+     */
+    virtual LayerCost cost(Phase phase) const noexcept;
+
+    /**
+     * \brief Virtual method that return the type of the layer and of its 
+     * configuration, stored in the model files to validate them.
+     * \return std::string Type name, shorter than ModelFormat::type_size.
+     */
+    virtual std::string type() const = 0;
 
     /**
      * \brief Print.
@@ -111,14 +243,29 @@ public:
     }
 
 protected:
-    friend class Model;
+    friend class BasicModel<T>;
+
+    /**
+     * \brief Throw if a view passed to forward() or reverse() does not hold
+     * the expected amount of values.
+     * \param view View to check.
+     * \param size Expected amount of values.
+     * \param what Name of the view in the error message.
+     */
+    void _check_size(BasicTensorView<T const> const& view, size_t size, 
+        char const* what) const;
 
-    Model& _model;                      ///< Model reference.
-    std::string _name;                  ///< Layer naem (for debug).
-    std::vector<Layer*> _antecedents;   ///< List of previous layers.
-    std::vector<Layer*> _subsequents;   ///< List of followers layers.
+    BasicModel<T>& _model;                 ///< Model reference.
+    std::string _name;                     ///< Layer naem (for debug).
+    std::vector<BasicLayer*> _antecedents; ///< List of previous layers.
+    std::vector<BasicLayer*> _subsequents; ///< List of followers layers.
+    bool _inference;                       ///< Whether it has training state.
+    bool _trainable{true};                 ///< Whether parameters are trained.
 };
 
+using LayerBuffers = BasicLayerBuffers<NumType>;
+using Layer = BasicLayer<NumType>;
+
 } // namespace Ariadne
 
 #endif // ARIADNE_DNN_LAYER_HPP
@@ -0,0 +1,83 @@
+/***************************************************************************
+ *            loss.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*! \file loss.hpp
+ *  \brief Loss layer interface.
+ */
+
+#ifndef ARIADNE_DNN_LOSS_HPP
+#define ARIADNE_DNN_LOSS_HPP
+
+#include "layer.hpp"
+
+#include <string>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Base class of loss layers, the sink nodes of a model that compare
+ * the model output with the expected target and start the reverse
+ * propagation.
+ * \tparam T Scalar type of the model.
+ */
+template <typename T>
+class BasicLossLayer : public BasicLayer<T>
+{
+public:
+    BasicLossLayer(BasicModel<T>& model, std::string name)
+        : BasicLayer<T>(model, std::move(name))
+    { }
+
+    /**
+     * \brief Set the target object.
+     * During training, this must be set to the expected target distribution for
+     * a given sample.
+     * \param target
+     */
+    virtual void set_target(T const* target) = 0;
+
+    /**
+     * \brief Ratio of correct predictions since the last score reset.
+     * \return T
+     */
+    virtual T accuracy() const = 0;
+
+    /**
+     * \brief Average loss since the last score reset.
+     * \return T
+     */
+    virtual T avg_loss() const = 0;
+
+    /**
+     * \brief Reset the running loss and prediction counters.
+     */
+    virtual void reset_score() = 0;
+};
+
+using LossLayer = BasicLossLayer<NumType>;
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_LOSS_HPP
@@ -0,0 +1,91 @@
+/***************************************************************************
+ *            memory_planner.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "memory_planner.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace Ariadne {
+
+size_t MemoryPlanner::request(size_t size, size_t first, size_t last)
+{
+    _buffers.push_back({size, first, last, 0});
+    return _buffers.size() - 1;
+}
+
+void MemoryPlanner::plan()
+{
+    /*
+     * Greedy by size: the largest buffers are placed first, each one at the
+     * lowest aligned offset that does not collide with a placed buffer live
+     * at the same time.
+     */
+    std::vector<size_t> order(_buffers.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+        return _buffers[a].size > _buffers[b].size;
+    });
+
+    std::vector<Buffer const*> placed;
+    _arena_size = 0;
+    for (size_t id: order)
+    {
+        Buffer& buffer = _buffers[id];
+
+        // Live buffers sorted by offset, to scan the gaps between them.
+        std::vector<Buffer const*> live;
+        for (auto* other: placed)
+        {
+            if (other->first <= buffer.last && buffer.first <= other->last)
+            {
+                live.push_back(other);
+            }
+        }
+        std::sort(live.begin(), live.end(), [](auto* a, auto* b)
+        {
+            return a->offset < b->offset;
+        });
+
+        size_t offset = 0;
+        for (auto* other: live)
+        {
+            if (offset + buffer.size <= other->offset)
+            {
+                break;
+            }
+            size_t end = other->offset + other->size;
+            offset = std::max(offset, (end + _alignment - 1) / _alignment 
+                * _alignment);
+        }
+
+        buffer.offset = offset;
+        placed.push_back(&buffer);
+        _arena_size = std::max(_arena_size, offset + buffer.size);
+    }
+}
+
+} // namespace Ariadne
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *            memory_planner.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file memory_planner.hpp
+ *  \brief Static assignment of transient buffers to a shared arena.
+ */
+
+#ifndef ARIADNE_DNN_MEMORY_PLANNER_HPP
+#define ARIADNE_DNN_MEMORY_PLANNER_HPP
+
+#include "type.hpp"
+
+#include <cstddef>
+#include <vector>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Plan the offsets of buffers with known lifetimes in one arena.
+ *
+ * Each buffer is requested with its size and the interval of plan steps in
+ * which it is live, bounds included. Buffers whose lifetimes do not overlap
+ * may share the same memory, so the arena is usually much smaller than the
+ * sum of the requests.
+ */
+class MemoryPlanner
+{
+public:
+    /// \brief Offsets are multiple of a cache line.
+    static constexpr size_t line_size = 64;
+
+    /**
+     * \brief Construct a new MemoryPlanner object.
+     * \param value_size Size in bytes of the values of the arena.
+     */
+    explicit MemoryPlanner(size_t value_size = sizeof(NumType))
+        : _alignment{line_size / value_size}
+    {}
+
+    /**
+     * \brief Request a buffer.
+     * \param size  Amount of values.
+     * \param first First step in which the buffer is live.
+     * \param last  Last step in which the buffer is live.
+     * \return size_t Identifier of the buffer.
+     */
+    size_t request(size_t size, size_t first, size_t last);
+
+    /**
+     * \brief Assign the offsets of all the requested buffers.
+     */
+    void plan();
+
+    /**
+     * \brief Offset of a buffer in the arena, valid after plan().
+     * \param id Identifier returned by request().
+     * \return size_t
+     */
+    [[nodiscard]] size_t offset(size_t id) const { return _buffers[id].offset; }
+
+    /**
+     * \brief Amount of values of the arena, valid after plan().
+     * \return size_t
+     */
+    [[nodiscard]] size_t arena_size() const noexcept { return _arena_size; }
+
+private:
+    struct Buffer
+    {
+        size_t size;
+        size_t first;
+        size_t last;
+        size_t offset;
+    };
+
+    std::vector<Buffer> _buffers;
+    size_t _alignment;  ///< Alignment of the offsets in values.
+    size_t _arena_size{0};
+};
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_MEMORY_PLANNER_HPP
@@ -24,24 +24,91 @@
 
 #include "model.hpp"
 
+#include "dense.hpp"
+#include "dlmath.hpp"
+#include "scratch_arena.hpp"
+
+#include <algorithm>
+#include <cctype>
 #include <cstdio>
+#include <functional>
+#include <queue>
 #include <cassert>
+#include <stdexcept>
 
 namespace Ariadne {
 
-Model::Model(std::string name)
+template <typename T>
+BasicModel<T>::BasicModel(std::string name, ModelMode mode)
     : _name{name}
+    , _mode{mode}
     , _layers{}
 { }
 
-void Model::create_edge(Layer& dst, Layer& src)
+template <typename T>
+void BasicModel<T>::create_edge(BasicLayer<T>& dst, BasicLayer<T>& src)
 {
     // NOTE: No validation is done to ensure the edge doesn't already exist
     dst._antecedents.push_back(&src);
     src._subsequents.push_back(&dst);
+    _compiled = false;
+}
+
+template <typename T>
+BasicLayer<T>& BasicModel<T>::node(size_t index)
+{
+    return *_layers.at(index);
+}
+
+template <typename T>
+size_t BasicModel<T>::node_index(BasicLayer<T> const& layer) const
+{
+    for (size_t i = 0; i < _layers.size(); ++i)
+    {
+        if (_layers[i].get() == &layer)
+        {
+            return i;
+        }
+    }
+    throw std::runtime_error("layer " + layer.name() + " is not a node of " 
+                             "model " + _name);
+}
+
+template <typename T>
+std::unique_ptr<BasicModel<T>> BasicModel<T>::replicate() const
+{
+    return transform(_mode, [](BasicLayer<T> const& layer, BasicModel& model)
+    {
+        return layer.clone(model);
+    });
+}
+
+template <typename T>
+std::unique_ptr<BasicModel<T>> BasicModel<T>::transform(ModelMode mode, 
+    std::function<std::unique_ptr<BasicLayer<T>>(BasicLayer<T> const&, 
+        BasicModel&)> const& make) const
+{
+    auto model = std::make_unique<BasicModel>(_name, mode);
+    for (auto& layer: _layers)
+    {
+        model->_layers.push_back(make(*layer, *model));
+        model->_layers.back()->_trainable = layer->_trainable;
+    }
+
+    // Replay the edges in the same order of the subsequents lists.
+    for (size_t i = 0; i < _layers.size(); ++i)
+    {
+        for (auto* dst: _layers[i]->_subsequents)
+        {
+            model->create_edge(*model->_layers[node_index(*dst)], 
+                *model->_layers[i]);
+        }
+    }
+    return model;
 }
 
-RneType::result_type Model::init(RneType::result_type seed)
+template <typename T>
+RneType::result_type BasicModel<T>::init(RneType::result_type seed)
 {
     if (seed == 0)
     {
@@ -60,45 +127,734 @@ RneType::result_type Model::init(RneType::result_type seed)
     return seed;
 }
 
-void Model::train(Optimizer& optimizer)
+template <typename T>
+void BasicModel<T>::compile()
+{
+    // Kahn's algorithm, the ready layer with the lowest index goes first.
+    std::vector<size_t> pending(_layers.size());
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> 
+        ready;
+    for (size_t i = 0; i < _layers.size(); ++i)
+    {
+        pending[i] = _layers[i]->_antecedents.size();
+        if (pending[i] == 0)
+        {
+            ready.push(i);
+        }
+    }
+
+    std::vector<BasicLayer<T>*> order;
+    while (!ready.empty())
+    {
+        BasicLayer<T>* layer = _layers[ready.top()].get();
+        ready.pop();
+
+        for (auto* src: layer->_antecedents)
+        {
+            if (src->output_size() != layer->input_size())
+            {
+                throw std::runtime_error("edge " + src->name() + " -> " 
+                    + layer->name() + " connects layers of different size");
+            }
+        }
+        order.push_back(layer);
+
+        for (auto* dst: layer->_subsequents)
+        {
+            size_t index = node_index(*dst);
+            if (--pending[index] == 0)
+            {
+                ready.push(index);
+            }
+        }
+    }
+
+    if (order.size() != _layers.size())
+    {
+        throw std::runtime_error("model " + _name + " contains a cycle");
+    }
+
+    if (_mode == ModelMode::Training)
+    {
+        _plan_training(order);
+    }
+    _plan_inference(order);
+    _bound    = nullptr;
+    _compiled = true;
+}
+
+template <typename T>
+void BasicModel<T>::forward(T* inputs)
+{
+    _check_training();
+    if (!_compiled)
+    {
+        compile();
+    }
+    _bind(_training);
+    _forward(_training, inputs);
+}
+
+template <typename T>
+void BasicModel<T>::reverse()
+{
+    _check_training();
+    if (!_compiled || _bound != &_training)
+    {
+        throw std::runtime_error("model " + _name + " needs a forward "
+                                 "propagation before the reverse one");
+    }
+
+    // Temporaries of the layers are dropped at the end of the step.
+    ScratchScope scratch;
+    auto& steps = _training.steps;
+    for (auto it = steps.rbegin(); it != steps.rend(); ++it)
+    {
+        if (!it->reverse)
+        {
+            continue;
+        }
+
+        auto& subsequents = it->layer->_subsequents;
+        size_t const size = it->layer->output_size();
+        BasicTensorView<T const> gradients;
+        if (subsequents.size() == 1)
+        {
+            T* gradient = subsequents.front()->input_gradient();
+            gradients = {gradient, gradient != nullptr ? size : 0};
+        }
+        else if (subsequents.size() > 1)
+        {
+            T* sum = _at(it->fan_out);
+            std::copy_n(subsequents.front()->input_gradient(), size, sum);
+            for (size_t i = 1; i < subsequents.size(); ++i)
+            {
+                DLMath::arr_sum(sum, sum, subsequents[i]->input_gradient(), 
+                    size);
+            }
+            gradients = {sum, size};
+        }
+        ARIADNE_PROFILE_SCOPE(_profiler, *it->layer, Phase::Reverse);
+        it->layer->reverse(gradients);
+    }
+}
+
+template <typename T>
+T* BasicModel<T>::predict(T* inputs)
+{
+    if (!_compiled)
+    {
+        compile();
+    }
+    if (_inference.steps.empty())
+    {
+        throw std::runtime_error("model " + _name + " has no layer with "
+                                 "outputs");
+    }
+    _bind(_inference);
+    _forward(_inference, inputs);
+    return _inference.steps.back().layer->output();
+}
+
+template <typename T>
+void BasicModel<T>::_plan_training(std::vector<BasicLayer<T>*> const& order)
+{
+    /*
+     * Step i runs the forward of order[i] and step 2N-1-i its reverse. 
+     * The outputs (and the sums of fan-in inputs) are read again by the 
+     * reverse of their own layer, after the ones of the subsequents, while 
+     * an input gradient lives until the reverse of its first antecedent.
+     *
+     * The reverse of a layer is needed only if it or one of its ancestors 
+     * has trainable parameters, and its input gradient only if one of its 
+     * antecedents needs the reverse: graph entries and frozen prefixes of 
+     * the model get neither.
+     */
+    size_t const last = 2 * order.size() - 1;
+    std::vector<size_t> position(_layers.size());
+    std::vector<bool> reverse(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        BasicLayer<T>* layer = order[i];
+        position[node_index(*layer)] = i;
+        reverse[i] = layer->_trainable && layer->param_count() > 0;
+        for (auto* src: layer->_antecedents)
+        {
+            reverse[i] = reverse[i] || reverse[position[node_index(*src)]];
+        }
+    }
+
+    MemoryPlanner planner{sizeof(T)};
+    std::vector<Step> ids;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        BasicLayer<T>* layer = order[i];
+        size_t back = last - i;
+        Step id{layer};
+        id.reverse = reverse[i];
+
+        // Without reverse, the output is last read by the subsequents.
+        size_t end = i;
+        if (reverse[i])
+        {
+            end = back;
+        }
+        else
+        {
+            for (auto* dst: layer->_subsequents)
+            {
+                end = std::max(end, last - position[node_index(*dst)]);
+            }
+        }
+        if (layer->output_size() > 0)
+        {
+            id.output = planner.request(layer->output_size(), i, end);
+        }
+        if (layer->_antecedents.size() > 1)
+        {
+            id.fan_in = planner.request(layer->input_size(), i, 
+                reverse[i] ? back : i);
+        }
+
+        if (!reverse[i])
+        {
+            ids.push_back(id);
+            continue;
+        }
+
+        end = back;
+        bool input_gradient = false;
+        for (auto* src: layer->_antecedents)
+        {
+            size_t p = position[node_index(*src)];
+            if (reverse[p])
+            {
+                end = std::max(end, last - p);
+                input_gradient = true;
+            }
+        }
+        if (input_gradient)
+        {
+            id.input_gradient = planner.request(layer->input_size(), back, 
+                end);
+        }
+        if (layer->scratch_size() > 0)
+        {
+            id.scratch = planner.request(layer->scratch_size(), back, back);
+        }
+        if (layer->_subsequents.size() > 1)
+        {
+            id.fan_out = planner.request(layer->output_size(), back, back);
+        }
+        ids.push_back(id);
+    }
+
+    planner.plan();
+    _training = _resolve(planner, ids);
+}
+
+template <typename T>
+void BasicModel<T>::_plan_inference(std::vector<BasicLayer<T>*> const& order)
+{
+    // Layers without outputs, the loss layers, do not take part.
+    std::vector<BasicLayer<T>*> layers;
+    std::vector<size_t> position(_layers.size(), _unused);
+    for (auto* layer: order)
+    {
+        if (layer->output_size() > 0)
+        {
+            position[node_index(*layer)] = layers.size();
+            layers.push_back(layer);
+        }
+    }
+
+    MemoryPlanner planner{sizeof(T)};
+    std::vector<Step> ids;
+    for (size_t i = 0; i < layers.size(); ++i)
+    {
+        BasicLayer<T>* layer = layers[i];
+
+        // An output is released after its last reader, the model output 
+        // lives until the end.
+        size_t end = i;
+        bool read = false;
+        for (auto* dst: layer->_subsequents)
+        {
+            size_t p = position[node_index(*dst)];
+            if (p != _unused)
+            {
+                end  = std::max(end, p);
+                read = true;
+            }
+        }
+        if (!read)
+        {
+            end = layers.size() - 1;
+        }
+
+        Step id{layer};
+        id.output = planner.request(layer->output_size(), i, end);
+        if (layer->_antecedents.size() > 1)
+        {
+            id.fan_in = planner.request(layer->input_size(), i, i);
+        }
+        ids.push_back(id);
+    }
+
+    planner.plan();
+    _inference = _resolve(planner, ids);
+}
+
+template <typename T>
+typename BasicModel<T>::Plan BasicModel<T>::_resolve(
+    MemoryPlanner const& planner, std::vector<Step> const& ids)
 {
+    auto offset = [&planner](size_t id)
+    {
+        return id == _unused ? _unused : planner.offset(id);
+    };
+
+    Plan plan;
+    plan.arena_size = planner.arena_size();
+    for (auto& id: ids)
+    {
+        plan.steps.push_back({id.layer, offset(id.output), 
+            offset(id.input_gradient), offset(id.scratch), offset(id.fan_in), 
+            offset(id.fan_out), id.reverse});
+    }
+    return plan;
+}
+
+template <typename T>
+void BasicModel<T>::_bind(Plan const& plan)
+{
+    if (_bound == &plan)
+    {
+        return;
+    }
+
+    if (_arena.size() < plan.arena_size)
+    {
+        _arena.resize(plan.arena_size);
+    }
+    for (auto& step: plan.steps)
+    {
+        step.layer->bind_buffers({_at(step.output), _at(step.input_gradient), 
+            _at(step.scratch)});
+    }
+    _bound = &plan;
+}
+
+template <typename T>
+void BasicModel<T>::_forward(Plan const& plan, T* inputs)
+{
+    // Temporaries of the layers are dropped at the end of the step.
+    ScratchScope scratch;
+    for (auto& step: plan.steps)
+    {
+        auto& antecedents = step.layer->_antecedents;
+        T* layer_inputs = inputs;
+        if (antecedents.size() == 1)
+        {
+            layer_inputs = antecedents.front()->output();
+        }
+        else if (antecedents.size() > 1)
+        {
+            size_t size = step.layer->input_size();
+            T* sum = _at(step.fan_in);
+            std::copy_n(antecedents.front()->output(), size, sum);
+            for (size_t i = 1; i < antecedents.size(); ++i)
+            {
+                DLMath::arr_sum(sum, sum, antecedents[i]->output(), size);
+            }
+            layer_inputs = sum;
+        }
+        ARIADNE_PROFILE_SCOPE(_profiler, *step.layer, Phase::Forward);
+        step.layer->forward({layer_inputs, step.layer->input_size()});
+    }
+}
+
+template <typename T>
+void BasicModel<T>::train(BasicOptimizer<T>& optimizer)
+{
+    _check_training();
     for (auto& layer: _layers)
     {
-        optimizer.train(*layer);
+        if (layer->_trainable)
+        {
+            ARIADNE_PROFILE_SCOPE(_profiler, *layer, Phase::Optimizer);
+            optimizer.train(*layer);
+        }
     }
 }
 
-void Model::print() const
+template <typename T>
+void BasicModel<T>::freeze()
 {
+    _mode = ModelMode::Inference;
     for (auto& layer: _layers)
     {
-        layer->print();
+        layer->drop_training_state();
+    }
+
+    // The arena is sized by the next compile, with the inference plan only.
+    _training = Plan{};
+    _bound    = nullptr;
+    _compiled = false;
+    AlignedVector<T>{}.swap(_arena);
+}
+
+template <typename T>
+void BasicModel<T>::_check_training() const
+{
+    if (_mode != ModelMode::Training)
+    {
+        throw std::runtime_error("model " + _name + " is in inference mode, "
+                                 "only predict() is supported");
     }
 }
 
-void Model::save(std::ofstream& out)
+template <typename T>
+void BasicModel<T>::print() const
 {
     for (auto& layer: _layers)
     {
-        size_t param_count = layer->param_count();
-        for (size_t i = 0; i < param_count; ++i)
+        layer->print();
+    }
+}
+
+template <typename T>
+void BasicModel<T>::print_profile(std::ostream& out) const
+{
+#if ENABLE_PROFILING
+    _profiler.print(out, "profile of model " + _name);
+#else
+    out << "profiling of model " << _name << " disabled, configure with "
+           "-DENABLE_PROFILING=true\n";
+#endif
+}
+
+template <typename T>
+bool BasicModel<T>::enable_perf_counters()
+{
+#if ENABLE_PROFILING
+    return _profiler.enable_counters();
+#else
+    return false;
+#endif
+}
+
+template <typename T>
+void BasicModel<T>::save(std::ostream& out)
+{
+    std::vector<BasicLayer<T>*> layers = _layer_list();
+    std::vector<T const*> blocks;
+    for (auto* layer: layers)
+    {
+        blocks.push_back(layer->param_block_size() > 0 ? layer->param(0) 
+                                                       : nullptr);
+    }
+    ModelFormat::save(out, ModelFormat::describe(layers), blocks);
+}
+
+template <typename T>
+void BasicModel<T>::load(std::istream& in)
+{
+    std::vector<BasicLayer<T>*> layers = _layer_list();
+    std::vector<T*> blocks;
+    for (auto* layer: layers)
+    {
+        blocks.push_back(layer->param_block_size() > 0 ? layer->param(0) 
+                                                       : nullptr);
+    }
+    ModelFormat::load(in, ModelFormat::describe(layers), blocks);
+}
+
+template <typename T>
+void BasicModel<T>::load(std::filesystem::path const& path, bool verify)
+{
+    auto mapping = std::make_shared<MappedFile>(path);
+    if (mapping->size() < sizeof(ModelFormat::Header))
+    {
+        throw std::runtime_error(path.string() + " is not a model file");
+    }
+
+    auto& header = *reinterpret_cast<ModelFormat::Header*>(mapping->data());
+    ModelFormat::check_header<T>(header);
+    _check_complete(header);
+    if (header.file_size != mapping->size() || header.layer_count 
+        > (mapping->size() - sizeof(header)) / sizeof(ModelFormat::LayerRecord))
+    {
+        throw std::runtime_error(path.string() + " is truncated");
+    }
+
+    auto* first = reinterpret_cast<ModelFormat::LayerRecord*>(
+        mapping->data() + sizeof(header));
+    std::vector<ModelFormat::LayerRecord> records(first, 
+        first + header.layer_count);
+    std::vector<BasicLayer<T>*> layers = _layer_list();
+    auto indices = ModelFormat::check_records(header, records, layers);
+
+    for (size_t i = 0; i < layers.size(); ++i)
+    {
+        if (indices[i] == ModelFormat::npos)
+        {
+            continue;
+        }
+        auto& record = records[indices[i]];
+        auto* params = reinterpret_cast<T*>(
+            mapping->data() + record.offset);
+        if (verify 
+            && ModelFormat::checksum(params, 
+                record.block_size * sizeof(T)) != record.checksum)
         {
-            out.write(reinterpret_cast<char const*>(layer->param(i)), 
-                sizeof(NumType));
+            throw std::runtime_error("parameters of layer " 
+                + layers[i]->name() + " are corrupted");
         }
     }
+
+    // Bind only once the whole file is valid.
+    for (size_t i = 0; i < layers.size(); ++i)
+    {
+        if (indices[i] != ModelFormat::npos)
+        {
+            layers[i]->bind_params(reinterpret_cast<T*>(
+                mapping->data() + records[indices[i]].offset));
+        }
+    }
+    _mapping = std::move(mapping);
 }
 
-void Model::load(std::ifstream& in)
+template <typename T>
+void BasicModel<T>::export_cpp(std::filesystem::path const& path, 
+    std::string namespace_name)
 {
-    for (auto& layer: _layers)
+    if (!_compiled)
+    {
+        compile();
+    }
+    if (_inference.steps.empty())
+    {
+        throw std::runtime_error("model " + _name + " has no layer with "
+                                 "outputs");
+    }
+
+    // Identifiers can only have alphanumeric characters and underscores.
+    if (namespace_name.empty())
+    {
+        namespace_name = _name;
+    }
+    for (auto& c: namespace_name)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(c)))
+        {
+            c = '_';
+        }
+    }
+    if (std::isdigit(static_cast<unsigned char>(namespace_name.front())))
+    {
+        namespace_name = std::string(1, '_') + namespace_name;
+    }
+    std::string guard = "ARIADNE_EXPORT_" + namespace_name + "_HPP";
+    std::transform(guard.begin(), guard.end(), guard.begin(), [](char c)
+    {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    });
+
+    auto& steps = _inference.steps;
+    std::ofstream out{path};
+    out << std::hexfloat;
+    out << "/*\n"
+        << " * Generated by Ariadne::Model::export_cpp from the model \"" 
+        << _name << "\".\n"
+        << " * Do not edit.\n"
+        << " */\n\n"
+        << "#ifndef " << guard << "\n"
+        << "#define " << guard << "\n\n"
+        << "#include <cmath>\n"
+        << "#include <cstddef>\n\n"
+        << "namespace " << namespace_name << " {\n\n"
+        << "using value_type = " 
+        << (sizeof(T) == sizeof(float) ? "float" : "double") << ";\n\n"
+        << "constexpr std::size_t input_size  = " 
+        << steps.front().layer->input_size() << ";\n"
+        << "constexpr std::size_t output_size = " 
+        << steps.back().layer->output_size() << ";\n\n"
+        << "namespace detail {\n\n";
+
+    // Kernels, the same loops of DLMath.
+    out << "template <std::size_t In, std::size_t Out>\n"
+        << "inline void dense(value_type const (&weights)[Out][In], \n"
+        << "    value_type const (&biases)[Out], value_type const* x, \n"
+        << "    value_type* y)\n"
+        << "{\n"
+        << "    for (std::size_t i = 0; i < Out; ++i)\n"
+        << "    {\n"
+        << "        value_type acc{0};\n"
+        << "        for (std::size_t j = 0; j < In; ++j)\n"
+        << "        {\n"
+        << "            acc += weights[i][j] * x[j];\n"
+        << "        }\n"
+        << "        y[i] = acc + biases[i];\n"
+        << "    }\n"
+        << "}\n\n"
+        << "template <std::size_t N>\n"
+        << "inline void relu(value_type* y)\n"
+        << "{\n"
+        << "    for (std::size_t i = 0; i < N; ++i)\n"
+        << "    {\n"
+        << "        y[i] = y[i] < value_type{0} ? value_type{0} : y[i];\n"
+        << "    }\n"
+        << "}\n\n"
+        << "template <std::size_t N>\n"
+        << "inline void softmax(value_type* y)\n"
+        << "{\n"
+        << "    value_type sum{0};\n"
+        << "    for (std::size_t i = 0; i < N; ++i)\n"
+        << "    {\n"
+        << "        y[i] = std::exp(y[i]);\n"
+        << "        sum += y[i];\n"
+        << "    }\n"
+        << "    value_type inv_sum = value_type{1} / sum;\n"
+        << "    for (std::size_t i = 0; i < N; ++i)\n"
+        << "    {\n"
+        << "        y[i] *= inv_sum;\n"
+        << "    }\n"
+        << "}\n\n";
+
+    // Weights.
+    char const* suffix = sizeof(T) == sizeof(float) ? "f" : "";
+    std::vector<size_t> index(_layers.size());
+    for (size_t s = 0; s < steps.size(); ++s)
     {
-        size_t param_count = layer->param_count();
-        for (size_t i = 0; i < param_count; ++i)
+        BasicLayer<T>* layer = steps[s].layer;
+        index[node_index(*layer)] = s;
+        if (layer->type().rfind("dense.", 0) != 0)
+        {
+            throw std::runtime_error("layer " + layer->name() + " of type " 
+                + layer->type() + " cannot be exported");
+        }
+
+        size_t in = layer->input_size();
+        size_t n  = layer->output_size();
+        T const* params = layer->param(0);
+        T const* biases = params + BasicDenseLayer<T>::bias_offset(n, in);
+        out << "// " << layer->name() << "\n"
+            << "constexpr value_type weights" << s << "[" << n << "][" << in 
+            << "] = {\n";
+        for (size_t i = 0; i < n; ++i)
+        {
+            out << "    {";
+            for (size_t j = 0; j < in; ++j)
+            {
+                out << (j > 0 ? ", " : "") << params[i * in + j] << suffix;
+            }
+            out << "},\n";
+        }
+        out << "};\n"
+            << "constexpr value_type biases" << s << "[" << n << "] = {";
+        for (size_t i = 0; i < n; ++i)
         {
-            in.read(reinterpret_cast<char*>(layer->param(i)), sizeof(NumType));
+            out << (i > 0 ? ", " : "") << biases[i] << suffix;
         }
+        out << "};\n\n";
+    }
+    out << "} // namespace detail\n\n";
+
+    // Name of the buffer of a step, appended rather than concatenated to 
+    // avoid a -Wrestrict false positive of GCC 12.
+    auto buffer = [](char prefix, size_t step)
+    {
+        std::string name(1, prefix);
+        name += std::to_string(step);
+        return name;
+    };
+
+    // Forward of the inference plan, the last layer writes the output.
+    out << "inline void forward(value_type const* input, value_type* output)\n"
+        << "{\n";
+    for (size_t s = 0; s < steps.size(); ++s)
+    {
+        BasicLayer<T>* layer = steps[s].layer;
+        auto& antecedents = layer->_antecedents;
+        size_t in = layer->input_size();
+        size_t n  = layer->output_size();
+
+        std::string x = "input";
+        if (antecedents.size() == 1)
+        {
+            x = buffer('y', index[node_index(*antecedents[0])]);
+        }
+        else if (antecedents.size() > 1)
+        {
+            x = buffer('x', s);
+            out << "    value_type " << x << "[" << in << "];\n"
+                << "    for (std::size_t i = 0; i < " << in << "; ++i)\n"
+                << "    {\n"
+                << "        " << x << "[i] = y" 
+                << index[node_index(*antecedents[0])] << "[i]";
+            for (size_t a = 1; a < antecedents.size(); ++a)
+            {
+                out << " + y" << index[node_index(*antecedents[a])] << "[i]";
+            }
+            out << ";\n"
+                << "    }\n";
+        }
+
+        std::string y = buffer('y', s);
+        if (s + 1 == steps.size())
+        {
+            out << "    value_type* " << y << " = output;\n";
+        }
+        else
+        {
+            out << "    value_type " << y << "[" << n << "];\n";
+        }
+        out << "    detail::dense(detail::weights" << s << ", detail::biases" 
+            << s << ", " << x << ", " << y << ");\n";
+
+        std::string type = layer->type();
+        if (type == "dense.relu")
+        {
+            out << "    detail::relu<" << n << ">(" << y << ");\n";
+        }
+        else if (type == "dense.softmax")
+        {
+            out << "    detail::softmax<" << n << ">(" << y << ");\n";
+        }
+    }
+    out << "}\n\n"
+        << "} // namespace " << namespace_name << "\n\n"
+        << "#endif // " << guard << "\n";
+
+    if (!out)
+    {
+        throw std::runtime_error("cannot write " + path.string());
+    }
+}
+
+template <typename T>
+void BasicModel<T>::_check_complete(ModelFormat::Header const& header) const
+{
+    if (header.flags & ModelFormat::delta)
+    {
+        throw std::runtime_error("model file is an incremental checkpoint, "
+                                 "restore it with Checkpointer::restore");
     }
 }
 
+template <typename T>
+std::vector<BasicLayer<T>*> BasicModel<T>::_layer_list() const
+{
+    std::vector<BasicLayer<T>*> layers;
+    for (auto& layer: _layers)
+    {
+        layers.push_back(layer.get());
+    }
+    return layers;
+}
+
+template class BasicModel<float>;
+template class BasicModel<double>;
+
 } // namespace Ariadne
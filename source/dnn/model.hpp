@@ -29,12 +29,19 @@
 #ifndef ARIADNE_DNN_MODEL_HPP
 #define ARIADNE_DNN_MODEL_HPP
 
+#include "aligned_allocator.hpp"
 #include "layer.hpp"
+#include "memory_planner.hpp"
+#include "model_format.hpp"
 #include "optimizer.hpp"
+#include "profiler.hpp"
 #include "type.hpp"
 
 #include <cstdint>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iostream>
 #include <memory>
 #include <random>
 #include <string>
@@ -42,30 +49,48 @@
 
 namespace Ariadne {
 
+/**
+ * \brief Operating mode of a model.
+ */
+enum class ModelMode
+{
+    Training,  ///< Full forward, reverse and training support.
+    Inference  ///< Only predict(), without any gradient storage.
+};
+
 /**
  * \brief Base class of a neural network model.
+ * \tparam T Scalar type of the parameters and of the buffers.
  */
-class Model
+template <typename T>
+class BasicModel
 {
 public:
-    Model(std::string name);
+    /**
+     * \brief Construct a new Model object.
+     * \param name Model name.
+     * \param mode Inference models allocate no training state in the layers
+     * added to them.
+     */
+    BasicModel(std::string name, ModelMode mode = ModelMode::Training);
 
     /**
      * \brief Append a layer to the model, forward its parameters to the layer 
      * constructor and return its reference.
      * \tparam Layer_t The class name of the layer to append.
-     * \tparam T       The list types of arguments to forward to the layer 
+     * \tparam Args    The list types of arguments to forward to the layer 
      *                 constructor.
      * \param args The list of arguments that will be forwarded to the layer 
      * constructor.
      * \return Layer_t& The reference to the layer inserted.
      */
-    template <class Layer_t, typename... T>
-    Layer_t& add_node(T&&... args)
+    template <class Layer_t, typename... Args>
+    Layer_t& add_node(Args&&... args)
     {
         _layers.push_back(
-            std::make_unique<Layer_t>(*this, std::forward<T>(args)...)
+            std::make_unique<Layer_t>(*this, std::forward<Args>(args)...)
         );
+        _compiled = false;
         return reinterpret_cast<Layer_t&>(*_layers.back());
     }
 
@@ -74,7 +99,51 @@ public:
      * \param dst Destination layer.
      * \param src Source layer.
      */
-    void create_edge(Layer& dst, Layer& src);
+    void create_edge(BasicLayer<T>& dst, BasicLayer<T>& src);
+
+    /**
+     * \brief Amount of layers in the model.
+     * \return size_t
+     */
+    [[nodiscard]] size_t node_count() const noexcept
+    {
+        return _layers.size();
+    }
+
+    /**
+     * \brief Access a layer by its insertion index.
+     * \param index Layer index.
+     * \return Layer& The layer reference.
+     */
+    BasicLayer<T>& node(size_t index);
+
+    /**
+     * \brief Find the insertion index of a layer in the model.
+     * \param layer Layer that belongs to the model.
+     * \return size_t The layer index.
+     */
+    size_t node_index(BasicLayer<T> const& layer) const;
+
+    /**
+     * \brief Create a new model with the same topology, layer configurations 
+     * and parameters. The layers of the copy own their parameters.
+     * \return std::unique_ptr<Model> The copy, allocated on the heap because 
+     * its layers keep a reference to it.
+     */
+    std::unique_ptr<BasicModel> replicate() const;
+
+    /**
+     * \brief Create a new model with the same topology in which each layer 
+     * is the one built by a function from the layer of this model, as 
+     * replicate() does with clones. The new layers have to keep the sizes.
+     * \param mode Operating mode of the new model.
+     * \param make Function that builds a layer of the new model from the 
+     * layer of this one in the same position.
+     * \return std::unique_ptr<Model> The new model.
+     */
+    std::unique_ptr<BasicModel> transform(ModelMode mode, 
+        std::function<std::unique_ptr<BasicLayer<T>>(BasicLayer<T> const&, 
+            BasicModel&)> const& make) const;
 
     /**
      * \brief Initialize the parameters of all nodes with the provided seed. 
@@ -84,12 +153,76 @@ public:
      */
     RneType::result_type init(RneType::result_type seed = 0);
 
+    /**
+     * \brief Compile the edges of the model in an execution plan: the layers 
+     * are sorted in topological order (ties broken by insertion order) and 
+     * the sizes of connected layers are validated. It is done lazily by 
+     * forward(), reverse() and predict() after any change of the graph.
+     *
+     * The transient buffers of the layers (outputs, input gradients and 
+     * scratch) are then assigned to a shared arena according to their 
+     * lifetimes, with two separate plans: the training plan keeps the outputs
+     * alive until the reverse pass, the inference plan releases each output 
+     * as soon as its subsequents have read it. Inference models build only 
+     * the inference plan.
+     */
+    void compile();
+
+    /**
+     * \brief Forward propagate an input through the whole model. Each layer 
+     * runs once: entry layers (without antecedents) receive inputs, the 
+     * others the output of their antecedent or, with fan-in, the sum of the 
+     * outputs of their antecedents.
+     * \param inputs Input array, of the input size of the entry layers.
+     */
+    void forward(T* inputs);
+
+    /**
+     * \brief Reverse propagate the loss gradients through the whole model, 
+     * in the reverse order of forward(). Sink layers, the loss layers, 
+     * receive nullptr; the others the input gradient of their subsequent 
+     * or, with fan-out, the sum of the input gradients of their subsequents.
+     */
+    void reverse();
+
+    /**
+     * \brief Forward propagate an input with the inference plan, that skips 
+     * the loss layers and needs much less memory than forward(). 
+     * \param inputs Input array, of the input size of the entry layers.
+     * \return T* Output of the last layer in execution order that has 
+     * one, valid until the next propagation.
+     */
+    T* predict(T* inputs);
+
+    /**
+     * \brief Amount of values allocated for the transient buffers of the 
+     * layers, that is the arena of the largest plan used so far.
+     * \return size_t
+     */
+    [[nodiscard]] size_t arena_size() const noexcept 
+    { 
+        return _arena.size(); 
+    }
+
     /**
      * \brief Adjust all model parameters of constituent layers using the 
-     * provided optimizer. 
+     * provided optimizer. Layers that are not trainable are skipped.
      * \param optimizer Provided optimizer.
      */
-    void train(Optimizer& optimizer);
+    void train(BasicOptimizer<T>& optimizer);
+
+    /**
+     * \brief Switch the model to inference mode, releasing the gradients, 
+     * the reverse propagation state of the layers and the training plan. 
+     * It cannot be undone: forward(), reverse() and train() throw afterwards.
+     */
+    void freeze();
+
+    /**
+     * \brief Operating mode of the model.
+     * \return ModelMode
+     */
+    [[nodiscard]] ModelMode mode() const noexcept { return _mode; }
 
     /**
      * \brief Model name provided for debugging purposes.
@@ -105,37 +238,190 @@ public:
      */
     void print() const;
 
+    /**
+     * \brief Print the time spent by each layer in forward(), predict(), 
+     * reverse() and train(), sorted by decreasing total, with the call 
+     * counts and the throughputs given by LayerCost estimates. The time of 
+     * forward() and predict() is reported as the forward phase. Measures 
+     * are taken only in builds configured with -DENABLE_PROFILING=true.
+     * \param out Output stream.
+     */
+    void print_profile(std::ostream& out = std::cout) const;
+
+    /**
+     * \brief Measures of the profiler, empty unless profiling is enabled.
+     * \return Profiler const&
+     */
+    [[nodiscard]] Profiler const& profiler() const noexcept 
+    { 
+        return _profiler; 
+    }
+
+    /**
+     * \brief Drop the measures of the profiler, e.g. after a warm-up.
+     */
+    void reset_profile() { _profiler.reset(); }
+
+    /**
+     * \brief Count the cycles, instructions, L1 data and last level cache 
+     * misses and branch misses of each layer with the Linux perf_event_open
+     * counters of the calling thread, that has to be the one that runs the 
+     * model. print_profile() then reports the IPC and the misses per 
+     * thousand instructions. Intra-op work on the ThreadPool is not 
+     * counted.
+     * \return bool Whether profiling is enabled and any counter is 
+     * available; otherwise only the times are measured.
+     */
+    bool enable_perf_counters();
+
     /**
      * \brief Save the model weights to disk.
      * 
-     * To save the model to disk, we employ a very simple scheme. All nodes are
-     * looped through in the order they were added to the model. Then, all
-     * advertised learnable parameters are serialized in host byte-order to the
-     * supplied output stream.
-     *
-     * This simplistic method of saving the model to disk isn't very
-     * robust or practical in the real world. It contains no reflection data 
-     * about the topology of the model. Furthermore, the data will be parsed 
-     * incorrectly if the program is recompiled to operate with a different 
-     * precision. 
+     * The file format is described in model_format.hpp: a versioned header 
+     * with the byte order and the scalar type of this build, a record with 
+     * the type and the shapes of each layer in insertion order and the 
+     * parameter blocks, aligned to pages and written with one call each.
      * 
-     * \param out Out file stream
+     * \param out Out stream, opened in binary mode.
+     */
+    void save(std::ostream& out);
+
+    /**
+     * \brief Load the model weights from a stream, copying them in the 
+     * layers. Any mismatch of format, build or layers, and any corrupted 
+     * parameter block, throws std::runtime_error.
+     * \param in In stream, opened in binary mode.
+     */
+    void load(std::istream& in);
+
+    /**
+     * \brief Load the model weights by memory mapping a file: the layers use 
+     * the parameter blocks in place, without copies, and the mapping lives as
+     * long as the model. Pages are private, so training the model never 
+     * modifies the file. The header and the records are always validated; 
+     * the parameter checksums only on request, since it reads every page.
+     * \param path   Model file.
+     * \param verify Whether to validate the parameter checksums.
      */
-    void save(std::ofstream& out);
+    void load(std::filesystem::path const& path, bool verify = false);
 
     /**
-     * \brief Load the model weights to disk.
-     * \param in In file stream
+     * \brief Export the model as a self-contained C++ header: the weights 
+     * become constexpr arrays and the inference plan a forward() function 
+     * specialized on the layer sizes, without virtual calls, heap 
+     * allocations or file accesses. Loss layers are left out and the output 
+     * is the one of predict(). Only dense layers are supported.
+     *
+     * The generated code performs the same operations of predict() in the 
+     * same order and the weights are written in hexadecimal floating point, 
+     * so built with the same floating-point flags it gives bitwise identical 
+     * results.
+     *
+     * \param path           Header to write.
+     * \param namespace_name Namespace of the generated code, the model name 
+     * by default.
      */
-    void load(std::ifstream& in);
+    void export_cpp(std::filesystem::path const& path, 
+        std::string namespace_name = "");
 
 private:
-    friend class Layer;
+    friend class BasicLayer<T>;
+
+    /// \brief Offset of the buffers not used by a plan.
+    static constexpr size_t _unused = static_cast<size_t>(-1);
+
+    /**
+     * \brief Step of an execution plan, with the arena offsets of its 
+     * buffers.
+     */
+    struct Step
+    {
+        BasicLayer<T>* layer;
+        size_t output{_unused};
+        size_t input_gradient{_unused};
+        size_t scratch{_unused};
+        size_t fan_in{_unused};  ///< Sum of inputs, used with fan-in.
+        size_t fan_out{_unused}; ///< Sum of gradients, used with fan-out.
+        bool reverse{true};      ///< Whether the reverse pass runs it.
+    };
+
+    struct Plan
+    {
+        std::vector<Step> steps;
+        size_t arena_size{0};
+    };
+
+    /**
+     * \brief Plan the buffers of forward() and reverse().
+     * \param order Layers in topological order.
+     */
+    void _plan_training(std::vector<BasicLayer<T>*> const& order);
+
+    /**
+     * \brief Plan the buffers of predict().
+     * \param order Layers in topological order.
+     */
+    void _plan_inference(std::vector<BasicLayer<T>*> const& order);
+
+    /**
+     * \brief Build a plan with the offsets assigned by a planner.
+     * \param planner Planner, after MemoryPlanner::plan().
+     * \param ids     Steps with the buffer identifiers of the planner.
+     * \return Plan
+     */
+    static Plan _resolve(MemoryPlanner const& planner, 
+        std::vector<Step> const& ids);
+
+    /**
+     * \brief Bind the layers to the buffers of a plan, growing the arena if 
+     * needed.
+     * \param plan
+     */
+    void _bind(Plan const& plan);
+
+    /**
+     * \brief Run the forward propagation of the steps of a plan.
+     * \param plan
+     * \param inputs
+     */
+    void _forward(Plan const& plan, T* inputs);
+
+    /**
+     * \brief Layers in insertion order.
+     * \return std::vector<Layer*>
+     */
+    std::vector<BasicLayer<T>*> _layer_list() const;
+
+    /**
+     * \brief Throw if a model file misses some parameter blocks.
+     * \param header
+     */
+    void _check_complete(ModelFormat::Header const& header) const;
+
+    /**
+     * \brief Throw if the model is not in training mode.
+     */
+    void _check_training() const;
+
+    T* _at(size_t offset)
+    {
+        return offset == _unused ? nullptr : _arena.data() + offset;
+    }
 
     std::string _name;                           ///< Model name;
-    std::vector<std::unique_ptr<Layer>> _layers; ///< List of layers pointers;
+    ModelMode _mode;                             ///< Operating mode.
+    std::vector<std::unique_ptr<BasicLayer<T>>> _layers; ///< List of layers.
+    Plan _training;                              ///< Plan of forward/reverse.
+    Plan _inference;                             ///< Plan of predict.
+    Plan const* _bound{nullptr};                 ///< Plan bound to layers.
+    AlignedVector<T> _arena;                     ///< Transient buffers.
+    std::shared_ptr<MappedFile> _mapping;        ///< Mapped parameters.
+    bool _compiled{false};                       ///< Whether plans are valid.
+    Profiler _profiler;                          ///< Per-layer measures.
 };
 
+using Model = BasicModel<NumType>;
+
 } // namespace Ariadne
 
 #endif // ARIADNE_DNN_MODEL_HPP
@@ -0,0 +1,482 @@
+/***************************************************************************
+ *            model_format.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "model_format.hpp"
+
+#include "layer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Ariadne {
+
+namespace {
+
+constexpr char magic[8] = {'A', 'R', 'I', 'A', 'D', 'N', 'E', '\0'};
+
+} // namespace
+
+uint64_t ModelFormat::checksum(void const* data, size_t size, uint64_t seed)
+{
+    auto bytes = static_cast<unsigned char const*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+ModelFormat::LayerRecord ModelFormat::record(std::string const& type, 
+    size_t input_size, size_t output_size, size_t param_count, 
+    size_t block_size)
+{
+    if (type.size() >= type_size)
+    {
+        throw std::runtime_error("layer type " + type + " is too long");
+    }
+    LayerRecord record{};
+    std::copy(type.begin(), type.end(), record.type);
+    record.input_size  = input_size;
+    record.output_size = output_size;
+    record.param_count = param_count;
+    record.block_size  = block_size;
+    return record;
+}
+
+template <typename T>
+std::vector<ModelFormat::LayerRecord> ModelFormat::describe(
+    std::vector<BasicLayer<T>*> const& layers)
+{
+    std::vector<LayerRecord> records;
+    for (auto* layer: layers)
+    {
+        records.push_back(record(layer->type(), layer->input_size(), 
+            layer->output_size(), layer->param_count(), 
+            layer->param_block_size()));
+    }
+    return records;
+}
+
+template <typename T>
+void ModelFormat::layout(Header& header, std::vector<LayerRecord>& records, 
+    std::vector<PageRecord>* pages)
+{
+    header = Header{};
+    std::copy(std::begin(magic), std::end(magic), header.magic);
+    header.version     = version;
+    header.byte_order  = byte_order;
+    header.dtype       = static_cast<uint32_t>(dtype<T>());
+    header.dtype_size  = sizeof(T);
+    header.layer_count = records.size();
+    header.page_count  = pages ? pages->size() : 0;
+
+    uint64_t offset = align(sizeof(Header) 
+        + records.size() * sizeof(LayerRecord)
+        + header.page_count * sizeof(PageRecord));
+    for (LayerRecord& record: records)
+    {
+        record.offset = 0;
+        if (record.block_size == 0 || pages)
+        {
+            continue;
+        }
+        record.offset = offset;
+        offset = align(offset + record.block_size * sizeof(T));
+    }
+    if (pages)
+    {
+        header.flags |= delta;
+        for (PageRecord& page: *pages)
+        {
+            page.offset = offset;
+            offset += page_size;
+        }
+    }
+
+    header.file_size = offset;
+    header.checksum  = pages ? header_checksum(header, records, *pages)
+                             : header_checksum(header, records);
+}
+
+template <typename T>
+void ModelFormat::write(std::ostream& out, Header const& header, 
+    std::vector<LayerRecord> const& records, 
+    std::vector<T const*> const& blocks, 
+    std::vector<PageRecord> const& pages)
+{
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    out.write(reinterpret_cast<char const*>(records.data()), 
+        static_cast<std::streamsize>(records.size() * sizeof(LayerRecord)));
+    out.write(reinterpret_cast<char const*>(pages.data()), 
+        static_cast<std::streamsize>(pages.size() * sizeof(PageRecord)));
+
+    // Blocks and pages are laid out in record order, padding fills the gaps.
+    std::vector<char> padding(alignment, 0);
+    uint64_t position = sizeof(header) + records.size() * sizeof(LayerRecord) 
+        + pages.size() * sizeof(PageRecord);
+    auto put = [&](uint64_t offset, void const* data, uint64_t bytes)
+    {
+        out.write(padding.data(), 
+            static_cast<std::streamsize>(offset - position));
+        out.write(static_cast<char const*>(data), 
+            static_cast<std::streamsize>(bytes));
+        position = offset + bytes;
+    };
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        if (records[i].offset != 0)
+        {
+            put(records[i].offset, blocks[i], 
+                records[i].block_size * sizeof(T));
+        }
+    }
+    for (PageRecord const& page: pages)
+    {
+        uint64_t bytes = records[page.layer].block_size * sizeof(T);
+        put(page.offset, 
+            reinterpret_cast<char const*>(blocks[page.layer]) 
+                + page.page * page_size, 
+            page_bytes(bytes, page.page));
+    }
+    out.write(padding.data(), 
+        static_cast<std::streamsize>(header.file_size - position));
+
+    if (!out)
+    {
+        throw std::runtime_error("cannot write the model file");
+    }
+}
+
+template <typename T>
+void ModelFormat::save(std::ostream& out, std::vector<LayerRecord> records, 
+    std::vector<T const*> const& blocks)
+{
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        if (records[i].block_size > 0)
+        {
+            records[i].checksum = checksum(blocks[i], 
+                records[i].block_size * sizeof(T));
+        }
+    }
+
+    Header header;
+    layout<T>(header, records);
+    write(out, header, records, blocks);
+}
+
+template <typename T>
+void ModelFormat::load(std::istream& in, 
+    std::vector<LayerRecord> const& expected, 
+    std::vector<T*> const& blocks)
+{
+    Header header;
+    std::vector<LayerRecord> records = read_records<T>(in, header);
+    if (header.flags & delta)
+    {
+        throw std::runtime_error("model file is an incremental checkpoint, "
+                                 "restore it with Checkpointer::restore");
+    }
+    auto indices = check_records(header, records, expected);
+
+    // Blocks are stored in record order, the padding is skipped.
+    uint64_t position = sizeof(header) + records.size() * sizeof(LayerRecord);
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        if (indices[i] == npos)
+        {
+            continue;
+        }
+        LayerRecord const& record = records[indices[i]];
+        in.ignore(static_cast<std::streamsize>(record.offset - position));
+        size_t bytes = record.block_size * sizeof(T);
+        in.read(reinterpret_cast<char*>(blocks[i]), 
+            static_cast<std::streamsize>(bytes));
+        if (!in || checksum(blocks[i], bytes) != record.checksum)
+        {
+            throw std::runtime_error("parameters of layer " 
+                + std::to_string(i) + " are corrupted");
+        }
+        position = record.offset + bytes;
+    }
+}
+
+template <typename T>
+std::vector<ModelFormat::LayerRecord> ModelFormat::read_records(
+    std::istream& in, Header& header)
+{
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in)
+    {
+        throw std::runtime_error("cannot read the model file");
+    }
+    check_header<T>(header);
+
+    // The count is not covered by a checksum yet: bound it before the 
+    // allocation.
+    if (header.file_size < sizeof(header) 
+        || header.layer_count > max_layer_count
+        || header.layer_count 
+            > (header.file_size - sizeof(header)) / sizeof(LayerRecord))
+    {
+        throw std::runtime_error("model file header is corrupted");
+    }
+
+    std::vector<LayerRecord> records(header.layer_count);
+    in.read(reinterpret_cast<char*>(records.data()), 
+        static_cast<std::streamsize>(records.size() * sizeof(LayerRecord)));
+    if (!in)
+    {
+        throw std::runtime_error("model file is truncated");
+    }
+    return records;
+}
+
+std::vector<ModelFormat::PageRecord> ModelFormat::read_pages(
+    std::istream& in, Header const& header)
+{
+    uint64_t const records = sizeof(header) 
+        + header.layer_count * sizeof(LayerRecord);
+    if (header.page_count > max_page_count
+        || header.page_count 
+            > (header.file_size - records) / sizeof(PageRecord))
+    {
+        throw std::runtime_error("model file header is corrupted");
+    }
+
+    std::vector<PageRecord> pages(header.page_count);
+    in.read(reinterpret_cast<char*>(pages.data()), 
+        static_cast<std::streamsize>(pages.size() * sizeof(PageRecord)));
+    if (!in)
+    {
+        throw std::runtime_error("model file is truncated");
+    }
+    return pages;
+}
+
+template <typename T>
+void ModelFormat::check_header(Header const& header)
+{
+    if (!std::equal(std::begin(magic), std::end(magic), header.magic))
+    {
+        throw std::runtime_error("not an Ariadne model file");
+    }
+    if (header.version != version)
+    {
+        throw std::runtime_error("unsupported model file version " 
+            + std::to_string(header.version));
+    }
+    if (header.byte_order != byte_order)
+    {
+        throw std::runtime_error("model file written with a different byte "
+                                 "order");
+    }
+    if (header.dtype != static_cast<uint32_t>(dtype<T>()) 
+        || header.dtype_size != sizeof(T))
+    {
+        throw std::runtime_error("model file written with a different scalar "
+                                 "type");
+    }
+}
+
+std::vector<size_t> ModelFormat::check_records(Header const& header, 
+    std::vector<LayerRecord> const& records, 
+    std::vector<LayerRecord> const& expected, 
+    std::vector<PageRecord> const& pages)
+{
+    if (header.page_count != pages.size() 
+        || header_checksum(header, records, pages) != header.checksum)
+    {
+        throw std::runtime_error("model file header is corrupted");
+    }
+
+    auto type_of = [](LayerRecord const& record)
+    {
+        return std::string{record.type, 
+            std::find(record.type, record.type + type_size, '\0')};
+    };
+
+    std::vector<size_t> indices(expected.size(), npos);
+    size_t next = 0;
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        LayerRecord const& layer = expected[i];
+        if (layer.block_size == 0)
+        {
+            continue;
+        }
+        while (next < records.size() && records[next].block_size == 0)
+        {
+            ++next;
+        }
+        if (next == records.size())
+        {
+            throw std::runtime_error("model file misses the parameters of "
+                                     "layer " + std::to_string(i) + " " 
+                                     + type_of(layer));
+        }
+
+        LayerRecord const& record = records[next];
+        if (type_of(record) != type_of(layer) 
+            || record.input_size != layer.input_size
+            || record.output_size != layer.output_size
+            || record.param_count != layer.param_count
+            || record.block_size != layer.block_size)
+        {
+            throw std::runtime_error("layer " + std::to_string(i) + " " 
+                + type_of(layer) + " does not match the model file record " 
+                + type_of(record));
+        }
+        if ((record.offset != 0 || !(header.flags & delta))
+            && (record.offset == 0 || record.offset % alignment != 0 
+                || record.offset + record.block_size * header.dtype_size 
+                    > header.file_size))
+        {
+            throw std::runtime_error("layer " + std::to_string(i) + " " 
+                + type_of(layer) + " has an invalid parameter block");
+        }
+        indices[i] = next++;
+    }
+
+    for (; next < records.size(); ++next)
+    {
+        if (records[next].block_size > 0)
+        {
+            throw std::runtime_error("model file has more layers with "
+                                     "parameters than the model");
+        }
+    }
+
+    for (PageRecord const& page: pages)
+    {
+        if (!(header.flags & delta) || page.layer >= records.size()
+            || page.page >= ModelFormat::pages(
+                records[page.layer].block_size * header.dtype_size)
+            || page.offset == 0 || page.offset % alignment != 0 
+            || page.offset + page_size > header.file_size)
+        {
+            throw std::runtime_error("model file has an invalid page of "
+                                     "layer " + std::to_string(page.layer));
+        }
+    }
+    return indices;
+}
+
+template <typename T>
+std::vector<size_t> ModelFormat::check_records(Header const& header, 
+    std::vector<LayerRecord> const& records, 
+    std::vector<BasicLayer<T>*> const& layers, 
+    std::vector<PageRecord> const& pages)
+{
+    return check_records(header, records, describe(layers), pages);
+}
+
+uint64_t ModelFormat::header_checksum(Header const& header, 
+    std::vector<LayerRecord> const& records, 
+    std::vector<PageRecord> const& pages)
+{
+    Header copy = header;
+    copy.checksum = 0;
+    uint64_t hash = checksum(&copy, sizeof(Header));
+    hash = checksum(records.data(), records.size() * sizeof(LayerRecord), 
+        hash);
+    return checksum(pages.data(), pages.size() * sizeof(PageRecord), hash);
+}
+
+template std::vector<ModelFormat::LayerRecord> ModelFormat::describe(
+    std::vector<BasicLayer<float>*> const&);
+template std::vector<ModelFormat::LayerRecord> ModelFormat::describe(
+    std::vector<BasicLayer<double>*> const&);
+template void ModelFormat::layout<float>(Header&, std::vector<LayerRecord>&, 
+    std::vector<PageRecord>*);
+template void ModelFormat::layout<double>(Header&, std::vector<LayerRecord>&, 
+    std::vector<PageRecord>*);
+template void ModelFormat::write(std::ostream&, Header const&, 
+    std::vector<LayerRecord> const&, std::vector<float const*> const&, 
+    std::vector<PageRecord> const&);
+template void ModelFormat::write(std::ostream&, Header const&, 
+    std::vector<LayerRecord> const&, std::vector<double const*> const&, 
+    std::vector<PageRecord> const&);
+template void ModelFormat::save(std::ostream&, std::vector<LayerRecord>, 
+    std::vector<float const*> const&);
+template void ModelFormat::save(std::ostream&, std::vector<LayerRecord>, 
+    std::vector<double const*> const&);
+template void ModelFormat::load(std::istream&, 
+    std::vector<LayerRecord> const&, std::vector<float*> const&);
+template void ModelFormat::load(std::istream&, 
+    std::vector<LayerRecord> const&, std::vector<double*> const&);
+template std::vector<ModelFormat::LayerRecord> 
+ModelFormat::read_records<float>(std::istream&, Header&);
+template std::vector<ModelFormat::LayerRecord> 
+ModelFormat::read_records<double>(std::istream&, Header&);
+template void ModelFormat::check_header<float>(Header const&);
+template void ModelFormat::check_header<double>(Header const&);
+template std::vector<size_t> ModelFormat::check_records(Header const&, 
+    std::vector<LayerRecord> const&, std::vector<BasicLayer<float>*> const&, 
+    std::vector<PageRecord> const&);
+template std::vector<size_t> ModelFormat::check_records(Header const&, 
+    std::vector<LayerRecord> const&, std::vector<BasicLayer<double>*> const&, 
+    std::vector<PageRecord> const&);
+
+MappedFile::MappedFile(std::filesystem::path const& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("cannot open " + path.string());
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("cannot map empty file " + path.string());
+    }
+    _size = static_cast<size_t>(st.st_size);
+
+    void* data = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, 
+        fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error("cannot map " + path.string());
+    }
+    _data = static_cast<std::byte*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    ::munmap(_data, _size);
+}
+
+} // namespace Ariadne
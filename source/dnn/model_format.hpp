@@ -0,0 +1,359 @@
+/***************************************************************************
+ *            model_format.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file model_format.hpp
+ *  \brief Versioned binary format of the model parameters.
+ *
+ *  A model file is made of:
+ *  - a Header, with the magic, the format version, the byte order and the 
+ *    scalar type of the host that wrote it;
+ *  - one LayerRecord for each layer, in insertion order, with its type, 
+ *    shapes and the offset and checksum of its parameter block;
+ *  - the parameter blocks, each one aligned to ModelFormat::alignment bytes
+ *    so that it can be used in place from a memory mapping.
+ *
+ *  Incremental checkpoints set the delta flag and store only the pages of 
+ *  the parameter blocks that changed: the layer records have offset 0 and 
+ *  are followed by one PageRecord for each page stored, with its offset 
+ *  and checksum.
+ */
+
+#ifndef ARIADNE_DNN_MODEL_FORMAT_HPP
+#define ARIADNE_DNN_MODEL_FORMAT_HPP
+
+#include "type.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace Ariadne {
+
+template <typename T> class BasicLayer;
+
+/**
+ * \brief Layout and helpers of the model file format.
+ */
+class ModelFormat
+{
+public:
+    /// \brief Current format version.
+    static constexpr uint32_t version = 4;
+    /// \brief Written in host order, read back reversed on another order.
+    static constexpr uint32_t byte_order = 0x01020304;
+    /// \brief Alignment of the parameter blocks, a multiple of the page size.
+    static constexpr uint64_t alignment = 4096;
+    /// \brief Size in bytes of the pages of the parameter blocks compared 
+    /// and stored by incremental checkpoints.
+    static constexpr uint64_t page_size = alignment;
+    /// \brief Size of the type name of a LayerRecord, terminator included.
+    static constexpr size_t type_size = 32;
+    /// \brief Header flag of the files that miss some parameter blocks.
+    static constexpr uint32_t delta = 1;
+    /// \brief Largest amount of layer records accepted in a file.
+    static constexpr uint64_t max_layer_count = 1ULL << 16;
+    /// \brief Largest amount of page records accepted in a file.
+    static constexpr uint64_t max_page_count = 1ULL << 32;
+    /// \brief Index of the records that have no counterpart.
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    struct Header
+    {
+        char magic[8];        ///< "ARIADNE" and a terminator.
+        uint32_t version;     ///< Format version.
+        uint32_t byte_order;  ///< byte_order in the writer order.
+        uint32_t dtype;       ///< DType of the parameters.
+        uint32_t dtype_size;  ///< Size of a parameter in bytes.
+        uint32_t flags;       ///< Bitwise or of the flags, as delta.
+        uint32_t reserved;    ///< Padding, 0.
+        uint64_t layer_count; ///< Amount of LayerRecord after the header.
+        uint64_t page_count;  ///< Amount of PageRecord after the layers.
+        uint64_t file_size;   ///< Size of the whole file in bytes.
+        uint64_t checksum;    ///< Checksum of header and records.
+    };
+
+    struct LayerRecord
+    {
+        char type[type_size];  ///< Layer::type() of the layer.
+        uint64_t input_size;   ///< Layer::input_size().
+        uint64_t output_size;  ///< Layer::output_size().
+        uint64_t param_count;  ///< Layer::param_count().
+        uint64_t block_size;   ///< Layer::param_block_size(), values stored.
+        uint64_t offset;       ///< Offset of the parameter block in the file.
+        uint64_t checksum;     ///< Checksum of the parameter block.
+    };
+
+    struct PageRecord
+    {
+        uint64_t layer;    ///< Index of the LayerRecord of the page.
+        uint64_t page;     ///< Index of the page in the parameter block.
+        uint64_t offset;   ///< Offset of the page in the file.
+        uint64_t checksum; ///< Checksum of the page.
+    };
+
+    /**
+     * \brief DType of a scalar type.
+     * \tparam T Scalar type.
+     * \return DType
+     */
+    template <typename T>
+    static constexpr DType dtype()
+    {
+        static_assert(sizeof(T) == 4 || sizeof(T) == 8, 
+            "unsupported scalar type");
+        return sizeof(T) == 4 ? DType::Float32 : DType::Float64;
+    }
+
+    /**
+     * \brief FNV-1a checksum of a buffer.
+     * \param data Buffer.
+     * \param size Size of the buffer in bytes.
+     * \param seed Checksum of the previous data, to chain buffers.
+     * \return uint64_t
+     */
+    static uint64_t checksum(void const* data, size_t size, 
+        uint64_t seed = 0xcbf29ce484222325ULL);
+
+    /**
+     * \brief Round an offset up to the block alignment.
+     * \param offset
+     * \return uint64_t
+     */
+    static constexpr uint64_t align(uint64_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    /**
+     * \brief Amount of pages of a parameter block, the last one partial.
+     * \param bytes Size of the block in bytes.
+     * \return uint64_t
+     */
+    static constexpr uint64_t pages(uint64_t bytes)
+    {
+        return (bytes + page_size - 1) / page_size;
+    }
+
+    /**
+     * \brief Size in bytes of a page of a parameter block.
+     * \param bytes Size of the block in bytes.
+     * \param page  Index of the page.
+     * \return uint64_t
+     */
+    static constexpr uint64_t page_bytes(uint64_t bytes, uint64_t page)
+    {
+        return std::min(page_size, bytes - page * page_size);
+    }
+
+    /**
+     * \brief Record of a layer, with offset and checksum left to 0.
+     * \param type        Layer::type() of the layer.
+     * \param input_size
+     * \param output_size
+     * \param param_count
+     * \param block_size  Size of the parameter block, padding included.
+     * \return LayerRecord
+     */
+    static LayerRecord record(std::string const& type, size_t input_size, 
+        size_t output_size, size_t param_count, size_t block_size);
+
+    /**
+     * \brief Describe the types and the shapes of the layers of a model. 
+     * Offsets and checksums are left to 0.
+     * \param layers Layers of the model, in insertion order.
+     * \return std::vector<LayerRecord> 
+     */
+    template <typename T>
+    static std::vector<LayerRecord> describe(
+        std::vector<BasicLayer<T>*> const& layers);
+
+    /**
+     * \brief Fill the header and assign the offsets of the parameter blocks.
+     * The block checksums have to be already set in the records.
+     * \tparam T       Scalar type of the parameters.
+     * \param header  Header filled with the layout of the file.
+     * \param records Records of the layers.
+     * \param pages   Pages stored by an incremental checkpoint, with layer, 
+     * page and checksum set, or nullptr for a complete file. Incremental 
+     * checkpoints get the delta flag and store no whole block.
+     */
+    template <typename T>
+    static void layout(Header& header, std::vector<LayerRecord>& records, 
+        std::vector<PageRecord>* pages = nullptr);
+
+    /**
+     * \brief Write a file laid out with layout().
+     * \param out     Out stream, opened in binary mode.
+     * \param header
+     * \param records
+     * \param blocks  Parameter block of each record, nullptr for the 
+     * records without parameters.
+     * \param pages   Pages of an incremental checkpoint.
+     */
+    template <typename T>
+    static void write(std::ostream& out, Header const& header, 
+        std::vector<LayerRecord> const& records, 
+        std::vector<T const*> const& blocks, 
+        std::vector<PageRecord> const& pages = {});
+
+    /**
+     * \brief Write a complete model file: compute the block checksums, lay 
+     * out and write the file.
+     * \param out     Out stream, opened in binary mode.
+     * \param records Records of the layers, as returned by describe().
+     * \param blocks  Parameter block of each record, nullptr for the 
+     * records without parameters.
+     */
+    template <typename T>
+    static void save(std::ostream& out, std::vector<LayerRecord> records, 
+        std::vector<T const*> const& blocks);
+
+    /**
+     * \brief Read a complete model file into the parameter blocks of a 
+     * model, validating it against the expected records. Throw 
+     * std::runtime_error on mismatch or corruption.
+     * \param in       In stream, opened in binary mode.
+     * \param expected Records of the model, as returned by describe().
+     * \param blocks   Parameter block of each record, nullptr for the 
+     * records without parameters.
+     */
+    template <typename T>
+    static void load(std::istream& in, 
+        std::vector<LayerRecord> const& expected, 
+        std::vector<T*> const& blocks);
+
+    /**
+     * \brief Read and validate the header of a file with check_header(), 
+     * then read its layer records. The amount of records is bounded by the 
+     * file size in the header and by max_layer_count before anything is 
+     * allocated. Throw std::runtime_error on mismatch or short reads; the 
+     * records still have to be validated with check_records().
+     * \tparam T     Scalar type of the model that reads the file.
+     * \param in     In stream, opened in binary mode, at the file start.
+     * \param header Header read.
+     * \return std::vector<LayerRecord> Records read.
+     */
+    template <typename T>
+    static std::vector<LayerRecord> read_records(std::istream& in, 
+        Header& header);
+
+    /**
+     * \brief Read the page records that follow the layer records read with 
+     * read_records(). Their amount is bounded as the one of the layers. 
+     * Throw std::runtime_error on short reads; the pages still have to be 
+     * validated with check_records().
+     * \param in     In stream, right after the layer records.
+     * \param header Header read by read_records().
+     * \return std::vector<PageRecord> Pages read.
+     */
+    static std::vector<PageRecord> read_pages(std::istream& in, 
+        Header const& header);
+
+    /**
+     * \brief Validate a header against this build: magic, version, byte 
+     * order and scalar type. Throw std::runtime_error on mismatch.
+     * \tparam T Scalar type of the model that reads the file.
+     * \param header
+     */
+    template <typename T>
+    static void check_header(Header const& header);
+
+    /**
+     * \brief Validate the records read from a file against the records 
+     * expected by a model and the checksum of the header. Records without 
+     * parameters, as the ones of the loss layers, carry no data and are 
+     * skipped on both sides, the others have to match one to one and in 
+     * order. Pages have to belong to the blocks of their layers. Throw 
+     * std::runtime_error on mismatch.
+     * \param header
+     * \param records  Records read from the file.
+     * \param expected Records of the model, in insertion order.
+     * \param pages    Pages read from the file.
+     * \return std::vector<size_t> Index of the file record of each expected 
+     * record, npos for the ones without parameters.
+     */
+    static std::vector<size_t> check_records(Header const& header, 
+        std::vector<LayerRecord> const& records, 
+        std::vector<LayerRecord> const& expected, 
+        std::vector<PageRecord> const& pages = {});
+
+    /**
+     * \brief Validate the records read from a file against the layers of a 
+     * model, see check_records() above.
+     * \param header
+     * \param records
+     * \param layers Layers of the model, in insertion order.
+     * \param pages
+     * \return std::vector<size_t> Index of the file record of each layer.
+     */
+    template <typename T>
+    static std::vector<size_t> check_records(Header const& header, 
+        std::vector<LayerRecord> const& records, 
+        std::vector<BasicLayer<T>*> const& layers, 
+        std::vector<PageRecord> const& pages = {});
+
+    /**
+     * \brief Checksum of a header and its records, computed with the 
+     * checksum field of the header set to 0.
+     * \param header
+     * \param records
+     * \param pages
+     * \return uint64_t
+     */
+    static uint64_t header_checksum(Header const& header, 
+        std::vector<LayerRecord> const& records, 
+        std::vector<PageRecord> const& pages = {});
+};
+
+/**
+ * \brief Read-only private memory mapping of a file. Pages written by the 
+ * process are copied on write and never reach the file.
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(std::filesystem::path const& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    [[nodiscard]] std::byte* data() const noexcept { return _data; }
+    [[nodiscard]] size_t size() const noexcept { return _size; }
+
+private:
+    std::byte* _data{nullptr};
+    size_t _size{0};
+};
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_MODEL_FORMAT_HPP
@@ -28,23 +28,22 @@
 
 namespace Ariadne {
 
-MSELossLayer::MSELossLayer(Model& model, std::string name, 
-    uint16_t input_size, size_t batch_size, NumType loss_tolerance)
-    : Layer(model, name)
+template <typename T>
+BasicMSELossLayer<T>::BasicMSELossLayer(BasicModel<T>& model, 
+    std::string name, uint16_t input_size, size_t batch_size, T loss_tolerance)
+    : BasicLossLayer<T>(model, name)
     , _input_size{input_size}
     , _loss_tolerance{loss_tolerance}
-    , _inv_batch_size{NumType{1.0} / batch_size}
-{ 
-    /* 
-     * When we deliver a gradient back, we deliver just the loss gradient with
-     * respect to any input and the index that was "hot" in the second argument.
-     */
-    _gradients.resize(_input_size);
-}
+    , _inv_batch_size{T{1.0} / batch_size}
+{ }
 
-void MSELossLayer::forward(NumType* inputs)
+template <typename T>
+void BasicMSELossLayer<T>::forward(BasicTensorView<T const> inputs)
 {
-    _loss = DLMath::mean_squared_error(_target, inputs, _input_size);
+    this->_check_size(inputs, _input_size, "inputs");
+    ScratchScope scratch;
+    T const* y_hat = DLMath::contiguous(inputs, scratch);
+    _loss = DLMath::mean_squared_error(_target, y_hat, _input_size);
     _cumulative_loss += _loss;
 
     if (-_loss_tolerance <= _loss && _loss <= _loss_tolerance)
@@ -60,48 +59,78 @@ void MSELossLayer::forward(NumType* inputs)
     _last_input = inputs;
 }
 
-void MSELossLayer::reverse(NumType* gradients)
+template <typename T>
+void BasicMSELossLayer<T>::reverse(BasicTensorView<T const> gradients)
 {
     // Parameter ignored because it is a loss layer.
     (void) gradients;
 
-    DLMath::mean_squared_error_1(_gradients.data(), _target, _last_input, 
-        _inv_batch_size, _input_size);
+    ScratchScope scratch;
+    DLMath::mean_squared_error_1(_gradients, _target, 
+        DLMath::contiguous(_last_input, scratch), _inv_batch_size, 
+        _input_size);
+}
 
-    for (auto* l: _antecedents)
+template <typename T>
+LayerCost BasicMSELossLayer<T>::cost(Phase phase) const noexcept
+{
+    double const inputs = _input_size;
+    if (phase == Phase::Forward)
+    {
+        return {3.0 * inputs, 2.0 * sizeof(T) * inputs};
+    }
+    if (phase == Phase::Reverse)
     {
-        l->reverse(_gradients.data());
+        return {3.0 * inputs, 3.0 * sizeof(T) * inputs};
     }
+    return BasicLayer<T>::cost(phase);
 }
 
-void MSELossLayer::print() const
+template <typename T>
+void BasicMSELossLayer<T>::print() const
 {
     std::printf("Avg Loss: %f\t%f%% correct\n", avg_loss(), accuracy() * 100.0);
 }
 
-void MSELossLayer::set_target(NumType const* target)
+template <typename T>
+std::unique_ptr<BasicLayer<T>> BasicMSELossLayer<T>::clone(
+    BasicModel<T>& model) const
+{
+    auto layer = std::make_unique<BasicMSELossLayer>(model, _name, 
+        _input_size, 1, _loss_tolerance);
+    layer->_inv_batch_size = _inv_batch_size;
+    return layer;
+}
+
+template <typename T>
+void BasicMSELossLayer<T>::set_target(T const* target)
 {
     _target = target;
 }
 
-NumType MSELossLayer::accuracy() const
+template <typename T>
+T BasicMSELossLayer<T>::accuracy() const
 {
-    return static_cast<NumType>(_correct) 
-         / static_cast<NumType>(_correct + _incorrect);
+    return static_cast<T>(_correct) 
+         / static_cast<T>(_correct + _incorrect);
 }
 
-NumType MSELossLayer::avg_loss() const
+template <typename T>
+T BasicMSELossLayer<T>::avg_loss() const
 {
-    return static_cast<NumType>(_cumulative_loss) 
-         / static_cast<NumType>(_correct + _incorrect);
+    return static_cast<T>(_cumulative_loss) 
+         / static_cast<T>(_correct + _incorrect);
 }
 
-void MSELossLayer::reset_score()
+template <typename T>
+void BasicMSELossLayer<T>::reset_score()
 {
     _cumulative_loss = 0.0;
     _correct         = 0.0;
     _incorrect       = 0.0;
 }
 
+template class BasicMSELossLayer<float>;
+template class BasicMSELossLayer<double>;
 
 } // namespace Ariadne
\ No newline at end of file
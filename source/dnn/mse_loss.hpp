@@ -29,17 +29,22 @@
 #ifndef ARIADNE_DNN_MSE_LOSS_HPP
 #define ARIADNE_DNN_MSE_LOSS_HPP
 
-#include "layer.hpp"
+#include "loss.hpp"
 #include "model.hpp"
 
 #include <string>
 
 namespace Ariadne {
 
-class MSELossLayer : public Layer {
+/**
+ * \brief Mean squared error loss layer.
+ * \tparam T Scalar type of the model.
+ */
+template <typename T>
+class BasicMSELossLayer : public BasicLossLayer<T> {
 public:
-    MSELossLayer(Model& model, std::string name, uint16_t input_size, 
-        size_t batch_size, NumType loss_tolerance=0.1);
+    BasicMSELossLayer(BasicModel<T>& model, std::string name, 
+        uint16_t input_size, size_t batch_size, T loss_tolerance=0.1);
 
     /**
      * \brief No initiallization is needed for this layer.
@@ -47,46 +52,62 @@ public:
      */
     void init(RneType& rne) override { (void) rne; };
 
-    void forward(NumType* inputs) override;
+    void forward(BasicTensorView<T const> inputs) override;
 
     /**
      * \brief As a loss node, the argument to this method is ignored (the 
      * gradient of the loss with respect to itself is unity).
      * \param gradients
      */
-    void reverse(NumType* gradients = nullptr) override;
+    void reverse(BasicTensorView<T const> gradients = {}) override;
+
+    T* input_gradient() override { return _gradients; }
+    size_t input_size() const noexcept override { return _input_size; }
+
+    void bind_buffers(BasicLayerBuffers<T> const& buffers) override
+    {
+        _gradients = buffers.input_gradient;
+    }
 
+    LayerCost cost(Phase phase) const noexcept override;
+    std::string type() const override { return "mse_loss"; }
     void print() const override;
 
+    std::unique_ptr<BasicLayer<T>> clone(BasicModel<T>& model) const override;
+
     /**
      * \brief Set the target object.
      * During training, this must be set to the expected target distribution for 
      * a given sample.
      * \param target
      */
-    void set_target(NumType const* target);
+    void set_target(T const* target) override;
 
-    NumType accuracy() const;
-    NumType avg_loss() const;
-    void reset_score();
+    T accuracy() const override;
+    T avg_loss() const override;
+    void reset_score() override;
 
 private:
+    using BasicLayer<T>::_name;
+
     uint16_t _input_size;
-    NumType _loss;
-    NumType _cumulative_loss{0.0};
-    NumType _loss_tolerance;
-    const NumType* _target;
-    NumType* _last_input;
+    T _loss;
+    T _cumulative_loss{0.0};
+    T _loss_tolerance;
+    const T* _target;
+    BasicTensorView<T const> _last_input;
 
-    std::vector<NumType> _gradients;
+    T* _gradients{nullptr}; ///< Input gradients, bound by the Model.
 
-    NumType _inv_batch_size; ///< Used to scale with batch size.
+    T _inv_batch_size; ///< Used to scale with batch size.
     
     // Running counts of correct and incorrect predictions.
     size_t _correct{0};
     size_t _incorrect{0};
 };
 
+using MSELossLayer = BasicMSELossLayer<NumType>;
+
 } // namespace Ariadne
  
 #endif // ARIADNE_DNN_MSE_LOSS_HPP
\ No newline at end of file
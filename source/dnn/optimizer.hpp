@@ -36,13 +36,29 @@ namespace Ariadne {
 
 /**
  * \brief Base class of optimizer used to train a model.
+ * \tparam T Scalar type of the model.
  */
-class Optimizer
+template <typename T>
+class BasicOptimizer
 {
 public:
-    virtual void train(Layer& layer) = 0;
+    virtual void train(BasicLayer<T>& layer) = 0;
+
+    /**
+     * \brief Apply the gradients of a layer to a copy of its parameters 
+     * updated concurrently by other threads, as in Hogwild training. Each 
+     * shared parameter is read and written with relaxed atomic operations: 
+     * the update takes no lock and is free of data races, but the updates 
+     * of other threads between the read and the write are lost.
+     * \param layer  Layer with the gradients, reset once applied.
+     * \param params Shared parameter block, with the layout of the one of 
+     * the layer.
+     */
+    virtual void train_shared(BasicLayer<T>& layer, T* params) = 0;
 };
 
+using Optimizer = BasicOptimizer<NumType>;
+
 } // namespace Ariadne
  
 #endif // ARIADNE_DNN_OPTIMIZER_HPP
\ No newline at end of file
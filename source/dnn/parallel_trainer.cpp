@@ -0,0 +1,329 @@
+/***************************************************************************
+ *            parallel_trainer.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "parallel_trainer.hpp"
+
+#include "dlmath.hpp"
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <utility>
+
+namespace Ariadne {
+
+template <typename T>
+BasicParallelTrainer<T>::BasicParallelTrainer(BasicModel<T>& model, 
+    BasicLossLayer<T>& loss_layer, BasicOptimizer<T>& optimizer,
+    std::vector<std::vector<T>> const& inputs,
+    std::vector<std::vector<T>> const& targets,
+    size_t batch_size, size_t threads, ParallelMode mode)
+    : _model{model}
+    , _optimizer{optimizer}
+    , _inputs{inputs}
+    , _targets{targets}
+    , _batch_size{batch_size}
+    , _mode{mode}
+    , _workers(threads)
+    , _sync{static_cast<std::ptrdiff_t>(threads)}
+{
+    if (_inputs.empty() || _inputs.size() != _targets.size())
+    {
+        throw std::runtime_error("inputs and targets have to be non empty "
+                                 "and of the same size");
+    }
+
+    if (_batch_size == 0 || threads == 0)
+    {
+        throw std::runtime_error("batch_size and threads have to be greater "
+                                 "than 0");
+    }
+
+    size_t loss_index = _model.node_index(loss_layer);
+    for (auto& w: _workers)
+    {
+        w.replica = _model.replicate();
+        w.loss_layer = static_cast<BasicLossLayer<T>*>(
+            &w.replica->node(loss_index));
+
+        // Replicas read the parameters of the trained model in place, but 
+        // those written by the other Hogwild workers, copied in _refresh().
+        for (size_t i = 0; i < _model.node_count(); ++i)
+        {
+            BasicLayer<T>& layer = _model.node(i);
+            if (layer.param_block_size() == 0)
+            {
+                continue;
+            }
+            if (_mode == ParallelMode::Synchronous || !layer.trainable())
+            {
+                w.replica->node(i).bind_params(layer.param(0));
+            }
+            if (layer.trainable())
+            {
+                w.trainables.push_back(&w.replica->node(i));
+                w.shared.push_back(layer.param(0));
+            }
+        }
+    }
+
+    for (size_t i = 1; i < threads; ++i)
+    {
+        _threads.emplace_back(&BasicParallelTrainer<T>::_loop, this, i);
+    }
+}
+
+template <typename T>
+BasicParallelTrainer<T>::~BasicParallelTrainer()
+{
+    _stop = true;
+    _sync.arrive_and_wait();
+    for (auto& t: _threads)
+    {
+        t.join();
+    }
+}
+
+template <typename T>
+void BasicParallelTrainer<T>::step()
+{
+    size_t samples = _batch_size;
+    if (_mode == ParallelMode::Hogwild)
+    {
+        samples *= _workers.size();
+    }
+    _run(std::min(_cursor + samples, _inputs.size()));
+}
+
+template <typename T>
+void BasicParallelTrainer<T>::run_epoch()
+{
+    if (_mode == ParallelMode::Hogwild)
+    {
+        _run(_inputs.size());
+        return;
+    }
+
+    size_t epoch = _epoch;
+    while (_epoch == epoch)
+    {
+        step();
+    }
+}
+
+template <typename T>
+T BasicParallelTrainer<T>::avg_loss() const
+{
+    T loss{0.0};
+    size_t samples = 0;
+    for (auto& w: _workers)
+    {
+        if (w.samples > 0)
+        {
+            loss += w.loss_layer->avg_loss() * static_cast<T>(w.samples);
+            samples += w.samples;
+        }
+    }
+    return samples > 0 ? loss / static_cast<T>(samples) : T{0.0};
+}
+
+template <typename T>
+void BasicParallelTrainer<T>::_run(size_t end)
+{
+    ARIADNE_TRACE_SCOPE("batch", "step");
+
+    // Scores are kept for the whole epoch and dropped when a new one starts.
+    if (_cursor == 0)
+    {
+        for (auto& w: _workers)
+        {
+            w.loss_layer->reset_score();
+            w.samples = 0;
+        }
+    }
+
+    _batch_end = end;
+
+    // Wake up the helpers and take part in the work as worker 0.
+    _sync.arrive_and_wait();
+    _work(0);
+
+    for (auto& w: _workers)
+    {
+        _batches += std::exchange(w.batches, 0);
+        if (w.error)
+        {
+            std::rethrow_exception(std::exchange(w.error, nullptr));
+        }
+    }
+
+    if (_mode == ParallelMode::Synchronous)
+    {
+        // The reduced gradients are in worker 0, bound to the parameters.
+        for (auto* layer: _workers.front().trainables)
+        {
+            _optimizer.train(*layer);
+        }
+        ++_batches;
+    }
+
+    _cursor = _batch_end;
+    if (_cursor == _inputs.size())
+    {
+        _cursor = 0;
+        ++_epoch;
+    }
+}
+
+template <typename T>
+void BasicParallelTrainer<T>::_loop(size_t index)
+{
+    for (;;)
+    {
+        _sync.arrive_and_wait();
+        if (_stop)
+        {
+            return;
+        }
+        _work(index);
+    }
+}
+
+template <typename T>
+void BasicParallelTrainer<T>::_work(size_t index)
+{
+    try
+    {
+        _evaluate(index);
+    }
+    catch (...)
+    {
+        _workers[index].error = std::current_exception();
+    }
+    _sync.arrive_and_wait();
+
+    if (_mode == ParallelMode::Hogwild)
+    {
+        return;
+    }
+
+    /*
+     * Pairwise tree reduction: at each level the worker i accumulates the
+     * gradients of worker i + stride. The pairs of a level are disjoint and
+     * the order of the levels is fixed, so the sum is deterministic.
+     */
+    size_t const count = _workers.size();
+    for (size_t stride = 1; stride < count; stride *= 2)
+    {
+        if (index % (2 * stride) == 0 && index + stride < count)
+        {
+            _reduce(index, index + stride);
+        }
+        _sync.arrive_and_wait();
+    }
+}
+
+template <typename T>
+void BasicParallelTrainer<T>::_evaluate(size_t index)
+{
+    ARIADNE_TRACE_SCOPE("batch", "samples");
+    Worker& w = _workers[index];
+    size_t const count   = _workers.size();
+    size_t const samples = _batch_end - _cursor;
+    size_t const begin   = _cursor + (samples * index) / count;
+    size_t const end     = _cursor + (samples * (index + 1)) / count;
+
+    bool const hogwild = _mode == ParallelMode::Hogwild;
+    size_t pending = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (hogwild && pending == 0)
+        {
+            _refresh(w);
+        }
+        w.loss_layer->set_target(_targets[i].data());
+        w.replica->forward(const_cast<T*>(_inputs[i].data()));
+        w.replica->reverse();
+
+        if (hogwild && ++pending == _batch_size)
+        {
+            _apply(w);
+            pending = 0;
+        }
+    }
+
+    if (hogwild && pending > 0)
+    {
+        _apply(w);
+    }
+    w.samples += end - begin;
+}
+
+template <typename T>
+void BasicParallelTrainer<T>::_apply(Worker& w)
+{
+    // Lock-free update of the shared parameters.
+    for (size_t i = 0; i < w.trainables.size(); ++i)
+    {
+        _optimizer.train_shared(*w.trainables[i], w.shared[i]);
+    }
+    ++w.batches;
+}
+
+template <typename T>
+void BasicParallelTrainer<T>::_refresh(Worker& w)
+{
+    for (size_t i = 0; i < w.trainables.size(); ++i)
+    {
+        T* params = w.trainables[i]->param(0);
+        size_t n  = w.trainables[i]->param_block_size();
+        for (size_t j = 0; j < n; ++j)
+        {
+            params[j] = std::atomic_ref<T>{w.shared[i][j]}.load(
+                std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+void BasicParallelTrainer<T>::_reduce(size_t dst, size_t src)
+{
+    ARIADNE_TRACE_SCOPE("batch", "reduce");
+    auto& dst_layers = _workers[dst].trainables;
+    auto& src_layers = _workers[src].trainables;
+    for (size_t i = 0; i < dst_layers.size(); ++i)
+    {
+        size_t n = dst_layers[i]->param_block_size();
+        T* dst_grad = dst_layers[i]->gradient(0);
+        T* src_grad = src_layers[i]->gradient(0);
+        DLMath::arr_sum(dst_grad, dst_grad, src_grad, n);
+        std::fill(src_grad, src_grad + n, T{0.0});
+    }
+}
+
+template class BasicParallelTrainer<float>;
+template class BasicParallelTrainer<double>;
+
+} // namespace Ariadne
@@ -0,0 +1,225 @@
+/***************************************************************************
+ *            parallel_trainer.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*! \file parallel_trainer.hpp
+ *  \brief Data-parallel mini-batch trainer.
+ */
+
+#ifndef ARIADNE_DNN_PARALLEL_TRAINER_HPP
+#define ARIADNE_DNN_PARALLEL_TRAINER_HPP
+
+#include "loss.hpp"
+#include "model.hpp"
+#include "optimizer.hpp"
+#include "type.hpp"
+
+#include <barrier>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Synchronization policy of the workers of a ParallelTrainer.
+ */
+enum class ParallelMode
+{
+    /// Gradients are reduced and applied once per mini-batch.
+    Synchronous,
+    /**
+     * Lock-free asynchronous SGD (Hogwild!, Niu et al. 2011): each worker
+     * applies the optimizer to the shared parameters after each of its own
+     * mini-batches, without any synchronization with the other workers.
+     */
+    Hogwild
+};
+
+/**
+ * \brief Data-parallel mini-batch SGD.
+ *
+ * Each mini-batch is split in contiguous slices, one for each worker. A
+ * worker evaluates its slice on a private replica of the model, whose layers
+ * have their own activation and gradient buffers but read the parameters of
+ * the trained model in place. At the end of the mini-batch the replica
+ * gradients are summed with a pairwise tree reduction in a fixed order and
+ * the optimizer is applied once. The slicing and the reduction order only
+ * depend on the amount of workers, so results are bitwise reproducible for a
+ * given thread count.
+ *
+ * The calling thread acts as worker 0, so a trainer with one thread runs
+ * exactly as Trainer.
+ *
+ * In ParallelMode::Hogwild the workers do not reduce the gradients: every
+ * worker runs its own mini-batches on its slice of the samples and updates
+ * the shared parameters right away with Optimizer::train_shared(). Replicas
+ * compute on a private copy of the trained parameters, refreshed before each
+ * of their mini-batches; both the refresh and the update access the shared
+ * parameters with relaxed atomic operations, without locks. Concurrent 
+ * updates of the same parameter can be lost and results are not 
+ * reproducible; this is the trade-off of Hogwild, that converges when 
+ * updates are sparse or small. The optimizer is called concurrently by the
+ * workers, so it must not keep state across calls.
+ * \tparam T Scalar type of the model.
+ */
+template <typename T>
+class BasicParallelTrainer
+{
+public:
+    /**
+     * \brief Construct a new ParallelTrainer object.
+     * The dataset is referenced and not copied, so it has to outlive the
+     * trainer.
+     * Layers frozen with Layer::set_trainable() are not trained; changes of
+     * the trainable flags after the construction are ignored.
+     * \param model       Model to train, fed with each input sample.
+     * \param loss_layer  Loss layer fed with each target sample.
+     * \param optimizer   Optimizer invoked at the end of each mini-batch.
+     * \param inputs      Input samples.
+     * \param targets     Target samples, one for each input sample.
+     * \param batch_size  Amount of samples in a mini-batch.
+     * \param threads     Amount of workers, the calling thread included.
+     * \param mode        Synchronization policy of the workers.
+     */
+    BasicParallelTrainer(BasicModel<T>& model, BasicLossLayer<T>& loss_layer,
+        BasicOptimizer<T>& optimizer,
+        std::vector<std::vector<T>> const& inputs,
+        std::vector<std::vector<T>> const& targets,
+        size_t batch_size, size_t threads,
+        ParallelMode mode = ParallelMode::Synchronous);
+
+    ~BasicParallelTrainer();
+
+    BasicParallelTrainer(BasicParallelTrainer const&) = delete;
+    BasicParallelTrainer& operator=(BasicParallelTrainer const&) = delete;
+
+    /**
+     * \brief Run a whole mini-batch and apply the optimizer. In Hogwild mode
+     * every worker runs a mini-batch.
+     */
+    void step();
+
+    /**
+     * \brief Run the mini-batches left in the current epoch. In Hogwild mode 
+     * the workers only synchronize at the end of the epoch.
+     */
+    void run_epoch();
+
+    /**
+     * \brief Average loss of the samples evaluated in the current epoch, or
+     * in the last completed one if a new epoch did not start yet.
+     * \return T
+     */
+    T avg_loss() const;
+
+    [[nodiscard]] size_t epoch() const noexcept { return _epoch; }
+    [[nodiscard]] size_t batches() const noexcept { return _batches; }
+    [[nodiscard]] size_t cursor() const noexcept { return _cursor; }
+    [[nodiscard]] size_t threads() const noexcept { return _workers.size(); }
+    [[nodiscard]] ParallelMode mode() const noexcept { return _mode; }
+
+private:
+    /**
+     * \brief Per-thread state.
+     */
+    struct Worker
+    {
+        std::unique_ptr<BasicModel<T>> replica; ///< Private model replica.
+        BasicLossLayer<T>* loss_layer;          ///< Replica loss layer.
+        std::vector<BasicLayer<T>*> trainables; ///< Replica trained layers.
+        std::vector<T*> shared;         ///< Hogwild shared parameters.
+        size_t samples{0};              ///< Samples evaluated in the epoch.
+        size_t batches{0};              ///< Pending Hogwild updates count.
+        std::exception_ptr error;       ///< Failure raised by the worker.
+    };
+
+    /**
+     * \brief Run the samples in [_cursor, end) and move the cursor.
+     * \param end End of the samples to run.
+     */
+    void _run(size_t end);
+
+    /**
+     * \brief Body of the helper threads.
+     * \param index Worker index.
+     */
+    void _loop(size_t index);
+
+    /**
+     * \brief Work of a worker in a mini-batch: evaluate its slice and take
+     * part in the gradients reduction.
+     * \param index Worker index.
+     */
+    void _work(size_t index);
+
+    /**
+     * \brief Forward and reverse propagate the slice of the current samples 
+     * of a worker. In Hogwild mode apply the optimizer every _batch_size 
+     * samples.
+     * \param index Worker index.
+     */
+    void _evaluate(size_t index);
+
+    /**
+     * \brief Apply the optimizer to the gradients of a worker.
+     */
+    void _apply(Worker& w);
+
+    /**
+     * \brief Copy the shared parameters in the trained layers of a Hogwild
+     * worker replica.
+     */
+    void _refresh(Worker& w);
+
+    /**
+     * \brief Accumulate the gradients of worker src into worker dst.
+     */
+    void _reduce(size_t dst, size_t src);
+
+    BasicModel<T>& _model;
+    BasicOptimizer<T>& _optimizer;
+    std::vector<std::vector<T>> const& _inputs;
+    std::vector<std::vector<T>> const& _targets;
+    size_t _batch_size;
+    ParallelMode _mode;
+
+    std::vector<Worker> _workers;
+    std::vector<std::thread> _threads;
+    std::barrier<> _sync;
+    bool _stop{false};
+
+    size_t _epoch{0};     ///< Completed epochs.
+    size_t _batches{0};   ///< Completed optimizer steps.
+    size_t _cursor{0};    ///< Begin of the current samples.
+    size_t _batch_end{0}; ///< End of the current samples.
+};
+
+using ParallelTrainer = BasicParallelTrainer<NumType>;
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_PARALLEL_TRAINER_HPP
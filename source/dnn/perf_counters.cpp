@@ -0,0 +1,164 @@
+/***************************************************************************
+ *            perf_counters.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "perf_counters.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Ariadne {
+
+#if defined(__linux__)
+
+namespace {
+
+/**
+ * \brief Open a user-space counter of the calling thread.
+ * \param type   Event type.
+ * \param config Event configuration.
+ * \param group  Group leader, -1 to open a leader.
+ * \return int File descriptor, negative on failure.
+ */
+int open_counter(uint32_t type, uint64_t config, int group)
+{
+    perf_event_attr attr{};
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.disabled       = group < 0 ? 1U : 0U;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+                        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, 
+        group, 0));
+}
+
+constexpr uint64_t cache_event(uint64_t cache, uint64_t op, uint64_t result)
+{
+    return cache | (op << 8) | (result << 16);
+}
+
+} // namespace
+
+PerfCounters::PerfCounters()
+{
+    _fds.fill(-1);
+    _slots.fill(_missing);
+
+    struct Event { uint32_t type; uint64_t config; };
+    Event const events[count] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, 
+            PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+
+    // The first counter that opens leads the group.
+    for (size_t i = 0; i < count; ++i)
+    {
+        int fd = open_counter(events[i].type, events[i].config, _leader);
+        if (fd < 0)
+        {
+            continue;
+        }
+        if (_leader < 0)
+        {
+            _leader = fd;
+        }
+        _fds[i]   = fd;
+        _slots[i] = _opened++;
+    }
+
+    if (_leader >= 0)
+    {
+        ::ioctl(_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int fd: _fds)
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+}
+
+void PerfCounters::read(Values& values) const noexcept
+{
+    values.fill(0);
+    if (_leader < 0)
+    {
+        return;
+    }
+
+    // Amount of counters, time enabled, time running and the values.
+    uint64_t data[3 + count];
+    auto size = ::read(_leader, data, sizeof(data));
+    if (size < static_cast<ssize_t>(3 * sizeof(uint64_t)) || data[2] == 0)
+    {
+        return;
+    }
+
+    double const scale = static_cast<double>(data[1]) 
+                       / static_cast<double>(data[2]);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (_slots[i] != _missing && _slots[i] < data[0])
+        {
+            values[i] = static_cast<uint64_t>(
+                static_cast<double>(data[3 + _slots[i]]) * scale);
+        }
+    }
+}
+
+#else
+
+PerfCounters::PerfCounters()
+{
+    _fds.fill(-1);
+    _slots.fill(_missing);
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::read(Values& values) const noexcept
+{
+    values.fill(0);
+}
+
+#endif
+
+} // namespace Ariadne
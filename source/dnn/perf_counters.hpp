@@ -0,0 +1,112 @@
+/***************************************************************************
+ *            perf_counters.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file perf_counters.hpp
+ *  \brief Hardware performance counters of the calling thread.
+ */
+
+#ifndef ARIADNE_DNN_PERF_COUNTERS_HPP
+#define ARIADNE_DNN_PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Hardware events counted by PerfCounters.
+ */
+enum class Counter : size_t
+{
+    Cycles,
+    Instructions,
+    L1DMisses,    ///< Level 1 data cache read misses.
+    LLCMisses,    ///< Last level cache misses.
+    BranchMisses
+};
+
+/**
+ * \brief Counters of the hardware events of the calling thread in user 
+ * space, opened with the Linux perf_event_open system call as one group, 
+ * so that they are read together with a single system call.
+ *
+ * Counters that the kernel, the CPU or the permissions do not provide 
+ * (e.g. in virtual machines or with perf_event_paranoid > 2) are left out
+ * and read as 0; when none is available, or on other systems, available() 
+ * is false and read() does nothing. Threads of the ThreadPool are not 
+ * counted.
+ */
+class PerfCounters
+{
+public:
+    static constexpr size_t count = 5;
+    using Values = std::array<uint64_t, count>;
+
+    /**
+     * \brief Open the counters for the calling thread. It never throws.
+     */
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(PerfCounters const&) = delete;
+    PerfCounters& operator=(PerfCounters const&) = delete;
+
+    /**
+     * \brief Whether any counter is available.
+     * \return bool
+     */
+    [[nodiscard]] bool available() const noexcept { return _leader >= 0; }
+
+    /**
+     * \brief Whether a counter is available.
+     * \param counter
+     * \return bool
+     */
+    [[nodiscard]] bool available(Counter counter) const noexcept
+    {
+        return _slots[static_cast<size_t>(counter)] != _missing;
+    }
+
+    /**
+     * \brief Read the current totals, scaled by the time share when the 
+     * kernel multiplexes the counters. Missing counters read as 0.
+     * \param values Totals, indexed by Counter.
+     */
+    void read(Values& values) const noexcept;
+
+private:
+    static constexpr size_t _missing = static_cast<size_t>(-1);
+
+    int _leader{-1};              ///< File descriptor of the group.
+    std::array<int, count> _fds;  ///< -1 for missing counters.
+    std::array<size_t, count> _slots; ///< Position in the group read.
+    size_t _opened{0};
+};
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_PERF_COUNTERS_HPP
@@ -0,0 +1,137 @@
+/***************************************************************************
+ *            profiler.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+namespace Ariadne {
+
+char const* phase_name(Phase phase) noexcept
+{
+    if (phase == Phase::Forward)
+    {
+        return "forward";
+    }
+    return phase == Phase::Reverse ? "reverse" : "optimizer";
+}
+
+bool Profiler::enable_counters()
+{
+    auto counters = std::make_unique<PerfCounters>();
+    if (counters->available())
+    {
+        _counters = std::move(counters);
+    }
+    return _counters != nullptr;
+}
+
+void Profiler::print(std::ostream& out, std::string const& title) const
+{
+    using Ms = std::chrono::duration<double, std::milli>;
+
+    std::vector<Entry const*> sorted;
+    Clock::duration total{0};
+    for (auto& e: _entries)
+    {
+        sorted.push_back(&e);
+        total += e.time;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), 
+        [](Entry const* a, Entry const* b) { return a->time > b->time; });
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%s: %.3f ms\n", title.c_str(), 
+        Ms{total}.count());
+    out << line;
+    std::snprintf(line, sizeof(line), 
+        "%-16s %-20s %-9s %10s %11s %10s %6s %9s %9s", "layer", "type", 
+        "phase", "calls", "total_ms", "us/call", "%", "GFLOP/s", "GB/s");
+    out << line;
+    if (_counters)
+    {
+        std::snprintf(line, sizeof(line), " %6s %9s %9s %9s", "IPC", 
+            "L1D/kins", "LLC/kins", "br/kins");
+        out << line;
+    }
+    out << '\n';
+
+    // Ratio of two counters, "-" if any of them is missing.
+    auto ratio = [this](char* dst, Entry const& e, Counter num, Counter den,
+        double scale)
+    {
+        auto n = e.events[static_cast<size_t>(num)];
+        auto d = e.events[static_cast<size_t>(den)];
+        if (!_counters->available(num) || !_counters->available(den) 
+            || d == 0)
+        {
+            std::snprintf(dst, 16, "-");
+            return;
+        }
+        std::snprintf(dst, 16, "%.3f", 
+            scale * static_cast<double>(n) / static_cast<double>(d));
+    };
+
+    for (auto* e: sorted)
+    {
+        double ns = std::chrono::duration<double, std::nano>{e->time}.count();
+        double calls = static_cast<double>(e->calls);
+        double share = total.count() > 0 
+            ? 100.0 * static_cast<double>(e->time.count()) 
+                / static_cast<double>(total.count()) 
+            : 0.0;
+        double gflops = ns > 0.0 ? e->cost.flops * calls / ns : 0.0;
+        double gbps   = ns > 0.0 ? e->cost.bytes * calls / ns : 0.0;
+        std::snprintf(line, sizeof(line), 
+            "%-16s %-20s %-9s %10llu %11.3f %10.3f %6.1f %9.3f %9.3f", 
+            e->layer.c_str(), e->type.c_str(), phase_name(e->phase), 
+            static_cast<unsigned long long>(e->calls), Ms{e->time}.count(), 
+            ns / calls / 1e3, share, gflops, gbps);
+        out << line;
+        if (_counters)
+        {
+            char ipc[16], l1d[16], llc[16], branch[16];
+            ratio(ipc, *e, Counter::Instructions, Counter::Cycles, 1.0);
+            ratio(l1d, *e, Counter::L1DMisses, Counter::Instructions, 1e3);
+            ratio(llc, *e, Counter::LLCMisses, Counter::Instructions, 1e3);
+            ratio(branch, *e, Counter::BranchMisses, Counter::Instructions, 
+                1e3);
+            std::snprintf(line, sizeof(line), " %6s %9s %9s %9s", ipc, l1d, 
+                llc, branch);
+            out << line;
+        }
+        out << '\n';
+    }
+}
+
+void Profiler::reset()
+{
+    _index.clear();
+    _entries.clear();
+}
+
+} // namespace Ariadne
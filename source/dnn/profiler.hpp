@@ -0,0 +1,251 @@
+/***************************************************************************
+ *            profiler.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file profiler.hpp
+ *  \brief Opt-in per-layer profiler of the models.
+ *
+ *  The hooks are compiled only when the project is configured with 
+ *  -DENABLE_PROFILING=true; otherwise ARIADNE_PROFILE_SCOPE expands to 
+ *  nothing and the models run exactly the same code as without profiler.
+ *  The same hooks feed the Tracer.
+ */
+
+#ifndef ARIADNE_DNN_PROFILER_HPP
+#define ARIADNE_DNN_PROFILER_HPP
+
+#include "perf_counters.hpp"
+#include "tracer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Phase of the training of a layer.
+ */
+enum class Phase
+{
+    Forward,  ///< forward() and predict().
+    Reverse,  ///< reverse().
+    Optimizer ///< Optimizer update of the parameters.
+};
+
+/**
+ * \brief Estimated work of a call of a layer phase.
+ */
+struct LayerCost
+{
+    double flops{0.0}; ///< Floating point (or integer) operations.
+    double bytes{0.0}; ///< Compulsory memory traffic.
+};
+
+/**
+ * \brief Name of a phase.
+ * \param phase
+ * \return char const*
+ */
+char const* phase_name(Phase phase) noexcept;
+
+/**
+ * \brief Accumulator of the wall time spent by each layer in each phase 
+ * and, on request, of the hardware events counted meanwhile.
+ *
+ * A profiler is not thread safe: each model has its own, so the replicas 
+ * of a ParallelTrainer are profiled separately from the trained model.
+ */
+class Profiler
+{
+public:
+    using Clock = Tracer::Clock;
+
+    /**
+     * \brief Measures of a layer phase.
+     */
+    struct Entry
+    {
+        std::string layer;          ///< Layer name.
+        std::string type;           ///< Layer type.
+        Phase phase;
+        uint64_t calls{0};
+        Clock::duration time{0};    ///< Total wall time.
+        LayerCost cost;             ///< Estimated work of one call.
+        PerfCounters::Values events{}; ///< Total events, indexed by Counter.
+    };
+
+    /**
+     * \brief Account a call of a layer phase. The name, the type and the 
+     * cost of the layer are read at its first call only.
+     * \tparam Layer_t Layer class, with name(), type() and cost().
+     * \param layer   Layer.
+     * \param phase   Phase.
+     * \param elapsed Wall time of the call.
+     * \param events  Hardware events of the call, if counted.
+     */
+    template <class Layer_t>
+    void record(Layer_t const& layer, Phase phase, Clock::duration elapsed,
+        PerfCounters::Values const* events = nullptr)
+    {
+        auto [it, inserted] = _index.try_emplace({&layer, phase}, 
+            _entries.size());
+        if (inserted)
+        {
+            _entries.push_back({layer.name(), layer.type(), phase, 0, 
+                Clock::duration{0}, layer.cost(phase), {}});
+        }
+        Entry& e = _entries[it->second];
+        ++e.calls;
+        e.time += elapsed;
+        if (events)
+        {
+            for (size_t i = 0; i < PerfCounters::count; ++i)
+            {
+                e.events[i] += (*events)[i];
+            }
+        }
+    }
+
+    /**
+     * \brief Count the hardware events of the calling thread, that has to 
+     * be the one that runs the model, in the following calls. Without 
+     * hardware counters the profiler keeps measuring the time only.
+     * \return bool Whether any counter is available.
+     */
+    bool enable_counters();
+
+    /**
+     * \brief Counters of the hardware events, nullptr unless enabled and 
+     * available.
+     * \return PerfCounters const*
+     */
+    [[nodiscard]] PerfCounters const* counters() const noexcept
+    {
+        return _counters.get();
+    }
+
+    /**
+     * \brief Measures in order of first call.
+     * \return std::vector<Entry> const&
+     */
+    [[nodiscard]] std::vector<Entry> const& entries() const noexcept 
+    { 
+        return _entries; 
+    }
+
+    /**
+     * \brief Print the measures sorted by decreasing total time, with the 
+     * share of the total and the throughput given by the estimated costs. 
+     * With the hardware counters, it adds the instructions per cycle and 
+     * the misses per thousand instructions; "-" marks missing counters.
+     * \param out   Output stream.
+     * \param title Title of the report.
+     */
+    void print(std::ostream& out, std::string const& title) const;
+
+    /**
+     * \brief Drop all the measures.
+     */
+    void reset();
+
+private:
+    std::map<std::pair<void const*, Phase>, size_t> _index;
+    std::vector<Entry> _entries;
+    std::unique_ptr<PerfCounters> _counters;
+};
+
+/**
+ * \brief Measure the wall time of its scope and account it to a layer. 
+ * While the Tracer records, the scope is also recorded as a span. The 
+ * counters are read outside of the timed interval, so that their system 
+ * calls do not inflate the times.
+ * \tparam Layer_t Layer class.
+ */
+template <class Layer_t>
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler& profiler, Layer_t const& layer, Phase phase)
+        : _profiler{profiler}
+        , _layer{layer}
+        , _phase{phase}
+    {
+        if (auto* counters = _profiler.counters())
+        {
+            counters->read(_events);
+        }
+        _start = Profiler::Clock::now();
+    }
+
+    ~ProfileScope()
+    {
+        auto end = Profiler::Clock::now();
+        if (auto* counters = _profiler.counters())
+        {
+            PerfCounters::Values after;
+            counters->read(after);
+            for (size_t i = 0; i < PerfCounters::count; ++i)
+            {
+                _events[i] = after[i] - _events[i];
+            }
+            _profiler.record(_layer, _phase, end - _start, &_events);
+        }
+        else
+        {
+            _profiler.record(_layer, _phase, end - _start);
+        }
+        Tracer::record(phase_name(_phase), _layer.name(), _start, end);
+    }
+
+    ProfileScope(ProfileScope const&) = delete;
+    ProfileScope& operator=(ProfileScope const&) = delete;
+
+private:
+    Profiler& _profiler;
+    Layer_t const& _layer;
+    Phase _phase;
+    Profiler::Clock::time_point _start;
+    PerfCounters::Values _events; ///< Totals at the start, then deltas.
+};
+
+} // namespace Ariadne
+
+#if ENABLE_PROFILING
+/**
+ * \brief Profile the rest of the enclosing scope as a phase of a layer.
+ */
+#define ARIADNE_PROFILE_SCOPE(profiler, layer, phase) \
+    ::Ariadne::ProfileScope ariadne_profile_scope{profiler, layer, phase}
+#else
+#define ARIADNE_PROFILE_SCOPE(profiler, layer, phase) ((void) 0)
+#endif
+
+#endif // ARIADNE_DNN_PROFILER_HPP
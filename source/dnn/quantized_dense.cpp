@@ -0,0 +1,451 @@
+/***************************************************************************
+ *            quantized_dense.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "quantized_dense.hpp"
+
+#include "dlmath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ARIADNE_HAS_X86 1
+#endif
+
+namespace Ariadne {
+
+namespace {
+
+void matvec_scalar(int32_t* dst, int8_t const* weights, 
+    int8_t const* inputs, size_t rows, size_t stride)
+{
+    for (size_t i = 0; i < rows; ++i)
+    {
+        int8_t const* row = weights + (i * stride);
+        int32_t sum = 0;
+        for (size_t j = 0; j < stride; ++j)
+        {
+            sum += static_cast<int32_t>(row[j]) * inputs[j];
+        }
+        dst[i] = sum;
+    }
+}
+
+#if defined(ARIADNE_HAS_X86)
+/**
+ * \brief Sum of the 8 lanes of a vector.
+ */
+__attribute__((target("avx2")))
+inline int32_t reduce_add(__m256i v)
+{
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), 
+        _mm256_extracti128_si256(v, 1));
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2")))
+void matvec_avx2(int32_t* dst, int8_t const* weights, 
+    int8_t const* inputs, size_t rows, size_t stride)
+{
+    __m256i const ones = _mm256_set1_epi16(1);
+    for (size_t i = 0; i < rows; ++i)
+    {
+        int8_t const* row = weights + (i * stride);
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t j = 0; j < stride; j += 32)
+        {
+            __m256i x = _mm256_loadu_si256(
+                reinterpret_cast<__m256i const*>(inputs + j));
+            __m256i w = _mm256_loadu_si256(
+                reinterpret_cast<__m256i const*>(row + j));
+            // |x| * (w * sign(x)) = x * w, with an unsigned first operand.
+            __m256i pairs = _mm256_maddubs_epi16(_mm256_sign_epi8(x, x), 
+                _mm256_sign_epi8(w, x));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, ones));
+        }
+        dst[i] = reduce_add(acc);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+void matvec_vnni(int32_t* dst, int8_t const* weights, 
+    int8_t const* inputs, size_t rows, size_t stride)
+{
+    __m512i const zero = _mm512_setzero_si512();
+    for (size_t i = 0; i < rows; ++i)
+    {
+        int8_t const* row = weights + (i * stride);
+        __m512i acc = _mm512_setzero_si512();
+        for (size_t j = 0; j < stride; j += 64)
+        {
+            __m512i x = _mm512_loadu_si512(inputs + j);
+            __m512i w = _mm512_loadu_si512(row + j);
+            // Same sign transfer of the AVX2 kernel, without vpsignb.
+            __mmask64 negative = _mm512_movepi8_mask(x);
+            w = _mm512_mask_sub_epi8(w, negative, zero, w);
+            acc = _mm512_dpbusd_epi32(acc, _mm512_abs_epi8(x), w);
+        }
+        // The halves are extracted with a zeroing mask: the unmasked 
+        // extractions, also inside _mm512_reduce_add_epi32, start from an 
+        // undefined vector that GCC flags with -Wmaybe-uninitialized.
+        dst[i] = reduce_add(_mm256_add_epi32(
+            _mm512_maskz_extracti64x4_epi64(0xFF, acc, 0), 
+            _mm512_maskz_extracti64x4_epi64(0xFF, acc, 1)));
+    }
+}
+#endif
+
+} // namespace
+
+Int8Kernel Int8Math::best_kernel() noexcept
+{
+    if (supported(Int8Kernel::AVX512VNNI))
+    {
+        return Int8Kernel::AVX512VNNI;
+    }
+    if (supported(Int8Kernel::AVX2))
+    {
+        return Int8Kernel::AVX2;
+    }
+    return Int8Kernel::Scalar;
+}
+
+bool Int8Math::supported(Int8Kernel kernel) noexcept
+{
+#if defined(ARIADNE_HAS_X86)
+    static bool const avx2 = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    static bool const vnni = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512bw") != 0 
+            && __builtin_cpu_supports("avx512vnni") != 0;
+    }();
+    switch (kernel)
+    {
+        case Int8Kernel::AVX2:
+        {
+            return avx2;
+        }
+        case Int8Kernel::AVX512VNNI:
+        {
+            return vnni;
+        }
+        case Int8Kernel::Scalar:
+        default:
+        {
+            return true;
+        }
+    }
+#else
+    return kernel == Int8Kernel::Scalar;
+#endif
+}
+
+char const* Int8Math::name(Int8Kernel kernel) noexcept
+{
+    switch (kernel)
+    {
+        case Int8Kernel::AVX2:
+        {
+            return "avx2";
+        }
+        case Int8Kernel::AVX512VNNI:
+        {
+            return "avx512vnni";
+        }
+        case Int8Kernel::Scalar:
+        default:
+        {
+            return "scalar";
+        }
+    }
+}
+
+void Int8Math::matvec(int32_t* dst, int8_t const* weights, 
+    int8_t const* inputs, size_t rows, size_t stride, Int8Kernel kernel)
+{
+#if defined(ARIADNE_HAS_X86)
+    if (kernel == Int8Kernel::AVX512VNNI)
+    {
+        matvec_vnni(dst, weights, inputs, rows, stride);
+        return;
+    }
+    if (kernel == Int8Kernel::AVX2)
+    {
+        matvec_avx2(dst, weights, inputs, rows, stride);
+        return;
+    }
+#else
+    (void) kernel;
+#endif
+    matvec_scalar(dst, weights, inputs, rows, stride);
+}
+
+template <typename T>
+BasicQuantizedDenseLayer<T>::BasicQuantizedDenseLayer(BasicModel<T>& model, 
+    BasicDenseLayer<T> const& dense)
+    : BasicLayer<T>(model, dense.name())
+    , _activation{dense.activation()}
+    , _output_size{static_cast<uint16_t>(dense.output_size())}
+    , _input_size{static_cast<uint16_t>(dense.input_size())}
+    , _stride{(_input_size + Int8Math::row_alignment - 1) 
+        / Int8Math::row_alignment * Int8Math::row_alignment}
+    , _kernel{Int8Math::best_kernel()}
+    , _weights(_output_size * _stride, 0)
+    , _weight_scales(_output_size)
+    , _biases(dense.biases(), dense.biases() + _output_size)
+    , _weights_fp(dense.weights(), 
+        dense.weights() + (size_t{_output_size} * _input_size))
+    , _output_scales(_output_size)
+{
+    // Symmetric scales: the largest weight of each row maps to 127.
+    for (size_t i = 0; i < _output_size; ++i)
+    {
+        T const* row = _weights_fp.data() + (i * _input_size);
+        T range{0};
+        for (size_t j = 0; j < _input_size; ++j)
+        {
+            range = std::max(range, std::abs(row[j]));
+        }
+        T scale = range > T{0} ? range / T{127} : T{1};
+        _weight_scales[i] = scale;
+        for (size_t j = 0; j < _input_size; ++j)
+        {
+            _weights[(i * _stride) + j] = 
+                static_cast<int8_t>(std::lround(row[j] / scale));
+        }
+    }
+}
+
+template <typename T>
+BasicQuantizedDenseLayer<T>::BasicQuantizedDenseLayer(BasicModel<T>& model, 
+    BasicQuantizedDenseLayer const& other)
+    : BasicLayer<T>(model, other._name)
+    , _activation{other._activation}
+    , _output_size{other._output_size}
+    , _input_size{other._input_size}
+    , _stride{other._stride}
+    , _kernel{other._kernel}
+    , _weights(other._weights)
+    , _weight_scales(other._weight_scales)
+    , _biases(other._biases)
+    , _weights_fp(other._weights_fp)
+    , _input_range{other._input_range}
+    , _input_scale{other._input_scale}
+    , _output_scales(other._output_scales)
+{ }
+
+template <typename T>
+std::unique_ptr<BasicModel<T>> BasicQuantizedDenseLayer<T>::quantize(
+    BasicModel<T> const& model, std::vector<std::vector<T>> const& calibration)
+{
+    if (calibration.empty())
+    {
+        throw std::runtime_error("quantization needs calibration inputs");
+    }
+
+    auto quantized = model.transform(ModelMode::Inference, 
+        [](BasicLayer<T> const& layer, BasicModel<T>& owner) 
+            -> std::unique_ptr<BasicLayer<T>>
+    {
+        if (auto* dense = dynamic_cast<BasicDenseLayer<T> const*>(&layer))
+        {
+            return std::make_unique<BasicQuantizedDenseLayer>(owner, *dense);
+        }
+        return layer.clone(owner);
+    });
+
+    for (auto& inputs: calibration)
+    {
+        quantized->predict(const_cast<T*>(inputs.data()));
+    }
+    for (size_t i = 0; i < quantized->node_count(); ++i)
+    {
+        auto* layer = dynamic_cast<BasicQuantizedDenseLayer*>(
+            &quantized->node(i));
+        if (layer != nullptr)
+        {
+            layer->end_calibration();
+        }
+    }
+    return quantized;
+}
+
+template <typename T>
+void BasicQuantizedDenseLayer<T>::forward(BasicTensorView<T const> inputs)
+{
+    this->_check_size(inputs, _input_size, "inputs");
+    if (calibrating())
+    {
+        for (size_t j = 0; j < _input_size; ++j)
+        {
+            _input_range = std::max(_input_range, std::abs(inputs[j]));
+        }
+        DLMath::matarr_mul<T>({_activations, _output_size}, 
+            {_weights_fp.data(), _output_size, _input_size, _input_size}, 
+            inputs);
+        DLMath::arr_sum<T>(_activations, _activations, _biases.data(), 
+            _output_size);
+        _activate();
+        return;
+    }
+
+    ScratchScope scratch;
+    int8_t* quantized = scratch.allocate<int8_t>(_stride);
+    int32_t* sums = scratch.allocate<int32_t>(_output_size);
+
+    // Inputs beyond the calibrated range saturate.
+    T const inv_scale = T{1} / _input_scale;
+    for (size_t j = 0; j < _input_size; ++j)
+    {
+        T q = std::clamp(inputs[j] * inv_scale, T{-127}, T{127});
+        quantized[j] = static_cast<int8_t>(std::lround(q));
+    }
+    std::fill(quantized + _input_size, quantized + _stride, int8_t{0});
+
+    Int8Math::matvec(sums, _weights.data(), quantized, _output_size, _stride, 
+        _kernel);
+    for (size_t i = 0; i < _output_size; ++i)
+    {
+        _activations[i] = (static_cast<T>(sums[i]) * _output_scales[i]) 
+            + _biases[i];
+    }
+    _activate();
+}
+
+template <typename T>
+void BasicQuantizedDenseLayer<T>::reverse(
+    BasicTensorView<T const> gradients)
+{
+    (void) gradients;
+    throw std::runtime_error("quantized layer " + _name + " supports only "
+                             "inference");
+}
+
+template <typename T>
+void BasicQuantizedDenseLayer<T>::bind_buffers(
+    BasicLayerBuffers<T> const& buffers)
+{
+    _activations = buffers.output;
+}
+
+template <typename T>
+void BasicQuantizedDenseLayer<T>::end_calibration()
+{
+    if (!calibrating())
+    {
+        return;
+    }
+    _input_scale = _input_range > T{0} ? _input_range / T{127} : T{1};
+    for (size_t i = 0; i < _output_size; ++i)
+    {
+        _output_scales[i] = _weight_scales[i] * _input_scale;
+    }
+    AlignedVector<T>{}.swap(_weights_fp);
+}
+
+template <typename T>
+void BasicQuantizedDenseLayer<T>::set_kernel(Int8Kernel kernel)
+{
+    if (!Int8Math::supported(kernel))
+    {
+        throw std::runtime_error(std::string{"int8 kernel "} 
+            + Int8Math::name(kernel) + " is not supported by this CPU");
+    }
+    _kernel = kernel;
+}
+
+template <typename T>
+std::unique_ptr<BasicLayer<T>> BasicQuantizedDenseLayer<T>::clone(
+    BasicModel<T>& model) const
+{
+    return std::unique_ptr<BasicLayer<T>>(
+        new BasicQuantizedDenseLayer(model, *this));
+}
+
+template <typename T>
+LayerCost BasicQuantizedDenseLayer<T>::cost(Phase phase) const noexcept
+{
+    if (phase != Phase::Forward)
+    {
+        return BasicLayer<T>::cost(phase);
+    }
+
+    // Int8 products on the padded rows, quantization and rescaling.
+    double const value   = sizeof(T);
+    double const inputs  = _input_size;
+    double const outputs = _output_size;
+    double const weights = outputs * static_cast<double>(_stride);
+    return {2.0 * weights + 2.0 * inputs + 3.0 * outputs, 
+        weights + value * (inputs + 3.0 * outputs)};
+}
+
+template <typename T>
+std::string BasicQuantizedDenseLayer<T>::type() const
+{
+    return "int8." + BasicDenseLayer<T>::type_name(_activation);
+}
+
+template <typename T>
+void BasicQuantizedDenseLayer<T>::_activate()
+{
+    if (_activation == Activation::ReLU)
+    {
+        DLMath::relu<T>(_activations, _activations, size_t(_output_size));
+    }
+    else if (_activation == Activation::Softmax)
+    {
+        DLMath::softmax<T>(_activations, _activations, size_t(_output_size));
+    }
+}
+
+template <typename T>
+void BasicQuantizedDenseLayer<T>::print() const
+{
+    std::printf("%s\n", _name.c_str());
+    std::printf("Int8 weights (%d x %d), kernel %s, input scale %g\n", 
+        _output_size, _input_size, Int8Math::name(_kernel), 
+        static_cast<double>(_input_scale));
+    for (size_t i = 0; i < _output_size; ++i)
+    {
+        std::printf("\t[%zu] scale %g bias %g\n", i, 
+            static_cast<double>(_weight_scales[i]), 
+            static_cast<double>(_biases[i]));
+    }
+}
+
+template class BasicQuantizedDenseLayer<float>;
+template class BasicQuantizedDenseLayer<double>;
+
+} // namespace Ariadne
@@ -0,0 +1,228 @@
+/***************************************************************************
+ *            quantized_dense.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file quantized_dense.hpp
+ *  \brief Dense layer with int8 weights for post-training quantization.
+ */
+
+#ifndef ARIADNE_DNN_QUANTIZED_DENSE_HPP
+#define ARIADNE_DNN_QUANTIZED_DENSE_HPP
+
+#include "aligned_allocator.hpp"
+#include "dense.hpp"
+#include "layer.hpp"
+#include "model.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Implementations of the int8 dot products.
+ */
+enum class Int8Kernel
+{
+    Scalar,     ///< Portable loop.
+    AVX2,       ///< vpmaddubsw to int16 pairs, vpmaddwd to int32.
+    AVX512VNNI  ///< vpdpbusd, 64 products per instruction.
+};
+
+/**
+ * \brief Matrix-vector products of int8 values with int32 accumulation.
+ *
+ * Values are in [-127, 127]: the AVX2 kernel multiplies |x| by the weight 
+ * with the sign of x, and two such products never saturate the int16 sums 
+ * of vpmaddubsw. All the kernels compute the exact integer result.
+ */
+class Int8Math
+{
+public:
+    /// \brief Rows are padded with zeros to a multiple of this length.
+    static constexpr size_t row_alignment = 64;
+
+    /**
+     * \brief Fastest kernel supported by the CPU.
+     * \return Int8Kernel
+     */
+    static Int8Kernel best_kernel() noexcept;
+
+    /**
+     * \brief Whether the CPU supports a kernel.
+     * \param kernel
+     * \return bool
+     */
+    static bool supported(Int8Kernel kernel) noexcept;
+
+    /**
+     * \brief Name of a kernel, for reports.
+     * \param kernel
+     * \return char const*
+     */
+    static char const* name(Int8Kernel kernel) noexcept;
+
+    /**
+     * \brief Compute dst = W * x.
+     * \param dst     Array of rows values.
+     * \param weights Matrix rows x stride, row-major.
+     * \param inputs  Array of stride values.
+     * \param rows    Amount of rows.
+     * \param stride  Length of the rows, multiple of row_alignment.
+     * \param kernel  Kernel, it has to be supported.
+     */
+    static void matvec(int32_t* dst, int8_t const* weights, 
+        int8_t const* inputs, size_t rows, size_t stride, Int8Kernel kernel);
+};
+
+/**
+ * \brief Inference-only dense layer with per output channel int8 weights.
+ *
+ * It is built from a trained dense layer and starts in calibration: 
+ * forward() evaluates the original floating point weights and records the 
+ * range of the inputs. end_calibration() fixes the input scale and drops 
+ * the floating point weights; afterwards forward() quantizes the inputs, 
+ * accumulates W * x in int32 and rescales the sums before the bias and the
+ * activation.
+ *
+ * \tparam T Scalar type of the model.
+ */
+template <typename T>
+class BasicQuantizedDenseLayer : public BasicLayer<T>
+{
+public:
+    /**
+     * \brief Construct a new BasicQuantizedDenseLayer object.
+     * \param model Model that owns the layer.
+     * \param dense Layer to quantize, with the same name and sizes.
+     */
+    BasicQuantizedDenseLayer(BasicModel<T>& model, 
+        BasicDenseLayer<T> const& dense);
+
+    /**
+     * \brief Post-training quantization: create an inference model with the 
+     * topology of a model in which the dense layers are quantized, and 
+     * calibrate their input scales by predicting a sample of inputs.
+     * \param model       Trained model.
+     * \param calibration Sample of inputs, representative of the data.
+     * \return std::unique_ptr<BasicModel<T>> The quantized model.
+     */
+    static std::unique_ptr<BasicModel<T>> quantize(BasicModel<T> const& model, 
+        std::vector<std::vector<T>> const& calibration);
+
+    /**
+     * \brief The parameters are fixed: nothing to initialize.
+     * \param rne
+     */
+    void init(RneType& rne) override { (void) rne; }
+
+    void forward(BasicTensorView<T const> inputs) override;
+
+    /**
+     * \brief Unsupported: throw std::runtime_error.
+     * \param gradients
+     */
+    void reverse(BasicTensorView<T const> gradients) override;
+
+    T* output() override { return _activations; }
+    T* input_gradient() override { return nullptr; }
+    size_t input_size() const noexcept override { return _input_size; }
+    size_t output_size() const noexcept override { return _output_size; }
+
+    void bind_buffers(BasicLayerBuffers<T> const& buffers) override;
+
+    /**
+     * \brief Fix the input scale from the range recorded since the 
+     * construction and quantize the following forward propagations.
+     */
+    void end_calibration();
+
+    /**
+     * \brief Whether forward() still evaluates floating point weights.
+     * \return bool
+     */
+    [[nodiscard]] bool calibrating() const noexcept 
+    { 
+        return !_weights_fp.empty(); 
+    }
+
+    /**
+     * \brief Scale of the quantized inputs: x ~ q * input_scale().
+     * \return T
+     */
+    [[nodiscard]] T input_scale() const noexcept { return _input_scale; }
+
+    /**
+     * \brief Kernel of the int8 products, the best supported by default.
+     * \param kernel
+     */
+    void set_kernel(Int8Kernel kernel);
+
+    std::unique_ptr<BasicLayer<T>> clone(BasicModel<T>& model) const override;
+
+    LayerCost cost(Phase phase) const noexcept override;
+    std::string type() const override;
+    void print() const override;
+
+private:
+    using BasicLayer<T>::_name;
+
+    /**
+     * \brief Copy a layer in another model.
+     * \param model
+     * \param other
+     */
+    BasicQuantizedDenseLayer(BasicModel<T>& model, 
+        BasicQuantizedDenseLayer const& other);
+
+    /**
+     * \brief Apply the activation to the outputs in place.
+     */
+    void _activate();
+
+    Activation _activation;
+    uint16_t _output_size;
+    uint16_t _input_size;
+    size_t _stride;                   ///< Row length padded for the kernels.
+    Int8Kernel _kernel;
+
+    AlignedVector<int8_t> _weights;   ///< _output_size x _stride row-major.
+    AlignedVector<T> _weight_scales;  ///< Per output channel.
+    AlignedVector<T> _biases;
+    AlignedVector<T> _weights_fp;     ///< Original weights, to calibrate.
+    T _input_range{0};                ///< Max |x| seen while calibrating.
+    T _input_scale{0};
+
+    AlignedVector<T> _output_scales;  ///< Weight scale * input scale.
+    T* _activations{nullptr};         ///< Bound by the Model.
+};
+
+using QuantizedDenseLayer = BasicQuantizedDenseLayer<NumType>;
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_QUANTIZED_DENSE_HPP
@@ -0,0 +1,132 @@
+/***************************************************************************
+ *            scratch_arena.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "scratch_arena.hpp"
+
+#include "aligned_allocator.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace Ariadne {
+
+static_assert(ScratchArena::alignment <= AlignedStorage::alignment);
+
+namespace {
+
+std::byte* allocate_block(size_t size)
+{
+    return static_cast<std::byte*>(AlignedStorage::allocate(size));
+}
+
+void free_block(std::byte* data, size_t size) noexcept
+{
+    AlignedStorage::deallocate(data, size);
+}
+
+} // namespace
+
+ScratchArena::~ScratchArena()
+{
+    for (auto& b: _blocks)
+    {
+        free_block(b.data, b.size);
+    }
+}
+
+ScratchArena& ScratchArena::local()
+{
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+size_t ScratchArena::used() const noexcept
+{
+    size_t bytes = _offset;
+    for (size_t i = 0; i < _block && i < _blocks.size(); ++i)
+    {
+        bytes += _blocks[i].size;
+    }
+    return bytes;
+}
+
+size_t ScratchArena::capacity() const noexcept
+{
+    size_t bytes = 0;
+    for (auto& b: _blocks)
+    {
+        bytes += b.size;
+    }
+    return bytes;
+}
+
+void* ScratchArena::_grow(size_t bytes)
+{
+    // Blocks after the current one are free, reuse the first that fits.
+    size_t next = _blocks.empty() ? 0 : _block + 1;
+    for (; next < _blocks.size(); ++next)
+    {
+        if (bytes <= _blocks[next].size)
+        {
+            _block  = next;
+            _offset = bytes;
+            return _blocks[next].data;
+        }
+    }
+
+    size_t size = std::max(bytes, min_block_size);
+    if (!_blocks.empty())
+    {
+        size = std::max(size, 2 * _blocks.back().size);
+    }
+    _blocks.push_back({allocate_block(size), size});
+    _block  = _blocks.size() - 1;
+    _offset = bytes;
+    return _blocks.back().data;
+}
+
+void ScratchArena::_coalesce() noexcept
+{
+    size_t size = capacity();
+    std::byte* data = nullptr;
+    try
+    {
+        data = allocate_block(size);
+    }
+    catch (std::bad_alloc const&)
+    {
+        // Keep the blocks, they still work.
+        return;
+    }
+
+    for (auto& b: _blocks)
+    {
+        free_block(b.data, b.size);
+    }
+    _blocks.resize(1);
+    _blocks.front() = {data, size};
+}
+
+} // namespace Ariadne
@@ -0,0 +1,206 @@
+/***************************************************************************
+ *            scratch_arena.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file scratch_arena.hpp
+ *  \brief Thread-local bump-pointer arena for the temporaries of the kernels.
+ *
+ *  A ScratchScope marks the arena when it is created and releases everything 
+ *  allocated after the mark when it is destroyed, so scopes nest like the 
+ *  calls that open them. The model opens a scope around each forward and 
+ *  reverse step, which resets the arena of the calling thread at the end of 
+ *  every step.
+ */
+
+#ifndef ARIADNE_DNN_SCRATCH_ARENA_HPP
+#define ARIADNE_DNN_SCRATCH_ARENA_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Arena of 64-byte aligned blocks that hands out memory by bumping 
+ * an offset.
+ *
+ * Blocks are kept when the memory is released, so once the arena has grown 
+ * to the largest amount of memory a step needs, allocations cost a pointer 
+ * bump and touch memory that is still in cache. When the arena is released 
+ * to its start after having spilled over more blocks, they are merged in 
+ * one block as large as all of them.
+ */
+class ScratchArena
+{
+public:
+    /// \brief Alignment of every allocation, a cache line.
+    static constexpr size_t alignment = 64;
+    /// \brief Size of the first block.
+    static constexpr size_t min_block_size = 64 * 1024;
+
+    /**
+     * \brief Position of the arena, to release what is allocated after it.
+     */
+    struct Marker
+    {
+        size_t block;
+        size_t offset;
+    };
+
+    ScratchArena() = default;
+    ~ScratchArena();
+
+    ScratchArena(ScratchArena const&) = delete;
+    ScratchArena& operator=(ScratchArena const&) = delete;
+
+    /**
+     * \brief Arena of the calling thread.
+     * \return ScratchArena&
+     */
+    static ScratchArena& local();
+
+    /**
+     * \brief Uninitialized array that lives until the arena is released to 
+     * a marker taken before this call.
+     * \tparam T    Trivially destructible type of the elements.
+     * \param count Amount of elements.
+     * \return T* Array aligned to alignment.
+     */
+    template <typename T>
+    T* allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>
+            && alignof(T) <= alignment);
+        size_t bytes = (count * sizeof(T) + alignment - 1) 
+            & ~(alignment - 1);
+        if (_block < _blocks.size() 
+            && _offset + bytes <= _blocks[_block].size)
+        {
+            std::byte* p = _blocks[_block].data + _offset;
+            _offset += bytes;
+            return reinterpret_cast<T*>(p);
+        }
+        return reinterpret_cast<T*>(_grow(bytes));
+    }
+
+    /**
+     * \brief Current position of the arena.
+     * \return Marker
+     */
+    [[nodiscard]] Marker mark() const noexcept { return {_block, _offset}; }
+
+    /**
+     * \brief Release the memory allocated after marker.
+     * \param marker Position taken with mark().
+     */
+    void release(Marker marker) noexcept
+    {
+        _block  = marker.block;
+        _offset = marker.offset;
+        if (_block == 0 && _offset == 0 && _blocks.size() > 1)
+        {
+            _coalesce();
+        }
+    }
+
+    /**
+     * \brief Release all the memory. No allocation of the arena may be in 
+     * use.
+     */
+    void reset() noexcept { release({0, 0}); }
+
+    /**
+     * \brief Bytes allocated and not released, including the space left at 
+     * the end of the blocks that did not fit an allocation.
+     * \return size_t
+     */
+    [[nodiscard]] size_t used() const noexcept;
+
+    /**
+     * \brief Bytes of the blocks owned by the arena.
+     * \return size_t
+     */
+    [[nodiscard]] size_t capacity() const noexcept;
+
+private:
+    struct Block
+    {
+        std::byte* data;
+        size_t size;
+    };
+
+    /**
+     * \brief Move to the next block that fits bytes, adding one if none 
+     * does, and allocate bytes at its start.
+     * \param bytes Size rounded to alignment.
+     * \return void* The allocation.
+     */
+    void* _grow(size_t bytes);
+
+    /**
+     * \brief Replace the blocks with a single one of their total size.
+     */
+    void _coalesce() noexcept;
+
+    std::vector<Block> _blocks;
+    size_t _block{0};    ///< Block of the next allocation.
+    size_t _offset{0};   ///< Offset of the next allocation in the block.
+};
+
+/**
+ * \brief Scope of the temporaries allocated in the arena of the calling 
+ * thread, released when the scope is destroyed.
+ */
+class ScratchScope
+{
+public:
+    ScratchScope()
+        : _arena{ScratchArena::local()}
+        , _marker{_arena.mark()}
+    { }
+
+    ~ScratchScope() { _arena.release(_marker); }
+
+    ScratchScope(ScratchScope const&) = delete;
+    ScratchScope& operator=(ScratchScope const&) = delete;
+
+    /**
+     * \brief Uninitialized array that lives until the end of the scope.
+     * \tparam T    Trivially destructible type of the elements.
+     * \param count Amount of elements.
+     * \return T* Array aligned to ScratchArena::alignment.
+     */
+    template <typename T>
+    T* allocate(size_t count) { return _arena.allocate<T>(count); }
+
+private:
+    ScratchArena& _arena;
+    ScratchArena::Marker _marker;
+};
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_SCRATCH_ARENA_HPP
@@ -0,0 +1,292 @@
+/***************************************************************************
+ *            static_model.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file static_model.hpp
+ *  \brief Dense layers and sequential models with sizes fixed at compile 
+ *  time.
+ *
+ *  The loops of StaticDense have constant trip counts, the layers of a 
+ *  StaticSequential are called without virtual dispatch and the activation 
+ *  is selected at compile time, fused with the matrix-vector product. The 
+ *  parameters are laid out as the ones of a DenseLayer and initialized from 
+ *  the same random sequence, so a StaticSequential and a Model made of the 
+ *  same dense layers evaluate to the same outputs and read each other model 
+ *  files.
+ */
+
+#ifndef ARIADNE_DNN_STATIC_MODEL_HPP
+#define ARIADNE_DNN_STATIC_MODEL_HPP
+
+#include "dense.hpp"
+#include "dlmath.hpp"
+#include "model_format.hpp"
+#include "type.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Dense layer with compile-time sizes and activation.
+ * \tparam In  Input size.
+ * \tparam Out Output size.
+ * \tparam A   Activation.
+ * \tparam T   Scalar type.
+ */
+template <size_t In, size_t Out, Activation A, typename T = NumType>
+class StaticDense
+{
+public:
+    static_assert(In > 0 && Out > 0, "StaticDense sizes have to be positive");
+
+    static constexpr size_t input_size  = In;
+    static constexpr size_t output_size = Out;
+    /// \brief Weight matrix entries + bias entries.
+    static constexpr size_t param_count = (In + 1) * Out;
+    /// \brief Size of params(), with the padding of DenseLayer.
+    static constexpr size_t block_size = 
+        BasicDenseLayer<T>::param_block_size(Out, In);
+    static constexpr Activation activation = A;
+    using value_type = T;
+
+    /**
+     * \brief Initialize the parameters as DenseLayer::init() does.
+     * \param rne Random number engine.
+     */
+    void init(RneType& rne)
+    {
+        BasicDenseLayer<T>::init_params(A, Out, In, _params.data(), rne);
+    }
+
+    /**
+     * \brief Compute g(W * x + b). The sums are accumulated in the same 
+     * order of DenseLayer::forward(), so the results are identical.
+     * \param inputs Input data of size In.
+     * \return std::array<T, Out> const& The activations.
+     */
+    std::array<T, Out> const& forward(T const* inputs)
+    {
+        T const* weights = _params.data();
+        T const* biases  = weights + BasicDenseLayer<T>::bias_offset(Out, In);
+        for (size_t i = 0; i < Out; ++i)
+        {
+            T z{0};
+            for (size_t j = 0; j < In; ++j)
+            {
+                z += weights[(i * In) + j] * inputs[j];
+            }
+            z += biases[i];
+
+            if constexpr (A == Activation::ReLU)
+            {
+                z = DLMath::relu(z);
+            }
+            _activations[i] = z;
+        }
+
+        if constexpr (A == Activation::Softmax)
+        {
+            // The normalization needs the whole output.
+            DLMath::softmax<T>(_activations.data(), _activations.data(), Out);
+        }
+        return _activations;
+    }
+
+    std::array<T, Out> const& output() const noexcept 
+    { 
+        return _activations; 
+    }
+
+    /**
+     * \brief Parameters: weights, Out x In row-major, followed by biases 
+     * with the padding of DenseLayer::bias_offset().
+     * \return std::array<T, block_size>&
+     */
+    std::array<T, block_size>& params() noexcept { return _params; }
+    std::array<T, block_size> const& params() const noexcept 
+    { 
+        return _params; 
+    }
+
+    /**
+     * \brief Same as DenseLayer::type() for the activation A.
+     * \return std::string
+     */
+    static std::string type() { return BasicDenseLayer<T>::type_name(A); }
+
+private:
+    std::array<T, block_size> _params{};
+    std::array<T, Out> _activations{};
+};
+
+/**
+ * \brief Chain of static layers, the output of each one is the input of the 
+ * next one.
+ * \tparam Layers Layer types, as StaticDense.
+ */
+template <typename... Layers>
+class StaticSequential
+{
+public:
+    static_assert(sizeof...(Layers) > 0, "StaticSequential needs a layer");
+
+    using First = std::tuple_element_t<0, std::tuple<Layers...>>;
+    using Last  = std::tuple_element_t<sizeof...(Layers) - 1, 
+        std::tuple<Layers...>>;
+
+    static constexpr size_t input_size  = First::input_size;
+    static constexpr size_t output_size = Last::output_size;
+    static constexpr size_t layer_count = sizeof...(Layers);
+    using value_type = typename First::value_type;
+
+    /**
+     * \brief Initialize the parameters of the layers in order, from the 
+     * same random sequence of Model::init().
+     * \param seed Seed, a random one if 0.
+     * \return RneType::result_type The seed used.
+     */
+    RneType::result_type init(RneType::result_type seed = 0)
+    {
+        if (seed == 0)
+        {
+            // Generate a new random seed from the host random device.
+            std::random_device rd{};
+            seed = rd();
+        }
+        std::printf("Initializing model parameters with seed: %llu\n", 
+            static_cast<unsigned long long>(seed));
+
+        RneType rne{seed};
+        std::apply([&](auto&... layers) { (layers.init(rne), ...); }, 
+            _layers);
+        return seed;
+    }
+
+    /**
+     * \brief Evaluate the layers in order.
+     * \param inputs Input data of size input_size.
+     * \return std::array<value_type, output_size> const& Output of the last 
+     * layer.
+     */
+    std::array<value_type, output_size> const& forward(value_type const* inputs)
+    {
+        return _forward<0>(inputs);
+    }
+
+    std::array<value_type, output_size> const& forward(
+        std::array<value_type, input_size> const& inputs)
+    {
+        return _forward<0>(inputs.data());
+    }
+
+    template <size_t I>
+    auto& layer() noexcept { return std::get<I>(_layers); }
+
+    template <size_t I>
+    auto const& layer() const noexcept { return std::get<I>(_layers); }
+
+    /**
+     * \brief Write the parameters in the model file format.
+     * \param out Out stream, opened in binary mode.
+     */
+    void save(std::ostream& out) const
+    {
+        std::vector<value_type const*> blocks;
+        std::apply([&](auto const&... layers) 
+        { 
+            (blocks.push_back(layers.params().data()), ...); 
+        }, _layers);
+        ModelFormat::save(out, _records(), blocks);
+    }
+
+    /**
+     * \brief Read the parameters from the model file format. The file may 
+     * come from a Model with the same dense layers and any loss layer.
+     * \param in In stream, opened in binary mode.
+     */
+    void load(std::istream& in)
+    {
+        std::vector<value_type*> blocks;
+        std::apply([&](auto&... layers) 
+        { 
+            (blocks.push_back(layers.params().data()), ...); 
+        }, _layers);
+        ModelFormat::load(in, _records(), blocks);
+    }
+
+private:
+    static constexpr bool _chained()
+    {
+        constexpr size_t inputs[]  = {Layers::input_size...};
+        constexpr size_t outputs[] = {Layers::output_size...};
+        for (size_t i = 1; i < sizeof...(Layers); ++i)
+        {
+            if (inputs[i] != outputs[i - 1])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(_chained(), "the input size of each layer has to be the "
+                              "output size of the previous one");
+
+    template <size_t I>
+    auto const& _forward(value_type const* inputs)
+    {
+        auto const& outputs = std::get<I>(_layers).forward(inputs);
+        if constexpr (I + 1 == sizeof...(Layers))
+        {
+            return outputs;
+        }
+        else
+        {
+            return _forward<I + 1>(outputs.data());
+        }
+    }
+
+    static std::vector<ModelFormat::LayerRecord> _records()
+    {
+        return {ModelFormat::record(Layers::type(), Layers::input_size, 
+            Layers::output_size, Layers::param_count, 
+            Layers::block_size)...};
+    }
+
+    std::tuple<Layers...> _layers;
+};
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_STATIC_MODEL_HPP
@@ -0,0 +1,242 @@
+/***************************************************************************
+ *            tensor_view.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file tensor_view.hpp
+ *  \brief Non-owning view of the buffers passed between the layers.
+ */
+
+#ifndef ARIADNE_DNN_TENSOR_VIEW_HPP
+#define ARIADNE_DNN_TENSOR_VIEW_HPP
+
+#include "aligned_allocator.hpp"
+#include "type.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+
+namespace Ariadne {
+
+/**
+ * \brief DType of a value type.
+ * \tparam T Value type, const or not.
+ * \return DType
+ */
+template <typename T>
+constexpr DType dtype_of() noexcept
+{
+    using V = std::remove_const_t<T>;
+    static_assert(std::is_same_v<V, float> || std::is_same_v<V, double> 
+        || std::is_same_v<V, int8_t> || std::is_same_v<V, int32_t>, 
+        "unsupported tensor value type");
+    if constexpr (std::is_same_v<V, float>)
+    {
+        return DType::Float32;
+    }
+    else if constexpr (std::is_same_v<V, double>)
+    {
+        return DType::Float64;
+    }
+    else if constexpr (std::is_same_v<V, int8_t>)
+    {
+        return DType::Int8;
+    }
+    else
+    {
+        return DType::Int32;
+    }
+}
+
+/**
+ * \brief Non-owning view of a vector or of a row-major matrix.
+ *
+ * Strides are in values and the last dimension may be strided too, so a 
+ * view can select a column or every other value of a buffer. The flags 
+ * tell the kernels whether they can take their contiguous fast path and 
+ * whether the data starts on a cache line. A view of T converts to a view 
+ * of T const.
+ * \tparam T Value type, const for read-only views.
+ */
+template <typename T>
+class BasicTensorView
+{
+public:
+    static constexpr size_t max_rank = 2;
+    static constexpr DType dtype = dtype_of<T>();
+
+    /// \brief Properties of the layout.
+    enum Flags : uint8_t
+    {
+        Contiguous = 1,  ///< Values are adjacent, rows included.
+        Aligned    = 2,  ///< Data starts on AlignedStorage::alignment.
+    };
+
+    /**
+     * \brief Construct an empty view.
+     */
+    BasicTensorView() noexcept = default;
+
+    /**
+     * \brief Construct a view of a vector.
+     * \param data   First value, it may be nullptr if size is 0.
+     * \param size   Amount of values.
+     * \param stride Distance between two values.
+     */
+    BasicTensorView(T* data, size_t size, size_t stride = 1) noexcept
+        : _data{data}
+        , _rank{1}
+        , _shape{size, 1}
+        , _strides{stride, 1}
+    {
+        _update_flags();
+    }
+
+    /**
+     * \brief Construct a view of a row-major matrix.
+     * \param data       First value.
+     * \param rows       Amount of rows.
+     * \param cols       Amount of columns.
+     * \param row_stride Distance between the first values of two rows.
+     */
+    BasicTensorView(T* data, size_t rows, size_t cols, size_t row_stride) 
+        noexcept
+        : _data{data}
+        , _rank{2}
+        , _shape{rows, cols}
+        , _strides{row_stride, 1}
+    {
+        _update_flags();
+    }
+
+    template <typename U, typename = std::enable_if_t<
+        std::is_same_v<T, U const> && !std::is_same_v<T, U>>>
+    BasicTensorView(BasicTensorView<U> const& other) noexcept
+        : _data{other.data()}
+        , _rank{other.rank()}
+        , _shape{other.shape(0), other.shape(1)}
+        , _strides{other.stride(0), other.stride(1)}
+        , _flags{other.flags()}
+    { }
+
+    [[nodiscard]] T* data() const noexcept { return _data; }
+    [[nodiscard]] size_t rank() const noexcept { return _rank; }
+
+    /**
+     * \brief Extent of a dimension, 1 beyond the rank.
+     * \param dim Dimension.
+     * \return size_t
+     */
+    [[nodiscard]] size_t shape(size_t dim) const noexcept 
+    { 
+        return _shape[dim]; 
+    }
+
+    /**
+     * \brief Distance in values between two indices of a dimension.
+     * \param dim Dimension.
+     * \return size_t
+     */
+    [[nodiscard]] size_t stride(size_t dim) const noexcept 
+    { 
+        return _strides[dim]; 
+    }
+
+    /**
+     * \brief Amount of values.
+     * \return size_t
+     */
+    [[nodiscard]] size_t size() const noexcept 
+    { 
+        return _rank == 0 ? 0 : _shape[0] * _shape[1]; 
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+    [[nodiscard]] uint8_t flags() const noexcept { return _flags; }
+
+    [[nodiscard]] bool contiguous() const noexcept 
+    { 
+        return (_flags & Contiguous) != 0; 
+    }
+
+    [[nodiscard]] bool aligned() const noexcept 
+    { 
+        return (_flags & Aligned) != 0; 
+    }
+
+    /**
+     * \brief Value of a vector.
+     * \param i Index.
+     * \return T&
+     */
+    T& operator[](size_t i) const noexcept { return _data[i * _strides[0]]; }
+
+    /**
+     * \brief Value of a matrix.
+     * \param row Row index.
+     * \param col Column index.
+     * \return T&
+     */
+    T& operator()(size_t row, size_t col) const noexcept
+    {
+        return _data[(row * _strides[0]) + (col * _strides[1])];
+    }
+
+    /**
+     * \brief Vector view of a row of a matrix.
+     * \param row Row index.
+     * \return BasicTensorView
+     */
+    [[nodiscard]] BasicTensorView row(size_t row) const noexcept
+    {
+        return {_data + (row * _strides[0]), _shape[1], _strides[1]};
+    }
+
+private:
+    void _update_flags() noexcept
+    {
+        bool contiguous = _rank == 1 
+            ? _strides[0] == 1 || _shape[0] <= 1
+            : _strides[1] == 1 && (_strides[0] == _shape[1] || _shape[0] <= 1);
+        bool aligned = reinterpret_cast<uintptr_t>(_data) 
+            % AlignedStorage::alignment == 0;
+        _flags = static_cast<uint8_t>((contiguous ? Contiguous : 0) 
+            | (aligned ? Aligned : 0));
+    }
+
+    T* _data{nullptr};
+    size_t _rank{0};
+    std::array<size_t, max_rank> _shape{0, 1};
+    std::array<size_t, max_rank> _strides{1, 1};
+    uint8_t _flags{Contiguous};
+};
+
+using TensorView      = BasicTensorView<NumType>;
+using ConstTensorView = BasicTensorView<NumType const>;
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_TENSOR_VIEW_HPP
@@ -0,0 +1,269 @@
+/***************************************************************************
+ *            thread_pool.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Ariadne {
+
+namespace {
+
+/// Pool of the current thread, if it is a pool worker.
+thread_local ThreadPool* current_pool = nullptr;
+/// Index of the current thread in its pool.
+thread_local size_t current_index = 0;
+
+} // namespace
+
+std::unique_ptr<ThreadPool> ThreadPool::_global;
+
+ThreadPool::ThreadPool(size_t threads, bool pin)
+{
+    for (size_t i = 0; i < threads; ++i)
+    {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (size_t i = 0; i < threads; ++i)
+    {
+        _workers[i]->thread = std::thread{&ThreadPool::_loop, this, i};
+
+#if defined(__linux__)
+        if (pin)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % std::max(1U, std::thread::hardware_concurrency()),
+                &cpus);
+            pthread_setaffinity_np(_workers[i]->thread.native_handle(),
+                sizeof(cpu_set_t), &cpus);
+        }
+#else
+        (void) pin;
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{_sleep_mutex};
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for (auto& w: _workers)
+    {
+        w->thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static std::once_flag once;
+    std::call_once(once, []()
+    {
+        if (!_global)
+        {
+            size_t hw = std::thread::hardware_concurrency();
+            _global = std::make_unique<ThreadPool>(hw > 1 ? hw - 1 : 0);
+        }
+    });
+    return *_global;
+}
+
+void ThreadPool::configure(size_t threads, bool pin)
+{
+    _global = std::make_unique<ThreadPool>(threads, pin);
+}
+
+void ThreadPool::parallel_for(size_t begin, size_t end, size_t grain,
+    std::function<void(size_t, size_t)> const& body)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    size_t const length = end - begin;
+    grain = std::max(grain, size_t{1});
+    if (_workers.empty() || length < 2 * grain)
+    {
+        body(begin, end);
+        return;
+    }
+
+    // Oversplit a bit so that stealing can balance uneven chunks.
+    size_t const chunks = std::min(length / grain, (size() + 1) * 4);
+
+    Job job;
+    job.body = &body;
+    job.pending.store(chunks, std::memory_order_relaxed);
+
+    // Workers queue on their own deque, other threads spread the tasks. 
+    // The tasks are counted before they can be stolen, so that the count 
+    // never goes below zero.
+    _queued.fetch_add(chunks, std::memory_order_release);
+    size_t const self = current_pool == this ? current_index : size();
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        Task task{&job, begin + (length * c) / chunks,
+            begin + (length * (c + 1)) / chunks};
+        size_t target = self < size()
+            ? self
+            : _next.fetch_add(1, std::memory_order_relaxed) % size();
+        std::lock_guard<std::mutex> lock{_workers[target]->mutex};
+        _workers[target]->tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> lock{_sleep_mutex};
+    }
+    _wake.notify_all();
+
+    // Help until all the chunks of this job are done.
+    Task task;
+    while (job.pending.load(std::memory_order_acquire) > 0)
+    {
+        if (_acquire(self, task))
+        {
+            _execute(task);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if (job.error)
+    {
+        std::rethrow_exception(job.error);
+    }
+}
+
+void ThreadPool::TaskDeque::push_back(Task const& task)
+{
+    if (_size == _ring.size())
+    {
+        std::vector<Task> ring(std::max(size_t{16}, 2 * _ring.size()));
+        for (size_t i = 0; i < _size; ++i)
+        {
+            ring[i] = _ring[(_head + i) % _ring.size()];
+        }
+        _ring = std::move(ring);
+        _head = 0;
+    }
+    _ring[(_head + _size) % _ring.size()] = task;
+    ++_size;
+}
+
+void ThreadPool::_loop(size_t index)
+{
+    current_pool  = this;
+    current_index = index;
+
+    Task task;
+    for (;;)
+    {
+        if (_acquire(index, task))
+        {
+            _execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock{_sleep_mutex};
+        _wake.wait(lock, [this]()
+        {
+            return _stop || _queued.load(std::memory_order_acquire) > 0;
+        });
+        if (_stop && _queued.load(std::memory_order_acquire) == 0)
+        {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::_acquire(size_t index, Task& task)
+{
+    if (_queued.load(std::memory_order_acquire) == 0)
+    {
+        return false;
+    }
+
+    // Own deque first, newest task, which is the most likely in cache.
+    if (index < size())
+    {
+        Worker& w = *_workers[index];
+        std::lock_guard<std::mutex> lock{w.mutex};
+        if (!w.tasks.empty())
+        {
+            task = w.tasks.back();
+            w.tasks.pop_back();
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Steal the oldest task of the other deques.
+    for (size_t i = 1; i <= size(); ++i)
+    {
+        Worker& w = *_workers[(index + i) % size()];
+        std::lock_guard<std::mutex> lock{w.mutex};
+        if (!w.tasks.empty())
+        {
+            task = w.tasks.front();
+            w.tasks.pop_front();
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::_execute(Task const& task)
+{
+    Job* job = task.job;
+    try
+    {
+        (*job->body)(task.begin, task.end);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock{job->error_mutex};
+        if (!job->error)
+        {
+            job->error = std::current_exception();
+        }
+    }
+    // Last access to the job: the caller may destroy it right after.
+    job->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+} // namespace Ariadne
@@ -0,0 +1,191 @@
+/***************************************************************************
+ *            thread_pool.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*! \file thread_pool.hpp
+ *  \brief Work-stealing thread pool for intra-op parallelism.
+ */
+
+#ifndef ARIADNE_DNN_THREAD_POOL_HPP
+#define ARIADNE_DNN_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Pool of worker threads with a task deque each.
+ *
+ * A worker pops tasks from the back of its own deque and, when it is empty,
+ * steals from the front of the deques of the other workers. The thread that
+ * calls parallel_for() does not sleep while the loop runs: it executes tasks
+ * as well, so a pool of N workers runs a loop on N + 1 threads and a pool of
+ * 0 workers runs it serially on the caller.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * \brief Construct a new ThreadPool object.
+     * \param threads Amount of worker threads.
+     * \param pin     Pin each worker to a CPU (Linux only).
+     */
+    explicit ThreadPool(size_t threads, bool pin = false);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    /**
+     * \brief Pool used by the library kernels. Unless configured, it has
+     * one worker less than the hardware threads, since the calling thread
+     * takes part in the work.
+     * \return ThreadPool&
+     */
+    static ThreadPool& global();
+
+    /**
+     * \brief Replace the pool used by the library kernels. It must not be
+     * called while a kernel is running.
+     * \param threads Amount of worker threads.
+     * \param pin     Pin each worker to a CPU (Linux only).
+     */
+    static void configure(size_t threads, bool pin = false);
+
+    /**
+     * \brief Amount of worker threads.
+     * \return size_t
+     */
+    [[nodiscard]] size_t size() const noexcept { return _workers.size(); }
+
+    /**
+     * \brief Run body on the chunks of [begin, end) in parallel and wait for
+     * the completion. Chunks are never smaller than grain, so ranges smaller
+     * than two grains run serially on the calling thread. Exceptions thrown
+     * by body are rethrown to the caller.
+     * \param begin Begin of the range.
+     * \param end   End of the range.
+     * \param grain Minimum amount of indices in a chunk.
+     * \param body  Function called with the bounds [first, last) of a chunk.
+     */
+    void parallel_for(size_t begin, size_t end, size_t grain,
+        std::function<void(size_t, size_t)> const& body);
+
+private:
+    /**
+     * \brief State shared by the tasks of a parallel_for call.
+     */
+    struct Job
+    {
+        std::function<void(size_t, size_t)> const* body;
+        std::atomic<size_t> pending;
+        std::exception_ptr error;
+        std::mutex error_mutex;
+    };
+
+    struct Task
+    {
+        Job* job;
+        size_t begin;
+        size_t end;
+    };
+
+    /**
+     * \brief Double-ended queue of tasks on a ring buffer, that allocates 
+     * only to grow beyond the largest size reached so far.
+     */
+    class TaskDeque
+    {
+    public:
+        [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+        Task const& front() const { return _ring[_head]; }
+        Task const& back() const 
+        { 
+            return _ring[(_head + _size - 1) % _ring.size()]; 
+        }
+
+        void push_back(Task const& task);
+
+        void pop_front() noexcept
+        {
+            _head = (_head + 1) % _ring.size();
+            --_size;
+        }
+
+        void pop_back() noexcept { --_size; }
+
+    private:
+        std::vector<Task> _ring;
+        size_t _head{0};
+        size_t _size{0};
+    };
+
+    struct Worker
+    {
+        TaskDeque tasks;
+        std::mutex mutex;
+        std::thread thread;
+    };
+
+    /**
+     * \brief Body of the worker threads.
+     * \param index Worker index.
+     */
+    void _loop(size_t index);
+
+    /**
+     * \brief Pop a task from the own deque or steal one from the others.
+     * \param index Worker index, or size() for threads outside the pool.
+     * \param task  Task found.
+     * \return bool Whether a task has been found.
+     */
+    bool _acquire(size_t index, Task& task);
+
+    /**
+     * \brief Run a task and signal its completion to the job.
+     * \param task
+     */
+    static void _execute(Task const& task);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<size_t> _queued{0};  ///< Tasks in or entering the deques.
+    std::atomic<size_t> _next{0};    ///< Round-robin deque for new tasks.
+    std::mutex _sleep_mutex;
+    std::condition_variable _wake;
+    bool _stop{false};
+
+    static std::unique_ptr<ThreadPool> _global;
+};
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_THREAD_POOL_HPP
@@ -0,0 +1,335 @@
+/***************************************************************************
+ *            tracer.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Ariadne {
+
+namespace {
+
+struct Event
+{
+    char const* category;
+    int64_t begin;  ///< Nanoseconds since start().
+    int64_t end;
+    char name[Tracer::name_size + 1];
+};
+
+struct Chunk
+{
+    static constexpr size_t capacity = 4096;
+
+    Event events[capacity];
+    std::atomic<size_t> size{0};       ///< Events published by the owner.
+    std::atomic<Chunk*> next{nullptr}; ///< Published when this one is full.
+};
+
+/**
+ * \brief Spans of a thread. Buffers are owned by the registry, so that 
+ * the spans outlive the threads, and are freed by the first start() after 
+ * the exit of their thread: the buffer of a running thread is only reset by
+ * the thread itself, never freed under its feet.
+ */
+struct Buffer
+{
+    explicit Buffer(uint64_t thread_id)
+        : tid{thread_id}
+        , head{new Chunk}
+        , tail{head}
+    {}
+
+    ~Buffer()
+    {
+        for (Chunk* c = head; c != nullptr;)
+        {
+            Chunk* next = c->next.load(std::memory_order_relaxed);
+            delete c;
+            c = next;
+        }
+    }
+
+    Buffer(Buffer const&) = delete;
+    Buffer& operator=(Buffer const&) = delete;
+
+    /**
+     * \brief Drop the spans, keeping the first chunk. Called by the owner 
+     * with the registry locked, so that no reader walks the chunks freed.
+     */
+    void reset()
+    {
+        for (Chunk* c = head->next.load(std::memory_order_relaxed); 
+            c != nullptr;)
+        {
+            Chunk* next = c->next.load(std::memory_order_relaxed);
+            delete c;
+            c = next;
+        }
+        head->next.store(nullptr, std::memory_order_relaxed);
+        head->size.store(0, std::memory_order_relaxed);
+        tail = head;
+    }
+
+    uint64_t tid;
+    Chunk* head;
+    Chunk* tail;            ///< Accessed by the owner only.
+    uint64_t generation{0}; ///< start() of the spans, registry locked.
+    bool alive{true};       ///< Whether the owner runs, registry locked.
+};
+
+std::atomic<bool> recording_flag{false};
+std::atomic<uint64_t> generation{0};       ///< Incremented by start().
+std::atomic<Tracer::Clock::rep> epoch{0};  ///< Time of start().
+
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<Buffer>> registry;
+
+/**
+ * \brief Buffer of a thread, released to start() at the thread exit.
+ */
+struct LocalBuffer
+{
+    ~LocalBuffer()
+    {
+        if (buffer != nullptr)
+        {
+            std::lock_guard<std::mutex> lock{registry_mutex};
+            buffer->alive = false;
+        }
+    }
+
+    Buffer* buffer{nullptr};
+    uint64_t generation{0};
+};
+
+thread_local LocalBuffer local;
+
+uint64_t thread_id()
+{
+#if defined(__linux__)
+    return static_cast<uint64_t>(::syscall(SYS_gettid));
+#else
+    std::lock_guard<std::mutex> lock{registry_mutex};
+    return registry.size();
+#endif
+}
+
+/**
+ * \brief Buffer of the calling thread, registered at its first span and 
+ * reset at its first span after each start().
+ */
+Buffer& buffer()
+{
+    uint64_t current = generation.load(std::memory_order_acquire);
+    if (local.buffer == nullptr || local.generation != current)
+    {
+        auto b = local.buffer == nullptr 
+            ? std::make_unique<Buffer>(thread_id()) : nullptr;
+        std::lock_guard<std::mutex> lock{registry_mutex};
+        if (b)
+        {
+            local.buffer = b.get();
+            registry.push_back(std::move(b));
+        }
+        else
+        {
+            local.buffer->reset();
+        }
+        // start() holds the lock to increment it: this is the current one.
+        current = generation.load(std::memory_order_relaxed);
+        local.buffer->generation = current;
+        local.generation = current;
+    }
+    return *local.buffer;
+}
+
+void write_escaped(std::ostream& out, char const* s)
+{
+    for (; *s != '\0'; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            out << '\\' << *s;
+        }
+        else if (static_cast<unsigned char>(*s) < 0x20)
+        {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", 
+                static_cast<unsigned>(*s));
+            out << code;
+        }
+        else
+        {
+            out << *s;
+        }
+    }
+}
+
+} // namespace
+
+void Tracer::start()
+{
+    // Buffers of the running threads are reset by their owners, the spans 
+    // of the previous generations are skipped meanwhile.
+    std::lock_guard<std::mutex> lock{registry_mutex};
+    registry.erase(std::remove_if(registry.begin(), registry.end(), 
+        [](auto const& b) { return !b->alive; }), registry.end());
+    epoch.store(Clock::now().time_since_epoch().count(), 
+        std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    recording_flag.store(true, std::memory_order_release);
+}
+
+void Tracer::stop()
+{
+    recording_flag.store(false, std::memory_order_release);
+}
+
+bool Tracer::recording() noexcept
+{
+    return recording_flag.load(std::memory_order_acquire);
+}
+
+void Tracer::record(char const* category, std::string_view name, 
+    Clock::time_point begin, Clock::time_point end)
+{
+    if (!recording())
+    {
+        return;
+    }
+
+    Buffer& b = buffer();
+    Chunk* c = b.tail;
+    size_t n = c->size.load(std::memory_order_relaxed);
+    if (n == Chunk::capacity)
+    {
+        auto* next = new Chunk;
+        c->next.store(next, std::memory_order_release);
+        b.tail = c = next;
+        n = 0;
+    }
+
+    Clock::time_point const origin{Clock::duration{
+        epoch.load(std::memory_order_relaxed)}};
+    Event& e = c->events[n];
+    e.category = category;
+    e.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        begin - origin).count();
+    e.end = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        end - origin).count();
+    size_t length = std::min(name.size(), name_size);
+    std::copy_n(name.data(), length, e.name);
+    e.name[length] = '\0';
+    c->size.store(n + 1, std::memory_order_release);
+}
+
+size_t Tracer::size()
+{
+    std::lock_guard<std::mutex> lock{registry_mutex};
+    size_t count = 0;
+    uint64_t const current = generation.load(std::memory_order_relaxed);
+    for (auto& b: registry)
+    {
+        if (b->generation != current)
+        {
+            continue;
+        }
+        for (Chunk* c = b->head; c != nullptr; 
+            c = c->next.load(std::memory_order_acquire))
+        {
+            count += c->size.load(std::memory_order_acquire);
+        }
+    }
+    return count;
+}
+
+void Tracer::write(std::ostream& out)
+{
+#if defined(__linux__)
+    long const pid = static_cast<long>(::getpid());
+#else
+    long const pid = 1;
+#endif
+
+    std::lock_guard<std::mutex> lock{registry_mutex};
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char numbers[128];
+    bool first = true;
+    uint64_t const current = generation.load(std::memory_order_relaxed);
+    for (auto& b: registry)
+    {
+        if (b->generation != current)
+        {
+            continue;
+        }
+        for (Chunk* c = b->head; c != nullptr; 
+            c = c->next.load(std::memory_order_acquire))
+        {
+            size_t n = c->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; ++i)
+            {
+                Event const& e = c->events[i];
+                out << (first ? "\n" : ",\n") << "{\"name\":\"";
+                write_escaped(out, e.name);
+                out << "\",\"cat\":\"";
+                write_escaped(out, e.category);
+                std::snprintf(numbers, sizeof(numbers), "\",\"ph\":\"X\","
+                    "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%llu}", 
+                    static_cast<double>(e.begin) / 1e3, 
+                    static_cast<double>(e.end - e.begin) / 1e3, pid, 
+                    static_cast<unsigned long long>(b->tid));
+                out << numbers;
+                first = false;
+            }
+        }
+    }
+    out << "\n]}\n";
+}
+
+void Tracer::write(std::filesystem::path const& path)
+{
+    std::ofstream out{path};
+    if (!out)
+    {
+        throw std::runtime_error("could not open " + path.string());
+    }
+    write(out);
+}
+
+} // namespace Ariadne
@@ -0,0 +1,158 @@
+/***************************************************************************
+ *            tracer.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file tracer.hpp
+ *  \brief Timeline of the library activity in the Chrome trace format.
+ *
+ *  Spans are recorded for the forward, reverse and optimizer calls of each 
+ *  layer, the training steps, the CSV loading and the checkpoints, on the 
+ *  thread that runs them. The hooks are compiled only when the project is 
+ *  configured with -DENABLE_PROFILING=true, and record only between 
+ *  Tracer::start() and Tracer::stop(). The written JSON opens in 
+ *  about:tracing and in the Perfetto UI.
+ */
+
+#ifndef ARIADNE_DNN_TRACER_HPP
+#define ARIADNE_DNN_TRACER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <string_view>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Process-wide recorder of spans.
+ *
+ * Each thread appends its spans to its own buffer, a list of fixed-size 
+ * chunks that only the owner writes and that publishes the amount of 
+ * events with an atomic store, so recording takes no lock and never waits 
+ * for the other threads or for write(). A thread takes a lock only once, 
+ * to register its buffer at its first span.
+ */
+class Tracer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// \brief Longest span name kept, longer names are truncated.
+    static constexpr size_t name_size = 47;
+
+    /**
+     * \brief Drop the recorded spans and start recording. It can be called 
+     * while other threads record: a span that ends meanwhile may be left 
+     * out.
+     */
+    static void start();
+
+    /**
+     * \brief Stop recording, the recorded spans are kept.
+     */
+    static void stop();
+
+    /**
+     * \brief Whether spans are recorded.
+     * \return bool
+     */
+    [[nodiscard]] static bool recording() noexcept;
+
+    /**
+     * \brief Record a span of the calling thread, if recording.
+     * \param category Static string, e.g. the phase.
+     * \param name     Name of the span.
+     * \param begin
+     * \param end
+     */
+    static void record(char const* category, std::string_view name, 
+        Clock::time_point begin, Clock::time_point end);
+
+    /**
+     * \brief Amount of spans recorded since start().
+     * \return size_t
+     */
+    [[nodiscard]] static size_t size();
+
+    /**
+     * \brief Write the recorded spans as a Chrome trace JSON object. It can 
+     * be called while recording, the spans recorded meanwhile may be left 
+     * out.
+     * \param out Output stream.
+     */
+    static void write(std::ostream& out);
+
+    /**
+     * \brief Write the recorded spans to a Chrome trace JSON file.
+     * \param path
+     */
+    static void write(std::filesystem::path const& path);
+};
+
+/**
+ * \brief Record the enclosing scope as a span.
+ */
+class TraceScope
+{
+public:
+    /**
+     * \brief Construct a new TraceScope object.
+     * \param category Static string.
+     * \param name     Name of the span, that has to outlive the scope.
+     */
+    TraceScope(char const* category, std::string_view name)
+        : _category{category}
+        , _name{name}
+        , _begin{Tracer::Clock::now()}
+    {}
+
+    ~TraceScope()
+    {
+        Tracer::record(_category, _name, _begin, Tracer::Clock::now());
+    }
+
+    TraceScope(TraceScope const&) = delete;
+    TraceScope& operator=(TraceScope const&) = delete;
+
+private:
+    char const* _category;
+    std::string_view _name;
+    Tracer::Clock::time_point _begin;
+};
+
+} // namespace Ariadne
+
+#if ENABLE_PROFILING
+/**
+ * \brief Record the rest of the enclosing scope as a span.
+ */
+#define ARIADNE_TRACE_SCOPE(category, name) \
+    ::Ariadne::TraceScope ariadne_trace_scope{category, name}
+#else
+#define ARIADNE_TRACE_SCOPE(category, name) ((void) 0)
+#endif
+
+#endif // ARIADNE_DNN_TRACER_HPP
@@ -0,0 +1,166 @@
+/***************************************************************************
+ *            trainer.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "trainer.hpp"
+
+#include "tracer.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace Ariadne {
+
+template <typename T>
+BasicTrainer<T>::BasicTrainer(BasicModel<T>& model, 
+    BasicLossLayer<T>& loss_layer, BasicOptimizer<T>& optimizer,
+    std::vector<std::vector<T>> const& inputs,
+    std::vector<std::vector<T>> const& targets,
+    size_t batch_size)
+    : _model{model}
+    , _loss_layer{loss_layer}
+    , _optimizer{optimizer}
+    , _inputs{inputs}
+    , _targets{targets}
+    , _batch_size{batch_size}
+{
+    if (_inputs.empty() || _inputs.size() != _targets.size())
+    {
+        throw std::runtime_error("inputs and targets have to be non empty "
+                                 "and of the same size");
+    }
+
+    if (_batch_size == 0)
+    {
+        throw std::runtime_error("batch_size has to be greater than 0");
+    }
+}
+
+template <typename T>
+void BasicTrainer<T>::step()
+{
+    ARIADNE_TRACE_SCOPE("batch", "step");
+    while (_batch_samples < _batch_size && _cursor < _inputs.size())
+    {
+        _run_sample();
+    }
+    _run_optimizer();
+}
+
+template <typename T>
+size_t BasicTrainer<T>::step_for(std::chrono::microseconds budget)
+{
+    ARIADNE_TRACE_SCOPE("batch", "step_for");
+    auto const start    = _now();
+    auto const deadline = start + budget;
+    size_t const batches_before = _batches;
+
+    auto now = start;
+    for (bool ran = false;; ran = true)
+    {
+        bool batch_done = _batch_samples == _batch_size
+                       || _cursor == _inputs.size();
+        auto& cost = batch_done ? _optimizer_cost : _sample_cost;
+
+        // Units never measured run to be measured. A call that runs 
+        // nothing lowers the estimate that stopped it, so that an outlier 
+        // measure cannot stop the training for good.
+        if (cost != Clock::duration::zero() && now + cost > deadline)
+        {
+            if (!ran)
+            {
+                cost /= 2;
+            }
+            break;
+        }
+
+        if (batch_done)
+        {
+            _run_optimizer();
+        }
+        else
+        {
+            _run_sample();
+        }
+
+        auto end = _now();
+        _update_estimate(cost, end - now);
+        now = end;
+    }
+
+    return _batches - batches_before;
+}
+
+template <typename T>
+void BasicTrainer<T>::set_clock(std::function<Clock::time_point()> now)
+{
+    _now = std::move(now);
+}
+
+template <typename T>
+void BasicTrainer<T>::_run_sample()
+{
+    // Scores are kept for the whole epoch and dropped when a new one starts.
+    if (_cursor == 0 && _batch_samples == 0)
+    {
+        _loss_layer.reset_score();
+    }
+
+    _loss_layer.set_target(_targets[_cursor].data());
+    _model.forward(const_cast<T*>(_inputs[_cursor].data()));
+    _model.reverse();
+
+    ++_cursor;
+    ++_batch_samples;
+}
+
+template <typename T>
+void BasicTrainer<T>::_run_optimizer()
+{
+    _model.train(_optimizer);
+    _batch_samples = 0;
+    ++_batches;
+
+    if (_cursor == _inputs.size())
+    {
+        _cursor = 0;
+        ++_epoch;
+    }
+}
+
+template <typename T>
+void BasicTrainer<T>::_update_estimate(Clock::duration& estimate,
+    Clock::duration measure)
+{
+    if (estimate == Clock::duration::zero())
+    {
+        estimate = measure;
+        return;
+    }
+    estimate = (estimate * 3 + measure) / 4;
+}
+
+template class BasicTrainer<float>;
+template class BasicTrainer<double>;
+
+} // namespace Ariadne
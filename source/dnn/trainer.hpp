@@ -0,0 +1,166 @@
+/***************************************************************************
+ *            trainer.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*! \file trainer.hpp
+ *  \brief Resumable mini-batch trainer.
+ */
+
+#ifndef ARIADNE_DNN_TRAINER_HPP
+#define ARIADNE_DNN_TRAINER_HPP
+
+#include "loss.hpp"
+#include "model.hpp"
+#include "optimizer.hpp"
+#include "type.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+
+namespace Ariadne {
+
+/**
+ * \brief Mini-batch SGD loop that can be suspended and resumed at sample
+ * granularity.
+ *
+ * The trainer owns the position in the dataset (epoch, sample and the
+ * progress inside the current mini-batch), so training can be interleaved
+ * with other work: each call to step_for() runs for at most the given time
+ * budget and returns, the next call continues exactly where the previous one
+ * stopped. Loss gradients of a partially evaluated mini-batch stay
+ * accumulated in the layers between calls.
+ * \tparam T Scalar type of the model.
+ */
+template <typename T>
+class BasicTrainer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * \brief Construct a new Trainer object.
+     * The dataset is referenced and not copied, so it has to outlive the
+     * trainer.
+     * \param model       Model to train, fed with each input sample.
+     * \param loss_layer  Loss layer fed with each target sample.
+     * \param optimizer   Optimizer invoked at the end of each mini-batch.
+     * \param inputs      Input samples.
+     * \param targets     Target samples, one for each input sample.
+     * \param batch_size  Amount of samples in a mini-batch.
+     */
+    BasicTrainer(BasicModel<T>& model, BasicLossLayer<T>& loss_layer, 
+        BasicOptimizer<T>& optimizer,
+        std::vector<std::vector<T>> const& inputs,
+        std::vector<std::vector<T>> const& targets,
+        size_t batch_size);
+
+    /**
+     * \brief Run a whole mini-batch, or what is left of the current one,
+     * regardless of the time it takes.
+     */
+    void step();
+
+    /**
+     * \brief Run as many samples and optimizer steps as fit in the budget.
+     * Before each unit of work the trainer checks that the elapsed time plus
+     * the running estimate of that unit cost does not exceed the budget, so
+     * the call returns before the budget expires instead of after it. A unit
+     * never measured runs regardless of the budget, to measure it. A call 
+     * that runs nothing halves the estimate that stopped it, so that an 
+     * outlier measure delays the training by a few calls instead of 
+     * blocking it for good.
+     * \param budget Maximum time spent in the call.
+     * \return size_t Amount of mini-batches completed during the call.
+     */
+    size_t step_for(std::chrono::microseconds budget);
+
+    /**
+     * \brief Replace the clock of step_for(), as a simulated
+     * one in tests.
+     * \param now Function returning the current time.
+     */
+    void set_clock(std::function<Clock::time_point()> now);
+
+    /**
+     * \brief Amount of full passes over the dataset completed.
+     * \return size_t
+     */
+    [[nodiscard]] size_t epoch() const noexcept { return _epoch; }
+
+    /**
+     * \brief Amount of optimizer steps performed since construction.
+     * \return size_t
+     */
+    [[nodiscard]] size_t batches() const noexcept { return _batches; }
+
+    /**
+     * \brief Index of the next sample to evaluate.
+     * \return size_t
+     */
+    [[nodiscard]] size_t cursor() const noexcept { return _cursor; }
+
+private:
+    /**
+     * \brief Forward and reverse propagate the sample at _cursor.
+     */
+    void _run_sample();
+
+    /**
+     * \brief Apply the optimizer and move to the next mini-batch.
+     */
+    void _run_optimizer();
+
+    /**
+     * \brief Update a running cost estimate with an exponential moving
+     * average that weights the last measure 1/4.
+     * \param estimate Estimate to update.
+     * \param measure  Last measured duration.
+     */
+    static void _update_estimate(Clock::duration& estimate,
+        Clock::duration measure);
+
+    BasicModel<T>& _model;
+    BasicLossLayer<T>& _loss_layer;
+    BasicOptimizer<T>& _optimizer;
+    std::vector<std::vector<T>> const& _inputs;
+    std::vector<std::vector<T>> const& _targets;
+    size_t _batch_size;
+
+    size_t _epoch{0};         ///< Completed epochs.
+    size_t _batches{0};       ///< Completed optimizer steps.
+    size_t _cursor{0};        ///< Next sample in the dataset.
+    size_t _batch_samples{0}; ///< Samples evaluated in the current batch.
+
+    std::function<Clock::time_point()> _now{&Clock::now}; ///< Time source.
+    Clock::duration _sample_cost{0};    ///< Estimated cost of a sample.
+    Clock::duration _optimizer_cost{0}; ///< Estimated cost of an update.
+};
+
+using Trainer = BasicTrainer<NumType>;
+
+} // namespace Ariadne
+
+#endif // ARIADNE_DNN_TRAINER_HPP
@@ -29,6 +29,7 @@
 #ifndef ARIADNE_DNN_TYPE_HPP
 #define ARIADNE_DNN_TYPE_HPP
 
+#include <cstdint>
 #include <random>
 
 namespace Ariadne {
@@ -41,6 +42,18 @@ using NumType = double;
  */
 using RneType = std::mt19937_64;
 
+/**
+ * \brief Scalar types of the tensors and of the parameter blocks of the 
+ * model files, which store the values.
+ */
+enum class DType : uint32_t
+{
+    Float32 = 1,
+    Float64 = 2,
+    Int8    = 3,
+    Int32   = 4
+};
+
 } // namespace Ariadne
 
 #endif // ARIADNE_DNN_TYPE_HPP
@@ -25,25 +25,29 @@
 
 #include "csv.hpp"
 
+#include "dnn/tracer.hpp"
+
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <vector>
 #include <iostream>
+#include <iterator>
 #include <limits>
 
 
 namespace Ariadne {
 
-CSVField::CSVField(std::string field, ParserType &type, size_t col_index)
+CSVField::CSVField(std::string_view field, ParserType &type, 
+    size_t col_index)
     : _field{field}
-    , _type{type}
+    , _type{&type}
     , _col_index{col_index}
 {
-    if (_type == ParserType::AUTO)
+    if (*_type == ParserType::AUTO)
     {
         auto p = Parser();
-        _type = p(_field);
+        *_type = p(std::string{_field});
     }
 }
 
@@ -55,18 +59,16 @@ CSVRow::CSVRow(std::string line, size_t row_idx, size_t cols_amount,
     , _types{types}
     , _separator{separator}
 {
+    _split();
     if((std::find(types.begin(), types.end(), ParserType::AUTO) != types.end())
         || types.size() == 0
         || types.size() != cols_amount) 
     {
-        std::stringstream ss{line};
         auto p = Parser();
         _types = std::vector<ParserType>{};
         for (size_t i = 0; i < cols_amount; ++i)
         {
-            std::string s;
-            std::getline(ss, s, separator);
-            _types.push_back(p(s));
+            _types.push_back(p(std::string{_view(i)}));
         }
     }
 }
@@ -92,6 +94,7 @@ CSVRow::CSVRow(const CSVRow &obj)
     , _cols_amount{obj._cols_amount}
     , _types{obj._types}
     , _separator{obj._separator}
+    , _ends{obj._ends}
 {
 
 }
@@ -103,21 +106,12 @@ CSVField CSVRow::operator[](size_t idx) const
         throw std::runtime_error(
             "operator[] failed: idx >= this->_cols_amount");
     }
-
-    std::string field;
-    size_t i = 0;
-    std::stringstream ss{_line};
-    while(std::getline(ss, field, _separator)) 
+    if (idx >= _ends.size())
     {
-        if(i == idx)
-        {
-            return CSVField{field, _types.at(idx), idx};
-        }
-
-        i++;
+        throw std::runtime_error("CSV bad format: fields missing");
     }
 
-    throw std::runtime_error("CSV bad format: fields missing");
+    return CSVField{_view(idx), _types.at(idx), idx};
 }
 
 CSVRow& CSVRow::operator=(const CSVRow &obj)
@@ -127,6 +121,7 @@ CSVRow& CSVRow::operator=(const CSVRow &obj)
     _cols_amount = obj._cols_amount;
     _types = obj._types;
     _separator = obj._separator;
+    _ends = obj._ends;
     return *this;
 }
 
@@ -139,12 +134,9 @@ std::ostream& operator<<(std::ostream& stream, const CSVRow& obj)
 CSVRow::operator std::vector<std::string>()
 {
     std::vector<std::string> ret{};
-    std::stringstream ss{_line};
     for (size_t i = 0; i < _cols_amount; ++i)
     {
-        std::string s;
-        std::getline(ss, s, _separator);
-        ret.push_back(s);
+        ret.emplace_back(_view(i));
     }
     return ret;
 }
@@ -152,25 +144,49 @@ CSVRow::operator std::vector<std::string>()
 CSVRow::operator std::vector<CSVField>()
 {
     std::vector<CSVField> ret{};
-    std::stringstream ss{_line};
     for (size_t i = 0; i < _cols_amount; ++i)
     {
-        std::string s;
-        std::getline(ss, s, _separator);
-        ret.push_back(CSVField{s, _types.at(i), i});
+        ret.push_back(CSVField{_view(i), _types.at(i), i});
     }
     return ret;
 }
 
+void CSVRow::_split()
+{
+    // clear() keeps the capacity: the rows of an iteration reuse it.
+    _ends.clear();
+    if (_line.empty())
+    {
+        return;
+    }
+    for (size_t pos = _line.find(_separator); pos != std::string::npos; 
+        pos = _line.find(_separator, pos + 1))
+    {
+        _ends.push_back(pos);
+    }
+    _ends.push_back(_line.size());
+}
+
+std::string_view CSVRow::_view(size_t idx) const
+{
+    if (idx >= _ends.size())
+    {
+        return {};
+    }
+    size_t begin = idx == 0 ? 0 : _ends[idx - 1] + 1;
+    return std::string_view{_line}.substr(begin, _ends[idx] - begin);
+}
+
 CSVIterator::CSVIterator(std::string fn, size_t idx, size_t cols_amount,
     std::vector<ParserType> &types, char separator)
     : _fn{fn}
-    , _row{types, separator}
+    // With the columns amount the row keeps the types of the CSV, that 
+    // an empty row would reset.
+    , _row{std::string{}, idx, cols_amount, types, separator}
     , _is_stream_updated{false}
     , _stream{fn}
 {
-    _row._idx = idx;
-    _row._cols_amount = cols_amount;
+
 }
 
 CSVIterator::CSVIterator(const CSVIterator &obj)
@@ -238,7 +254,9 @@ void CSVIterator::update_stream()
 
 void CSVIterator::update_row()
 {
+    // The line and the field ends keep their storage across rows.
     std::getline(_stream, _row._line);
+    _row._split();
 }
 
 CSV::CSV(std::string fn, std::vector<ParserType> types, char separator) 
@@ -249,6 +267,7 @@ CSV::CSV(std::string fn, std::vector<ParserType> types, char separator)
     , _row_cache{_types}
     , _separator{separator}
 {
+    ARIADNE_TRACE_SCOPE("csv", _fn);
     auto file = std::ifstream{fn};
     if(!file.is_open() || !file.good()) 
     {
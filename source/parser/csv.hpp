@@ -34,16 +34,22 @@
 #include <fstream>
 #include <sstream>
 #include <cstddef>
+#include <string_view>
+#include <vector>
 
 
 namespace Ariadne {
 
+/**
+ * \brief Field of a CSVRow. It views the line of the row, and is valid 
+ * until the row moves to another line.
+ */
 class CSVField
 {
     friend class CSVRow;
 
 public:
-    CSVField(std::string field, ParserType &type, size_t col_index);
+    CSVField(std::string_view field, ParserType &type, size_t col_index);
     ~CSVField() = default;
 
     template<typename T>
@@ -60,12 +66,12 @@ public:
         return ret;
     }
 
-    const ParserType &type() const { return _type; }
+    const ParserType &type() const { return *_type; }
     size_t idx() const { return _col_index; }
 
 private:
-    std::string _field;
-    ParserType &_type;
+    std::string_view _field;
+    ParserType *_type;
     size_t _col_index;
 };
 
@@ -94,16 +100,24 @@ public:
     operator std::vector<T>()
     {
         std::vector<T> ret{};
-        std::stringstream ss{_line};
+        as(ret);
+        return ret;
+    }
+
+    /**
+     * \brief Convert the fields in a vector, reusing its storage.
+     * \param values Converted fields, resized to size().
+     */
+    template<typename T>
+    void as(std::vector<T> &values) const
+    {
+        values.resize(_cols_amount);
         for (size_t i = 0; i < _cols_amount; ++i)
         {
-            std::string s;
-            std::getline(ss, s, _separator);
-            T t;
-            convert(s, &t);
-            ret.push_back(t);
+            T value;
+            convert(_view(i), &value);
+            values[i] = value;
         }
-        return ret;
     }
 
     size_t size() const { return _cols_amount; }
@@ -112,11 +126,24 @@ public:
     size_t idx() const { return _idx; }
 
 private:
+    /**
+     * \brief Find the fields of _line, reusing the storage of _ends.
+     */
+    void _split();
+
+    /**
+     * \brief Field of the line, empty if the line has less fields.
+     * \param idx
+     * \return std::string_view
+     */
+    std::string_view _view(size_t idx) const;
+
     std::string _line;
     size_t _idx;
     size_t _cols_amount;
     std::vector<ParserType> &_types;
     char _separator;
+    std::vector<size_t> _ends; ///< End of each field in _line.
 };
 
 
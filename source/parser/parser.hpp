@@ -30,8 +30,11 @@
 #define ARIADNE_REPLACEME_HPP
 
 
+#include <charconv>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <type_traits>
 #include <vector>
 #include <regex>
 
@@ -101,7 +104,7 @@ bool operator!=(const std::vector<ParserType> &lhs,
     const std::vector<ParserType> &rhs);
 
 template<typename T>
-bool convert(const std::string &s, T *ptr)
+bool convert(std::string_view s, T *ptr)
 {
     if constexpr (std::is_same_v<T, bool>)
     {
@@ -116,11 +119,33 @@ bool convert(const std::string &s, T *ptr)
 
         return true;
     }
+    else if constexpr (std::is_arithmetic_v<T>)
+    {
+        // Numbers are parsed in place, without a stream and its buffer. As 
+        // the stream extraction, leading blanks and a plus sign are allowed.
+        char const *first = s.data();
+        char const *last  = s.data() + s.size();
+        while (first != last && (*first == ' ' || *first == '\t'))
+        {
+            ++first;
+        }
+        if (first != last && *first == '+')
+        {
+            if (++first != last && *first == '-')
+            {
+                return false;
+            }
+        }
+        auto [end, error] = std::from_chars(first, last, *ptr);
+        return error == std::errc{} && end == last;
+    }
+    else
+    {
+        std::stringstream ss{std::string{s}};
+        ss >> *ptr;
 
-    std::stringstream ss{s};
-    ss >> *ptr;
-
-    return !ss.fail() && ss.eof();
+        return !ss.fail() && ss.eof();
+    }
 }
 
 } // namespace Ariadne
@@ -0,0 +1,48 @@
+/***************************************************************************
+ *            export_model.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file export_model.cpp
+ *  \brief Build step of test_export: export the model to the header given
+ *  as argument.
+ */
+
+#include "exported_model.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "usage: %s <header>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Ariadne::Model m{"exported"};
+    build_exported_model(m);
+    m.export_cpp(argv[1], "exported");
+    return EXIT_SUCCESS;
+}
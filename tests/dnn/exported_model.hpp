@@ -0,0 +1,57 @@
+/***************************************************************************
+ *            exported_model.hpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file exported_model.hpp
+ *  \brief Model shared by the export generator and its test.
+ */
+
+#ifndef ARIADNE_TESTS_DNN_EXPORTED_MODEL_HPP
+#define ARIADNE_TESTS_DNN_EXPORTED_MODEL_HPP
+
+#include "dnn/cce_loss.hpp"
+#include "dnn/dense.hpp"
+#include "dnn/model.hpp"
+
+/**
+ * \brief Build a model with fan-out, fan-in and every activation.
+ * \param m Empty model.
+ */
+inline void build_exported_model(Ariadne::Model& m)
+{
+    using namespace Ariadne;
+    auto& a = m.add_node<DenseLayer>("a", Activation::ReLU, 8, 4);
+    auto& b = m.add_node<DenseLayer>("b", Activation::Linear, 5, 8);
+    auto& c = m.add_node<DenseLayer>("c", Activation::ReLU, 5, 8);
+    auto& d = m.add_node<DenseLayer>("d", Activation::Softmax, 3, 5);
+    auto& loss = m.add_node<CCELossLayer>("loss", 3, 1);
+    m.create_edge(b, a);
+    m.create_edge(c, a);
+    m.create_edge(d, b);
+    m.create_edge(d, c);
+    m.create_edge(loss, d);
+    m.init(7);
+}
+
+#endif // ARIADNE_TESTS_DNN_EXPORTED_MODEL_HPP
@@ -0,0 +1,271 @@
+/***************************************************************************
+ *            test_allocation.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "test.hpp"
+#include "dnn/allocation_tracker.hpp"
+#include "dnn/cce_loss.hpp"
+#include "dnn/dense.hpp"
+#include "dnn/dlmath.hpp"
+#include "dnn/gd_optimizer.hpp"
+#include "dnn/model.hpp"
+#include "dnn/mse_loss.hpp"
+#include "dnn/scratch_arena.hpp"
+#include "dnn/thread_pool.hpp"
+#include "dnn/trainer.hpp"
+#include "parser/csv.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Ariadne;
+
+class TestAllocation {
+public:
+    void test() {
+        ARIADNE_TEST_CALL(test_tracker());
+        ARIADNE_TEST_CALL(test_scratch());
+        ARIADNE_TEST_CALL(test_training_step());
+        ARIADNE_TEST_CALL(test_classifier_step());
+        ARIADNE_TEST_CALL(test_inference());
+        ARIADNE_TEST_CALL(test_thread_pool());
+        ARIADNE_TEST_CALL(test_csv());
+    }
+
+private:
+    const size_t BATCH_SIZE = 2;
+    const size_t WARM_UP = 3;
+    const RneType::result_type SEED = 1;
+
+    const std::vector<std::vector<NumType>> inputs = {
+        {10.0, 1.0, 10.0, 1.0},
+        {1.0,  3.0, 8.0,  3.0},
+        {8.0,  1.0, 8.0,  1.0},
+        {1.0,  1.5, 8.0,  1.5},
+    };
+
+    const std::vector<std::vector<NumType>> targets = {
+        {1.0, 0.0},
+        {0.0, 1.0},
+        {1.0, 0.0},
+        {0.0, 1.0},
+    };
+
+    void test_tracker() {
+        AllocationScope scope;
+        auto value = std::make_unique<int>(1);
+        std::vector<NumType> values(16);
+        ARIADNE_TEST_EQUAL(scope.count(), 2);
+        ARIADNE_TEST_EQUAL(scope.stats().bytes, 
+            sizeof(int) + 16 * sizeof(NumType));
+        ARIADNE_TEST_ASSERT(AllocationTracker::process_stats().count >= 2);
+    }
+
+    void test_scratch() {
+        std::vector<NumType> x{-2.0, -1.0, 0.0, 1.0, 2.0};
+        std::vector<NumType> y(x.size());
+        DLMath::softmax_1(y.data(), x.data(), x.size());
+
+        // The temporaries reuse the arena of the thread.
+        AllocationScope scope;
+        DLMath::softmax_1(y.data(), x.data(), x.size());
+        ARIADNE_TEST_EQUAL(scope.count(), 0);
+        ARIADNE_TEST_EQUAL(ScratchArena::local().used(), 0);
+    }
+
+    void test_training_step() {
+        Model m{"regressor"};
+        auto& hidden = m.add_node<DenseLayer>("hidden", Activation::ReLU, 
+            8, 4);
+        auto& output = m.add_node<DenseLayer>("output", Activation::Linear, 
+            2, 8);
+        auto& loss = m.add_node<MSELossLayer>("loss", 2, BATCH_SIZE);
+        m.create_edge(output, hidden);
+        m.create_edge(loss, output);
+        m.init(SEED);
+        GDOptimizer o{NumType{0.1}};
+        Trainer t{m, loss, o, inputs, targets, BATCH_SIZE};
+
+        // The first steps compile the model and bind its arena.
+        for (size_t i = 0; i < WARM_UP; ++i)
+        {
+            t.step();
+        }
+
+        AllocationScope scope;
+        t.step();
+        t.step();
+        ARIADNE_TEST_EQUAL(scope.count(), 0);
+    }
+
+    void test_classifier_step() {
+        Model m{"classifier"};
+        auto& hidden = m.add_node<DenseLayer>("hidden", Activation::ReLU, 
+            8, 4);
+        auto& output = m.add_node<DenseLayer>("output", Activation::Softmax, 
+            2, 8);
+        auto& loss = m.add_node<CCELossLayer>("loss", 2, BATCH_SIZE);
+        m.create_edge(output, hidden);
+        m.create_edge(loss, output);
+        m.init(SEED);
+        GDOptimizer o{NumType{0.1}};
+
+        auto step = [&](size_t i)
+        {
+            loss.set_target(targets[i].data());
+            m.forward(const_cast<NumType*>(inputs[i].data()));
+            m.reverse();
+            m.train(o);
+        };
+        for (size_t i = 0; i < WARM_UP; ++i)
+        {
+            step(i);
+        }
+
+        AllocationScope scope;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            step(i);
+        }
+        ARIADNE_TEST_EQUAL(scope.count(), 0);
+    }
+
+    void test_inference() {
+        Model m{"inference", ModelMode::Inference};
+        auto& hidden = m.add_node<DenseLayer>("hidden", Activation::ReLU, 
+            8, 4);
+        auto& output = m.add_node<DenseLayer>("output", Activation::Softmax, 
+            2, 8);
+        m.create_edge(output, hidden);
+        m.init(SEED);
+        m.predict(const_cast<NumType*>(inputs[0].data()));
+
+        AllocationScope scope;
+        NumType sum = 0.0;
+        for (auto& x: inputs)
+        {
+            NumType* y = m.predict(const_cast<NumType*>(x.data()));
+            sum += y[0] + y[1];
+        }
+        ARIADNE_TEST_EQUAL(scope.count(), 0);
+        ARIADNE_TEST_WITHIN(sum, NumType(inputs.size()), 1e-9);
+    }
+
+    void test_thread_pool() {
+        // Layers large enough to split their kernels on the pool workers.
+        ThreadPool::configure(2);
+        Model m{"wide"};
+        auto& hidden = m.add_node<DenseLayer>("hidden", Activation::ReLU, 
+            512, 256);
+        auto& output = m.add_node<DenseLayer>("output", Activation::Linear, 
+            2, 512);
+        auto& loss = m.add_node<MSELossLayer>("loss", 2, BATCH_SIZE);
+        m.create_edge(output, hidden);
+        m.create_edge(loss, output);
+        m.init(SEED);
+        GDOptimizer o{NumType{0.01}};
+        std::vector<NumType> x(256, 0.5);
+
+        auto step = [&]()
+        {
+            loss.set_target(targets[0].data());
+            m.forward(x.data());
+            m.reverse();
+            m.train(o);
+            m.predict(x.data());
+        };
+        for (size_t i = 0; i < WARM_UP; ++i)
+        {
+            step();
+        }
+
+        AllocationStats before = AllocationTracker::process_stats();
+        step();
+        step();
+        AllocationStats after = AllocationTracker::process_stats();
+        ARIADNE_TEST_EQUAL(after.count - before.count, 0);
+        ThreadPool::configure(0);
+    }
+
+    void test_csv() {
+        const size_t ROWS = 16;
+        auto path = std::filesystem::temp_directory_path() 
+            / "ariadne_test_allocation.csv";
+        {
+            std::ofstream out{path};
+            out << "first_value,second_value,third_value\n";
+            for (size_t i = 0; i < ROWS; ++i)
+            {
+                // Same line length: the row line keeps its capacity.
+                out << "1000.00" << i % 10 << ",2000.00" << i % 10 
+                    << ",3000.00" << i % 10 << "\n";
+            }
+        }
+
+        CSV csv{path.string()};
+        auto it = csv.begin();
+        auto end = csv.end();
+        std::vector<NumType> values;
+        NumType value = 0;
+        NumType sum = 0;
+
+        // The first rows size the line, the field ends and the values.
+        for (size_t i = 0; i < WARM_UP; ++i, ++it)
+        {
+            CSVRow& row = *it;
+            row.as(values);
+        }
+
+        size_t rows = WARM_UP;
+        {
+            AllocationScope scope;
+            for (; it != end; ++it, ++rows)
+            {
+                CSVRow& row = *it;
+                for (size_t i = 0; i < row.size(); ++i)
+                {
+                    row[i].as(&value);
+                    sum += value;
+                }
+                row.as(values);
+            }
+            ARIADNE_TEST_EQUAL(scope.count(), 0);
+        }
+        ARIADNE_TEST_ASSERT(rows > WARM_UP);
+        ARIADNE_TEST_EQUAL(values.size(), 3);
+        ARIADNE_TEST_WITHIN(values[2], NumType{3000}, NumType{0.01});
+        ARIADNE_TEST_ASSERT(sum > 0);
+
+        std::filesystem::remove(path);
+    }
+};
+
+int main() {
+    TestAllocation().test();
+    return ARIADNE_TEST_FAILURES;
+}
@@ -0,0 +1,273 @@
+/***************************************************************************
+ *            test_checkpointer.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "test.hpp"
+#include "dnn/layer.hpp"
+#include "dnn/model.hpp"
+#include "dnn/dense.hpp"
+#include "dnn/mse_loss.hpp"
+#include "dnn/gd_optimizer.hpp"
+#include "dnn/checkpointer.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+using namespace Ariadne;
+
+class TestCheckpointer {
+public:
+    void test() {
+        ARIADNE_TEST_CALL(test_full());
+        ARIADNE_TEST_CALL(test_delta());
+        ARIADNE_TEST_CALL(test_delta_pages());
+        ARIADNE_TEST_CALL(test_resume());
+        std::filesystem::remove_all(DIR);
+    }
+
+private:
+    const RneType::result_type SEED = 1;
+    const std::filesystem::path DIR = 
+        std::filesystem::temp_directory_path() / "ariadne_test_checkpointer";
+
+    const std::vector<NumType> input  = {10.0, 1.0, 10.0, 1.0};
+    const std::vector<NumType> target = {1.0, 0.0};
+
+    void test_full() {
+        std::filesystem::remove_all(DIR);
+        std::filesystem::create_directories(DIR);
+
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = _create_regressor_model(&input_layer, &loss_layer);
+        m.init(SEED);
+        GDOptimizer o{NumType{0.1}};
+        {
+            Checkpointer c{m, DIR / "model", 2};
+            for (size_t i = 0; i < 5; ++i)
+            {
+                _train(m, *loss_layer, o);
+                c.checkpoint();
+            }
+            c.flush();
+            ARIADNE_TEST_ASSERT(c.written() >= 1);
+            ARIADNE_TEST_ASSERT(std::filesystem::exists(c.last()));
+        }
+        ARIADNE_TEST_ASSERT(_files() <= 2);
+
+        // The last snapshot has the final parameters.
+        DenseLayer* restored_input;
+        MSELossLayer* restored_loss;
+        Model r = _create_regressor_model(&restored_input, &restored_loss);
+        Checkpointer::restore(r, DIR / "model");
+        _test_same_params(m, r);
+    }
+
+    void test_delta() {
+        std::filesystem::remove_all(DIR);
+        std::filesystem::create_directories(DIR);
+
+        // Only the head is trained, the first layer never changes.
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = _create_regressor_model(&input_layer, &loss_layer);
+        m.init(SEED);
+        input_layer->set_trainable(false);
+        GDOptimizer o{NumType{0.1}};
+
+        std::vector<uintmax_t> sizes;
+        {
+            Checkpointer c{m, DIR / "model", 2, CheckpointMode::Delta, 4};
+            for (size_t i = 0; i < 6; ++i)
+            {
+                _train(m, *loss_layer, o);
+                c.checkpoint();
+                c.flush();
+                sizes.push_back(std::filesystem::file_size(c.last()));
+            }
+        }
+        ARIADNE_TEST_PRINT(sizes[0]);
+        ARIADNE_TEST_PRINT(sizes[1]);
+        ARIADNE_TEST_ASSERT(sizes[1] < sizes[0]);
+        ARIADNE_TEST_EQUALS(sizes[4], sizes[0]);
+
+        // Checkpoints 4 and 5 are kept, 4 being the full one of 5.
+        ARIADNE_TEST_EQUALS(_files(), 2);
+        DenseLayer* restored_input;
+        MSELossLayer* restored_loss;
+        Model r = _create_regressor_model(&restored_input, &restored_loss);
+        Checkpointer::restore(r, DIR / "model");
+        _test_same_params(m, r);
+
+        // A delta alone is not a model file.
+        ARIADNE_TEST_FAIL(r.load(DIR / "model.5"));
+    }
+
+    void test_delta_pages() {
+        std::filesystem::remove_all(DIR);
+        std::filesystem::create_directories(DIR);
+
+        // All the layers are trainable, but only a page of the wide one 
+        // changes between the checkpoints.
+        Model m{"wide"};
+        DenseLayer& wide = m.add_node<DenseLayer>("wide", Activation::ReLU, 
+            64, 64);
+        DenseLayer& output = m.add_node<DenseLayer>("output", 
+            Activation::Linear, 2, 64);
+        m.create_edge(output, wide);
+        m.init(SEED);
+        ARIADNE_TEST_ASSERT(wide.param_block_size() * sizeof(NumType) 
+            > 4 * ModelFormat::page_size);
+
+        std::vector<uintmax_t> sizes;
+        {
+            Checkpointer c{m, DIR / "model", 3, CheckpointMode::Delta, 4};
+            for (size_t i = 0; i < 3; ++i)
+            {
+                *wide.param(i * 64) += NumType{1};
+                c.checkpoint();
+                c.flush();
+                sizes.push_back(std::filesystem::file_size(c.last()));
+            }
+        }
+        ARIADNE_TEST_PRINT(sizes[0]);
+        ARIADNE_TEST_PRINT(sizes[1]);
+        ARIADNE_TEST_ASSERT(sizes[1] < sizes[0]);
+        ARIADNE_TEST_EQUALS(sizes[2], sizes[1]);
+
+        // The pages not stored by the deltas come from the full checkpoint.
+        Model r{"wide"};
+        DenseLayer& restored_wide = r.add_node<DenseLayer>("wide", 
+            Activation::ReLU, 64, 64);
+        DenseLayer& restored_output = r.add_node<DenseLayer>("output", 
+            Activation::Linear, 2, 64);
+        r.create_edge(restored_output, restored_wide);
+        ARIADNE_TEST_EQUAL(Checkpointer::restore(r, DIR / "model"), 
+            DIR / "model.2");
+        _test_same_params(m, r);
+
+        // A corrupted page is detected.
+        std::fstream file{DIR / "model.2", 
+            std::ios::binary | std::ios::in | std::ios::out};
+        file.seekp(static_cast<std::streamoff>(ModelFormat::page_size));
+        file.put('\x7f');
+        file.close();
+        ARIADNE_TEST_THROWS(Checkpointer::restore(r, DIR / "model"), 
+            std::runtime_error);
+    }
+
+    void test_resume() {
+        std::filesystem::remove_all(DIR);
+        std::filesystem::create_directories(DIR);
+
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = _create_regressor_model(&input_layer, &loss_layer);
+        m.init(SEED);
+        input_layer->set_trainable(false);
+        GDOptimizer o{NumType{0.1}};
+        {
+            Checkpointer c{m, DIR / "model", 2, CheckpointMode::Delta, 4};
+            for (size_t i = 0; i < 2; ++i)
+            {
+                _train(m, *loss_layer, o);
+                c.checkpoint();
+                c.flush();
+            }
+        }
+        ARIADNE_TEST_EQUALS(_files(), 2);
+
+        // A new run continues the sequence with a full checkpoint and 
+        // rotates out the checkpoints of the previous one.
+        {
+            Checkpointer c{m, DIR / "model", 2, CheckpointMode::Delta, 4};
+            for (size_t i = 0; i < 2; ++i)
+            {
+                _train(m, *loss_layer, o);
+                c.checkpoint();
+                c.flush();
+            }
+            ARIADNE_TEST_EQUAL(c.last(), DIR / "model.3");
+        }
+        ARIADNE_TEST_EQUALS(_files(), 2);
+        ARIADNE_TEST_ASSERT(!std::filesystem::exists(DIR / "model.0"));
+
+        // The first checkpoint of a run is a complete model file.
+        DenseLayer* restored_input;
+        MSELossLayer* restored_loss;
+        Model r = _create_regressor_model(&restored_input, &restored_loss);
+        ARIADNE_TEST_EXECUTE(r.load(DIR / "model.2"));
+        Checkpointer::restore(r, DIR / "model");
+        _test_same_params(m, r);
+    }
+
+    void _train(Model& m, MSELossLayer& loss_layer, GDOptimizer& o)
+    {
+        loss_layer.set_target(target.data());
+        m.forward(const_cast<NumType*>(input.data()));
+        m.reverse();
+        m.train(o);
+    }
+
+    void _test_same_params(Model& m, Model& r)
+    {
+        for (size_t i = 0; i < m.node_count(); ++i)
+        {
+            Layer& expected = m.node(i);
+            Layer& layer    = r.node(i);
+            for (size_t p = 0; p < expected.param_count(); ++p)
+            {
+                ARIADNE_TEST_EQUAL(*layer.param(p), *expected.param(p));
+            }
+        }
+    }
+
+    size_t _files()
+    {
+        auto it = std::filesystem::directory_iterator{DIR};
+        return static_cast<size_t>(std::distance(begin(it), end(it)));
+    }
+
+    Model _create_regressor_model(DenseLayer** first_layer,
+        MSELossLayer** loss_layer)
+    {
+        Model m{"regressor"};
+        *first_layer = &m.add_node<DenseLayer>("hidden",
+            Activation::ReLU, 8, 4);
+        DenseLayer& output_layer = m.add_node<DenseLayer>("output",
+            Activation::Linear, 2, 8);
+
+        *loss_layer = &m.add_node<MSELossLayer>("loss", 2, 1);
+        m.create_edge(output_layer, **first_layer);
+        m.create_edge(**loss_layer, output_layer);
+        return m;
+    }
+};
+
+int main() {
+    TestCheckpointer().test();
+    return ARIADNE_TEST_FAILURES;
+}
@@ -27,11 +27,13 @@
 #include "dnn/dlmath.hpp"
 #include "dnn/layer.hpp"
 #include "dnn/model.hpp"
+#include "dnn/scratch_arena.hpp"
 
 #include <vector>
 #include <iostream>
 #include <iomanip>
 #include <random>
+#include <cstdint>
 
 using namespace std;
 using namespace Ariadne;
@@ -43,6 +45,9 @@ public:
         ARIADNE_TEST_CALL(test_arr_sum());
         ARIADNE_TEST_CALL(test_arr_mul());
         ARIADNE_TEST_CALL(test_matarr_mul());
+        ARIADNE_TEST_CALL(test_matarr_mul_parallel());
+        ARIADNE_TEST_CALL(test_transposed_matarr_mul());
+        ARIADNE_TEST_CALL(test_outer_sum());
         ARIADNE_TEST_CALL(test_relu());
         ARIADNE_TEST_CALL(test_softmax());
         ARIADNE_TEST_CALL(test_relu_1());
@@ -52,6 +57,8 @@ public:
         ARIADNE_TEST_CALL(test_mean_squared_error());
         ARIADNE_TEST_CALL(test_mean_squared_error_1());
         ARIADNE_TEST_CALL(test_max_argmax());
+        ARIADNE_TEST_CALL(test_scratch_arena());
+        ARIADNE_TEST_CALL(test_tensor_view());
     }
 
 private:
@@ -126,6 +133,91 @@ private:
         }
     }
 
+    void test_matarr_mul_parallel() {
+        // Large enough to be split on the thread pool.
+        const size_t ROWS = 600, COLS = 300;
+        ThreadPool::configure(3);
+        std::vector<long> test_mat(ROWS * COLS);
+        std::vector<long> test_vec(COLS);
+        for (size_t i = 0; i < test_mat.size(); ++i)
+        {
+            test_mat[i] = static_cast<long>(i % 7) - 3;
+        }
+        for (size_t j = 0; j < COLS; ++j)
+        {
+            test_vec[j] = static_cast<long>(j % 5);
+        }
+
+        std::vector<long> res_vec(ROWS);
+        DLMath::matarr_mul<long>(res_vec.data(), test_mat.data(), 
+            test_vec.data(), ROWS, COLS);
+        size_t errors = 0;
+        for (size_t i = 0; i < ROWS; ++i)
+        {
+            long truth = 0;
+            for (size_t j = 0; j < COLS; ++j)
+            {
+                truth += test_mat[(i * COLS) + j] * test_vec[j];
+            }
+            errors += (res_vec[i] != truth);
+        }
+        ARIADNE_TEST_EQUALS(errors, 0);
+        ThreadPool::configure(0);
+    }
+
+    void test_transposed_matarr_mul() {
+        // Several column blocks, a partial one and rows beyond the unroll.
+        const size_t ROWS = 135;
+        const size_t COLS = 2 * DLMath::transposed_block_bytes / sizeof(long) 
+            + 37;
+        ThreadPool::configure(3);
+        std::vector<long> test_mat(ROWS * COLS);
+        std::vector<long> test_vec(ROWS);
+        for (size_t i = 0; i < test_mat.size(); ++i)
+        {
+            test_mat[i] = static_cast<long>(i % 7) - 3;
+        }
+        for (size_t i = 0; i < ROWS; ++i)
+        {
+            test_vec[i] = static_cast<long>(i % 5);
+        }
+
+        std::vector<long> res_vec(COLS, 1);
+        DLMath::transposed_matarr_mul<long>(res_vec.data(), test_mat.data(), 
+            test_vec.data(), ROWS, COLS);
+        size_t errors = 0;
+        for (size_t j = 0; j < COLS; ++j)
+        {
+            long truth = 0;
+            for (size_t i = 0; i < ROWS; ++i)
+            {
+                truth += test_mat[(i * COLS) + j] * test_vec[i];
+            }
+            errors += (res_vec[j] != truth);
+        }
+        ARIADNE_TEST_EQUALS(errors, 0);
+
+        // Layers 512 wide are split in a block for each thread, small ones 
+        // are computed in a single block.
+        size_t const block = DLMath::transposed_block<double>(512, 512);
+        ARIADNE_TEST_EQUALS((512 + block - 1) / block, 4);
+        ARIADNE_TEST_ASSERT(DLMath::transposed_block<double>(16, 512) >= 512);
+        ThreadPool::configure(0);
+    }
+
+    void test_outer_sum() {
+        std::vector<int> test_mat{1,1,1,1,1,1};
+        std::vector<int> test_row{1,2};
+        std::vector<int> test_col{1,2,3};
+        std::vector<int> truth_mat{2,3,4,3,5,7};
+        DLMath::outer_sum<int>(test_mat.data(), test_row.data(), 
+            test_col.data(), 2, 3);
+        for (size_t i = 0; i < truth_mat.size(); ++i)
+        {
+            ARIADNE_TEST_EQUAL(test_mat[i], truth_mat[i]);
+        }
+    }
+
     void test_relu() {
         std::vector<NumType> test_vec{-2,-1,0,1,2};
         std::vector<NumType> truth_vec{0,0,0,1,2};
@@ -263,6 +355,80 @@ private:
         ARIADNE_TEST_EQUAL(std::get<0>(ret_tuple), truth_max);
         ARIADNE_TEST_EQUAL(std::get<1>(ret_tuple), truth_argmax);
     }
+
+    void test_scratch_arena() {
+        ScratchArena arena;
+        auto* a = arena.allocate<char>(1);
+        auto* b = arena.allocate<NumType>(3);
+        ARIADNE_TEST_EQUALS(reinterpret_cast<uintptr_t>(a) 
+            % ScratchArena::alignment, 0);
+        ARIADNE_TEST_EQUALS(b - reinterpret_cast<NumType*>(a), 
+            ScratchArena::alignment / sizeof(NumType));
+
+        // Released memory is handed out again.
+        auto marker = arena.mark();
+        auto* c = arena.allocate<NumType>(4);
+        arena.release(marker);
+        ARIADNE_TEST_EQUALS(arena.allocate<NumType>(4), c);
+
+        // Spilling to a new block keeps the earlier allocations, and a 
+        // reset merges the blocks.
+        b[0] = 1.0;
+        arena.allocate<char>(ScratchArena::min_block_size);
+        ARIADNE_TEST_EQUALS(b[0], 1.0);
+        ARIADNE_TEST_ASSERT(arena.capacity() > ScratchArena::min_block_size);
+        size_t capacity = arena.capacity();
+        arena.reset();
+        ARIADNE_TEST_EQUALS(arena.used(), 0);
+        ARIADNE_TEST_EQUALS(arena.capacity(), capacity);
+        arena.allocate<char>(capacity);
+        ARIADNE_TEST_EQUALS(arena.capacity(), capacity);
+
+        {
+            ScratchScope scope;
+            scope.allocate<NumType>(16);
+            ARIADNE_TEST_ASSERT(ScratchArena::local().used() > 0);
+        }
+        ARIADNE_TEST_EQUALS(ScratchArena::local().used(), 0);
+    }
+
+    void test_tensor_view() {
+        // A 2x3 matrix stored with a row stride of 4.
+        std::vector<NumType> buffer{1.0, 2.0, 3.0, 0.0, 4.0, 5.0, 6.0, 0.0};
+        ConstTensorView padded{buffer.data(), 2, 3, 4};
+        ConstTensorView packed{buffer.data(), 1, 3, 4};
+        ARIADNE_TEST_ASSERT(!padded.contiguous());
+        ARIADNE_TEST_ASSERT(packed.contiguous());
+        ARIADNE_TEST_EQUALS(padded.size(), 6);
+        ARIADNE_TEST_EQUALS(padded(1, 2), 6.0);
+        ARIADNE_TEST_ASSERT(padded.dtype == DType::Float64);
+
+        // Every other value of the buffer.
+        std::vector<NumType> x{1.0, -1.0, 2.0, -1.0, 3.0, -1.0};
+        ConstTensorView strided{x.data(), 3, 2};
+        ARIADNE_TEST_ASSERT(!strided.contiguous());
+        ARIADNE_TEST_EQUALS(strided[2], 3.0);
+
+        std::vector<NumType> y(2);
+        TensorView out{y.data(), y.size()};
+        DLMath::matarr_mul<NumType>(out, padded, strided);
+        ARIADNE_TEST_EQUALS(y[0], 14.0);
+        ARIADNE_TEST_EQUALS(y[1], 32.0);
+        ConstTensorView column{buffer.data(), 2, 4};
+        DLMath::arr_sum<NumType>(out, out, column);
+        ARIADNE_TEST_EQUALS(y[1], 36.0);
+        ARIADNE_TEST_EQUALS(padded.row(1)[0], 4.0);
+
+        ScratchScope scratch;
+        NumType const* packed_x = DLMath::contiguous(strided, scratch);
+        ARIADNE_TEST_EQUALS(packed_x[1], 2.0);
+        ARIADNE_TEST_EQUALS(DLMath::contiguous(packed, scratch), 
+            buffer.data());
+
+        TensorView short_out{y.data(), 1};
+        ARIADNE_TEST_FAIL(DLMath::matarr_mul<NumType>(short_out, padded, 
+            strided));
+    }
 };
 
 int main() {
@@ -0,0 +1,78 @@
+/***************************************************************************
+ *            test_export.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "test.hpp"
+#include "exported_model.hpp"
+
+// Generated at build time by export_model.
+#include "exported.hpp"
+
+#include <vector>
+
+using namespace std;
+using namespace Ariadne;
+
+class TestExport {
+public:
+    void test() {
+        ARIADNE_TEST_CALL(test_sizes());
+        ARIADNE_TEST_CALL(test_forward());
+    }
+
+private:
+    void test_sizes() {
+        ARIADNE_TEST_EQUALS(exported::input_size, 4);
+        ARIADNE_TEST_EQUALS(exported::output_size, 3);
+    }
+
+    void test_forward() {
+        Model m{"exported"};
+        build_exported_model(m);
+
+        const std::vector<std::vector<NumType>> inputs = {
+            {10.0, 1.0, 10.0, 1.0},
+            {1.0,  3.0, 8.0,  3.0},
+            {-2.0, 0.5, 0.0,  4.0},
+            {0.0,  0.0, 0.0,  0.0},
+        };
+
+        // Same operations in the same order: bitwise identical outputs.
+        for (auto input: inputs)
+        {
+            NumType* expected = m.predict(input.data());
+            exported::value_type output[exported::output_size];
+            exported::forward(input.data(), output);
+            for (size_t i = 0; i < exported::output_size; ++i)
+            {
+                ARIADNE_TEST_EQUAL(output[i], expected[i]);
+            }
+        }
+    }
+};
+
+int main() {
+    TestExport().test();
+    return ARIADNE_TEST_FAILURES;
+}
@@ -23,14 +23,27 @@
  */
 
 #include "test.hpp"
+#include "dnn/aligned_allocator.hpp"
 #include "dnn/layer.hpp"
 #include "dnn/model.hpp"
 #include "dnn/dense.hpp"
 #include "dnn/cce_loss.hpp"
 #include "dnn/mse_loss.hpp"
 #include "dnn/gd_optimizer.hpp"
-
+#include "dnn/static_model.hpp"
+#include "dnn/quantized_dense.hpp"
+#include "dnn/thread_pool.hpp"
+#include "dnn/tracer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <filesystem>
+#include <random>
+#include <sstream>
+#include <thread>
 
 using namespace std;
 using namespace Ariadne;
@@ -38,15 +51,33 @@ using namespace Ariadne;
 class TestModel {
 public:
     void test() {
+        std::filesystem::create_directories(DIR);
         ARIADNE_TEST_CALL(test_classifier_model());
         ARIADNE_TEST_CALL(test_classifier_model_predict());
         ARIADNE_TEST_CALL(test_regressor_model());
         ARIADNE_TEST_CALL(test_regressor_model_predict());
+        ARIADNE_TEST_CALL(test_dag_model());
+        ARIADNE_TEST_CALL(test_cyclic_model());
+        ARIADNE_TEST_CALL(test_memory_plan());
+        ARIADNE_TEST_CALL(test_inference_mode());
+        ARIADNE_TEST_CALL(test_frozen_layer());
+        ARIADNE_TEST_CALL(test_model_file());
+        ARIADNE_TEST_CALL(test_static_model());
+        ARIADNE_TEST_CALL(test_quantized_model());
+        ARIADNE_TEST_CALL(test_profiler());
+        ARIADNE_TEST_CALL(test_tracer());
+        ARIADNE_TEST_CALL(test_tracer_restart());
+        ARIADNE_TEST_CALL(test_alignment());
+        ARIADNE_TEST_CALL(test_layer_views());
+        std::filesystem::remove_all(DIR);
     }
 
 private:
     const size_t BATCH_SIZE = 2;
     const size_t EPOCHS     = 50;
+    /// \brief Directory of the model files written by the tests.
+    const std::filesystem::path DIR = 
+        std::filesystem::temp_directory_path() / "ariadne_test_model";
 
     void test_classifier_model() {
         // Input definition.
@@ -88,8 +119,8 @@ private:
                     input = inputs[i].data();
                     target = targets[i].data();
                     loss_layer->set_target(target);
-                    input_layer->forward(input);
-                    loss_layer->reverse();
+                    m.forward(input);
+                    m.reverse();
                 }
 
                 std::printf("Step %zu - ", i);
@@ -104,7 +135,7 @@ private:
         m.print();
 
         std::ofstream params_file{
-            std::filesystem::path{"classifier.weight"}, 
+            DIR / "classifier.weight", 
             std::ios::binary};
         m.save(params_file);
     }
@@ -117,7 +148,7 @@ private:
             &loss_layer);
 
         std::ifstream params_file{
-            std::filesystem::path{"classifier.weight"}, 
+            DIR / "classifier.weight", 
             std::ios::binary};
         m.load(params_file);
     }
@@ -162,8 +193,8 @@ private:
                     input = inputs[i].data();
                     target = targets[i].data();
                     loss_layer->set_target(target);
-                    input_layer->forward(input);
-                    loss_layer->reverse();
+                    m.forward(input);
+                    m.reverse();
                 }
 
                 std::printf("Step %zu - ", i);
@@ -178,7 +209,7 @@ private:
         m.print();
 
         std::ofstream params_file{
-            std::filesystem::path{"regressor.weight"}, 
+            DIR / "regressor.weight", 
             std::ios::binary};
         m.save(params_file);
     }
@@ -191,11 +222,638 @@ private:
             &loss_layer);
 
         std::ifstream params_file{
-            std::filesystem::path{"regressor.weight"}, 
+            DIR / "regressor.weight", 
             std::ios::binary};
         m.load(params_file);
     }
 
+    void test_dag_model() {
+        // A fans out to B and C, that fan in to D.
+        Model m{"dag"};
+        auto& a = m.add_node<DenseLayer>("a", Activation::ReLU, 3, 4);
+        auto& b = m.add_node<DenseLayer>("b", Activation::Linear, 2, 3);
+        auto& c = m.add_node<DenseLayer>("c", Activation::Linear, 2, 3);
+        auto& d = m.add_node<DenseLayer>("d", Activation::Linear, 2, 2);
+        auto& loss = m.add_node<MSELossLayer>("loss", 2, 1);
+        m.create_edge(b, a);
+        m.create_edge(c, a);
+        m.create_edge(d, b);
+        m.create_edge(d, c);
+        m.create_edge(loss, d);
+        m.init(1);
+
+        std::vector<NumType> input{1.0, -2.0, 0.5, 3.0};
+        std::vector<NumType> target{0.5, -1.0};
+        loss.set_target(target.data());
+        m.forward(input.data());
+
+        // The input of d is the sum of the outputs of b and c.
+        std::vector<NumType> d_in(2), d_out(2);
+        for (size_t i = 0; i < 2; ++i)
+        {
+            d_in[i] = b.output()[i] + c.output()[i];
+        }
+        for (size_t i = 0; i < 2; ++i)
+        {
+            d_out[i] = d.biases()[i]
+                + *d.param(i * 2) * d_in[0] + *d.param(i * 2 + 1) * d_in[1];
+            ARIADNE_TEST_WITHIN(d.output()[i], d_out[i], 1e-12);
+        }
+
+        // The gradients of a accumulate the contributions of b and c.
+        m.reverse();
+        auto sum_squared_error = [&]() {
+            m.forward(input.data());
+            NumType ret{0.0};
+            for (size_t i = 0; i < 2; ++i)
+            {
+                ret += (target[i] - d.output()[i]) * (target[i] - d.output()[i]);
+            }
+            return ret;
+        };
+        const NumType h = 1e-6;
+        for (size_t i = 0; i < a.param_count(); ++i)
+        {
+            NumType p = *a.param(i);
+            *a.param(i) = p + h;
+            NumType loss_plus = sum_squared_error();
+            *a.param(i) = p - h;
+            NumType loss_minus = sum_squared_error();
+            *a.param(i) = p;
+            ARIADNE_TEST_WITHIN(*a.gradient(i),
+                (loss_plus - loss_minus) / (2 * h), 1e-5);
+        }
+    }
+
+    void test_cyclic_model() {
+        Model m{"cyclic"};
+        auto& a = m.add_node<DenseLayer>("a", Activation::ReLU, 3, 3);
+        auto& b = m.add_node<DenseLayer>("b", Activation::ReLU, 3, 3);
+        m.create_edge(b, a);
+        m.create_edge(a, b);
+        ARIADNE_TEST_FAIL(m.compile());
+    }
+
+    void test_memory_plan() {
+        const size_t DEPTH = 6;
+        const uint16_t WIDTH = 32;
+        Model m{"deep"};
+        std::vector<DenseLayer*> layers;
+        for (size_t i = 0; i < DEPTH; ++i)
+        {
+            layers.push_back(&m.add_node<DenseLayer>("dense" + to_string(i), 
+                Activation::ReLU, WIDTH, WIDTH));
+            if (i > 0)
+            {
+                m.create_edge(*layers[i], *layers[i - 1]);
+            }
+        }
+        auto& loss = m.add_node<MSELossLayer>("loss", WIDTH, 1);
+        m.create_edge(loss, *layers.back());
+        m.init(1);
+
+        std::vector<NumType> input(WIDTH, NumType{0.5});
+        std::vector<NumType> target(WIDTH, NumType{1.0});
+
+        // Inference keeps only two activations alive at a time.
+        NumType* output = m.predict(input.data());
+        std::vector<NumType> predicted(output, output + WIDTH);
+        ARIADNE_TEST_PRINT(m.arena_size());
+        ARIADNE_TEST_EQUALS(m.arena_size(), 2 * WIDTH);
+
+        // Training reuses the gradient buffers across layers.
+        loss.set_target(target.data());
+        m.forward(input.data());
+        for (size_t i = 0; i < WIDTH; ++i)
+        {
+            ARIADNE_TEST_EQUAL(layers.back()->output()[i], predicted[i]);
+        }
+        m.reverse();
+        size_t owned = DEPTH * 3 * WIDTH + WIDTH;
+        ARIADNE_TEST_PRINT(m.arena_size());
+        ARIADNE_TEST_ASSERT(m.arena_size() < owned / 2);
+
+        // Switching back to inference does not reallocate.
+        NumType* arena_output = m.predict(input.data());
+        ARIADNE_TEST_ASSERT(m.arena_size() < owned / 2);
+        for (size_t i = 0; i < WIDTH; ++i)
+        {
+            ARIADNE_TEST_EQUAL(arena_output[i], predicted[i]);
+        }
+    }
+
+    void test_inference_mode() {
+        std::vector<NumType> input{10.0, 1.0, 10.0, 1.0};
+
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        m.init(1);
+        NumType* output = m.predict(input.data());
+        std::vector<NumType> expected(output, output + 2);
+
+        // Layers added to an inference model have no gradients.
+        Model f{"frozen", ModelMode::Inference};
+        auto& hidden = f.add_node<DenseLayer>("hidden", Activation::ReLU, 
+            8, 4);
+        auto& out = f.add_node<DenseLayer>("output", Activation::Linear, 2, 8);
+        f.create_edge(out, hidden);
+        ARIADNE_TEST_ASSERT(hidden.gradient(0) == nullptr);
+        for (size_t i = 0; i < f.node_count(); ++i)
+        {
+            Layer& layer = m.node(i);
+            std::copy_n(layer.param(0), layer.param_block_size(), 
+                f.node(i).param(0));
+        }
+        output = f.predict(input.data());
+        ARIADNE_TEST_EQUAL(output[0], expected[0]);
+        ARIADNE_TEST_EQUAL(output[1], expected[1]);
+        ARIADNE_TEST_FAIL(f.forward(input.data()));
+
+        // Freezing drops the training state of an existing model.
+        std::vector<NumType> target{1.0, 0.0};
+        loss_layer->set_target(target.data());
+        m.forward(input.data());
+        m.reverse();
+        size_t training = _planned_bytes(m);
+        m.freeze();
+        ARIADNE_TEST_ASSERT(m.mode() == ModelMode::Inference);
+        ARIADNE_TEST_ASSERT(input_layer->gradient(0) == nullptr);
+        output = m.predict(input.data());
+        ARIADNE_TEST_EQUAL(output[0], expected[0]);
+        ARIADNE_TEST_EQUAL(output[1], expected[1]);
+        ARIADNE_TEST_EQUALS(m.arena_size(), f.arena_size());
+        ARIADNE_TEST_FAIL(m.reverse());
+
+        // Inference plans less than half the memory of training.
+        size_t inference = _planned_bytes(m);
+        ARIADNE_TEST_PRINT(training);
+        ARIADNE_TEST_PRINT(inference);
+        ARIADNE_TEST_ASSERT(inference < training / 2);
+    }
+
+    void test_frozen_layer() {
+        std::vector<NumType> input{10.0, 1.0, 10.0, 1.0};
+        std::vector<NumType> target{1.0, 0.0};
+        GDOptimizer o{NumType{0.1}};
+
+        DenseLayer* ref_input;
+        MSELossLayer* ref_loss;
+        Model ref = TestModel::_create_regressor_model(&ref_input, &ref_loss);
+        ref.init(1);
+
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        m.init(1);
+        input_layer->set_trainable(false);
+        std::vector<NumType> frozen(input_layer->param(0), 
+            input_layer->param(0) + input_layer->param_block_size());
+
+        ref_loss->set_target(target.data());
+        ref.forward(input.data());
+        ref.reverse();
+        loss_layer->set_target(target.data());
+        m.forward(input.data());
+        m.reverse();
+
+        // The head gets the same gradients, the frozen layer none.
+        Layer& ref_head = ref.node(1);
+        Layer& head = m.node(1);
+        for (size_t i = 0; i < head.param_count(); ++i)
+        {
+            ARIADNE_TEST_EQUAL(*head.gradient(i), *ref_head.gradient(i));
+        }
+        for (size_t i = 0; i < input_layer->param_count(); ++i)
+        {
+            ARIADNE_TEST_EQUAL(*input_layer->gradient(i), NumType{0.0});
+        }
+
+        m.train(o);
+        ARIADNE_TEST_ASSERT(std::equal(frozen.begin(), frozen.end(), 
+            input_layer->param(0)));
+        ARIADNE_TEST_ASSERT(!std::equal(head.param(0), 
+            head.param(0) + head.param_block_size(), ref_head.param(0)));
+    }
+
+    void test_model_file() {
+        std::vector<NumType> input{10.0, 1.0, 10.0, 1.0};
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        m.init(1);
+        NumType* output = m.predict(input.data());
+        std::vector<NumType> expected(output, output + 2);
+        {
+            std::ofstream out{DIR / "format.weight", std::ios::binary};
+            m.save(out);
+        }
+
+        // Copy from a stream.
+        Model copied = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        std::ifstream in{DIR / "format.weight", std::ios::binary};
+        copied.load(in);
+        output = copied.predict(input.data());
+        ARIADNE_TEST_EQUAL(output[0], expected[0]);
+        ARIADNE_TEST_EQUAL(output[1], expected[1]);
+
+        // Parameters used in place from the mapped pages.
+        Model mapped = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        mapped.load(DIR / "format.weight", true);
+        auto address = reinterpret_cast<uintptr_t>(input_layer->param(0));
+        ARIADNE_TEST_EQUALS(address % ModelFormat::alignment, 0);
+        output = mapped.predict(input.data());
+        ARIADNE_TEST_EQUAL(output[0], expected[0]);
+        ARIADNE_TEST_EQUAL(output[1], expected[1]);
+
+        // Another topology fails loudly.
+        CCELossLayer* cce_layer;
+        Model other = TestModel::_create_binary_classifier_model(&input_layer,
+            &cce_layer);
+        ARIADNE_TEST_FAIL(other.load(DIR / "format.weight"));
+
+        // Corrupted parameters and headers are detected.
+        auto const file         = DIR / "format.weight";
+        auto const corrupt_file = DIR / "corrupt.weight";
+        std::vector<char> bytes(std::filesystem::file_size(file));
+        std::ifstream{file, std::ios::binary}.read(bytes.data(), 
+            static_cast<std::streamsize>(bytes.size()));
+        bytes[ModelFormat::alignment] ^= 1;
+        std::ofstream{corrupt_file, std::ios::binary}.write(bytes.data(), 
+            static_cast<std::streamsize>(bytes.size()));
+        std::ifstream corrupt{DIR / "corrupt.weight", std::ios::binary};
+        ARIADNE_TEST_FAIL(copied.load(corrupt));
+        ARIADNE_TEST_FAIL(copied.load(DIR / "corrupt.weight", 
+            true));
+
+        bytes[ModelFormat::alignment] ^= 1;
+        bytes[12] ^= 1;
+        std::ofstream{corrupt_file, std::ios::binary}.write(bytes.data(), 
+            static_cast<std::streamsize>(bytes.size()));
+        ARIADNE_TEST_FAIL(copied.load(DIR / "corrupt.weight"));
+
+        // Record counts are bounded before the allocation and short reads 
+        // are detected.
+        bytes[12] ^= 1;
+        std::vector<char> huge = bytes;
+        uint64_t count = uint64_t{1} << 60;
+        std::memcpy(huge.data() + offsetof(ModelFormat::Header, layer_count), 
+            &count, sizeof(count));
+        std::stringstream huge_stream{std::string{huge.begin(), huge.end()}};
+        ARIADNE_TEST_THROWS(copied.load(huge_stream), std::runtime_error);
+        std::stringstream short_stream{std::string{bytes.begin(), 
+            bytes.begin() + sizeof(ModelFormat::Header) + 8}};
+        ARIADNE_TEST_THROWS(copied.load(short_stream), std::runtime_error);
+    }
+
+    void test_static_model() {
+        using Classifier = StaticSequential<
+            StaticDense<4, 8, Activation::ReLU>,
+            StaticDense<8, 2, Activation::Softmax>>;
+        std::array<NumType, 4> input{10.0, 1.0, 10.0, 1.0};
+
+        // Same seed, same parameters and same outputs of the runtime model.
+        DenseLayer* input_layer;
+        CCELossLayer* loss_layer;
+        Model m = TestModel::_create_binary_classifier_model(&input_layer, 
+            &loss_layer);
+        m.init(1);
+        Classifier s;
+        s.init(1);
+        NumType* output = m.predict(input.data());
+        auto const& static_output = s.forward(input);
+        ARIADNE_TEST_EQUAL(static_output[0], output[0]);
+        ARIADNE_TEST_EQUAL(static_output[1], output[1]);
+
+        // The model files are interchangeable, the loss layer is skipped.
+        {
+            std::ofstream out{DIR / "static.weight", std::ios::binary};
+            s.layer<0>().params()[0] += 1.0;
+            s.save(out);
+        }
+        std::ifstream in{DIR / "static.weight", std::ios::binary};
+        m.load(in);
+        output = m.predict(input.data());
+        s.forward(input);
+        ARIADNE_TEST_EQUAL(static_output[0], output[0]);
+        ARIADNE_TEST_EQUAL(static_output[1], output[1]);
+
+        Classifier loaded;
+        {
+            std::ofstream out{DIR / "format.weight", std::ios::binary};
+            m.save(out);
+        }
+        std::ifstream model_in{DIR / "format.weight", std::ios::binary};
+        loaded.load(model_in);
+        ARIADNE_TEST_ASSERT(loaded.layer<0>().params() 
+            == s.layer<0>().params());
+        ARIADNE_TEST_ASSERT(loaded.layer<1>().params() 
+            == s.layer<1>().params());
+
+        // Another topology fails loudly.
+        StaticSequential<StaticDense<4, 8, Activation::ReLU>> other;
+        std::ifstream other_in{DIR / "format.weight", std::ios::binary};
+        ARIADNE_TEST_FAIL(other.load(other_in));
+    }
+
+    void test_quantized_model() {
+        std::mt19937 rne{1};
+        std::uniform_int_distribution<int> value{-127, 127};
+
+        // Every kernel computes the exact int32 products.
+        const size_t ROWS = 7, STRIDE = 3 * Int8Math::row_alignment;
+        std::vector<int8_t> weights(ROWS * STRIDE), inputs(STRIDE);
+        for (auto& w: weights) { w = static_cast<int8_t>(value(rne)); }
+        for (auto& x: inputs) { x = static_cast<int8_t>(value(rne)); }
+        std::vector<int32_t> expected(ROWS), sums(ROWS);
+        Int8Math::matvec(expected.data(), weights.data(), inputs.data(), 
+            ROWS, STRIDE, Int8Kernel::Scalar);
+        for (auto kernel: {Int8Kernel::AVX2, Int8Kernel::AVX512VNNI})
+        {
+            ARIADNE_TEST_PRINT(Int8Math::name(kernel));
+            if (!Int8Math::supported(kernel))
+            {
+                continue;
+            }
+            Int8Math::matvec(sums.data(), weights.data(), inputs.data(), 
+                ROWS, STRIDE, kernel);
+            ARIADNE_TEST_ASSERT(sums == expected);
+        }
+
+        // The quantized model follows the floating point one closely.
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        m.init(1);
+        std::uniform_real_distribution<NumType> feature{0.0, 10.0};
+        std::vector<std::vector<NumType>> calibration(64);
+        for (auto& x: calibration)
+        {
+            for (size_t j = 0; j < 4; ++j)
+            {
+                x.push_back(feature(rne));
+            }
+        }
+        auto q = QuantizedDenseLayer::quantize(m, calibration);
+        auto& q_input = dynamic_cast<QuantizedDenseLayer&>(q->node(0));
+        ARIADNE_TEST_ASSERT(!q_input.calibrating());
+        ARIADNE_TEST_EQUALS(q_input.type(), "int8.dense.relu");
+
+        NumType max_error = 0.0, max_output = 0.0;
+        for (auto& x: calibration)
+        {
+            NumType* expected_output = m.predict(x.data());
+            std::vector<NumType> fp(expected_output, expected_output + 2);
+            NumType* output = q->predict(x.data());
+            for (size_t i = 0; i < fp.size(); ++i)
+            {
+                max_error = std::max(max_error, std::abs(output[i] - fp[i]));
+                max_output = std::max(max_output, std::abs(fp[i]));
+            }
+        }
+        ARIADNE_TEST_PRINT(max_error);
+        ARIADNE_TEST_PRINT(max_output);
+        ARIADNE_TEST_ASSERT(max_error < 0.02 * max_output);
+        ARIADNE_TEST_FAIL(q->forward(calibration[0].data()));
+        ARIADNE_TEST_FAIL(QuantizedDenseLayer::quantize(m, {}));
+    }
+
+    void test_profiler() {
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        GDOptimizer o{NumType{0.1}};
+        Model m = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        m.init(1);
+
+        std::vector<NumType> input{1.0, 2.0, 3.0, 4.0}, target{1.0, 0.0};
+        loss_layer->set_target(target.data());
+        m.forward(input.data());
+        m.reverse();
+        m.train(o);
+
+        // Counters are optional, the times are measured anyway.
+        bool counters = m.enable_perf_counters();
+        ARIADNE_TEST_PRINT(counters);
+        m.forward(input.data());
+        m.reverse();
+        m.forward(input.data());
+        m.reverse();
+
+        std::stringstream report;
+        m.print_profile(report);
+        ARIADNE_TEST_PRINT(report.str());
+
+        auto const& entries = m.profiler().entries();
+#if ENABLE_PROFILING
+        // Forward, reverse and optimizer of the 3 layers.
+        ARIADNE_TEST_EQUAL(entries.size(), 9);
+        for (auto& e: entries)
+        {
+            ARIADNE_TEST_EQUAL(e.calls, e.phase == Phase::Optimizer ? 1 : 3);
+        }
+        ARIADNE_TEST_EQUALS(entries.front().layer, "hidden");
+        ARIADNE_TEST_ASSERT(entries.front().phase == Phase::Forward);
+        // 4 x 8 multiply-adds, bias and activation.
+        ARIADNE_TEST_EQUAL(entries.front().cost.flops, 80.0);
+        ARIADNE_TEST_ASSERT(report.str().find("optimizer") 
+            != std::string::npos);
+        ARIADNE_TEST_EQUAL(report.str().find("IPC") != std::string::npos, 
+            counters);
+#else
+        ARIADNE_TEST_ASSERT(!counters);
+        ARIADNE_TEST_ASSERT(entries.empty());
+        ARIADNE_TEST_ASSERT(report.str().find("disabled") 
+            != std::string::npos);
+#endif
+        m.reset_profile();
+        ARIADNE_TEST_ASSERT(m.profiler().entries().empty());
+    }
+
+    void test_tracer() {
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        m.init(1);
+        std::vector<NumType> input{1.0, 2.0, 3.0, 4.0}, target{1.0, 0.0};
+        loss_layer->set_target(target.data());
+
+        Tracer::start();
+        m.forward(input.data());
+        m.reverse();
+        std::thread worker{[]()
+        {
+            auto now = Tracer::Clock::now();
+            Tracer::record("test", "worker \"span\"", now, now);
+        }};
+        worker.join();
+        Tracer::stop();
+        m.forward(input.data());
+
+        std::stringstream trace;
+        Tracer::write(trace);
+        ARIADNE_TEST_PRINT(trace.str());
+        ARIADNE_TEST_ASSERT(trace.str().rfind(
+            "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+        ARIADNE_TEST_ASSERT(trace.str().find("worker \\\"span\\\"") 
+            != std::string::npos);
+#if ENABLE_PROFILING
+        // Forward and reverse of the 3 layers and the worker span.
+        ARIADNE_TEST_EQUAL(Tracer::size(), 7);
+        ARIADNE_TEST_ASSERT(trace.str().find("{\"name\":\"hidden\","
+            "\"cat\":\"forward\",\"ph\":\"X\"") != std::string::npos);
+#else
+        ARIADNE_TEST_EQUAL(Tracer::size(), 1);
+#endif
+    }
+
+    void test_tracer_restart() {
+        // Tracing restarts while the threads of a pool record.
+        auto spans = [](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; ++i)
+            {
+                auto now = Tracer::Clock::now();
+                Tracer::record("test", "pool span", now, now);
+            }
+        };
+        ThreadPool::configure(3);
+        Tracer::start();
+        std::atomic<bool> done{false};
+        std::thread driver{[&done, &spans]()
+        {
+            while (!done.load())
+            {
+                ThreadPool::global().parallel_for(0, 256, 1, spans);
+            }
+        }};
+        for (size_t i = 0; i < 200; ++i)
+        {
+            Tracer::start();
+            std::stringstream trace;
+            Tracer::write(trace);
+        }
+        done.store(true);
+        driver.join();
+
+        // Only the spans since the last start are kept, the buffers of the 
+        // pool threads are reused.
+        Tracer::start();
+        ThreadPool::global().parallel_for(0, 64, 1, spans);
+        Tracer::stop();
+        ARIADNE_TEST_EQUAL(Tracer::size(), 64);
+        ThreadPool::configure(0);
+    }
+
+    void test_alignment() {
+        auto aligned = [](void const* p, size_t alignment)
+        {
+            return p == nullptr 
+                || reinterpret_cast<uintptr_t>(p) % alignment == 0;
+        };
+
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        m.init(1);
+        std::vector<NumType> input{1.0, 2.0, 3.0, 4.0}, target{1.0, 0.0};
+        loss_layer->set_target(target.data());
+        m.forward(input.data());
+        m.reverse();
+
+        size_t const line = AlignedStorage::alignment;
+        for (size_t i = 0; i < m.node_count(); ++i)
+        {
+            auto& layer = m.node(i);
+            ARIADNE_TEST_ASSERT(aligned(layer.output(), line));
+            ARIADNE_TEST_ASSERT(aligned(layer.input_gradient(), line));
+            if (layer.param_count() > 0)
+            {
+                ARIADNE_TEST_ASSERT(aligned(layer.param(0), line));
+                ARIADNE_TEST_ASSERT(aligned(layer.gradient(0), line));
+            }
+        }
+
+        // Biases start on a cache line also after weights that do not 
+        // fill one, and the padding never changes.
+        Model odd{"odd"};
+        DenseLayer& dense = odd.add_node<DenseLayer>("dense", 
+            Activation::ReLU, 3, 5);
+        MSELossLayer& odd_loss = odd.add_node<MSELossLayer>("loss", 3, 1);
+        odd.create_edge(odd_loss, dense);
+        odd.init(1);
+        std::vector<NumType> odd_input{1.0, 2.0, 3.0, 4.0, 5.0};
+        std::vector<NumType> odd_target{1.0, 0.0, 1.0};
+        odd_loss.set_target(odd_target.data());
+        odd.forward(odd_input.data());
+        odd.reverse();
+
+        // Parameter indices skip the padding, param_count() does not 
+        // count it.
+        size_t const bias_offset = DenseLayer::bias_offset(3, 5);
+        ARIADNE_TEST_ASSERT(bias_offset >= 3 * 5);
+        ARIADNE_TEST_EQUALS(dense.param_count(), (5 + 1) * 3);
+        ARIADNE_TEST_EQUALS(dense.param_block_size(), 
+            DenseLayer::param_block_size(3, 5));
+        ARIADNE_TEST_EQUAL(dense.biases(), dense.param(3 * 5));
+        ARIADNE_TEST_EQUAL(dense.biases(), dense.param(0) + bias_offset);
+        ARIADNE_TEST_ASSERT(aligned(dense.biases(), line));
+        ARIADNE_TEST_ASSERT(aligned(dense.gradient(3 * 5), line));
+        ARIADNE_TEST_EQUALS(
+            dense.param_block_size() * sizeof(NumType) % line, 0);
+
+        GDOptimizer o{NumType{0.1}};
+        odd.train(o);
+        NumType const* params = dense.param(0);
+        for (size_t i = 3 * 5; i < bias_offset; ++i)
+        {
+            ARIADNE_TEST_EQUALS(params[i], 0.0);
+        }
+        for (size_t i = bias_offset + 3; i < dense.param_block_size(); ++i)
+        {
+            ARIADNE_TEST_EQUALS(params[i], 0.0);
+        }
+
+        // Large blocks start on a huge page.
+        AlignedStorage::use_huge_pages(true);
+        size_t const size = AlignedStorage::huge_page_size;
+        void* block = AlignedStorage::allocate(size);
+        ARIADNE_TEST_ASSERT(aligned(block, size));
+        AlignedStorage::deallocate(block, size);
+        AlignedStorage::use_huge_pages(false);
+    }
+
+    void test_layer_views() {
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        Model m = TestModel::_create_regressor_model(&input_layer, 
+            &loss_layer);
+        m.init(1);
+        std::vector<NumType> input{1.0, 2.0, 3.0, 4.0}, target{1.0, 0.0};
+        loss_layer->set_target(target.data());
+        m.forward(input.data());
+        std::vector<NumType> expected(input_layer->output(), 
+            input_layer->output() + input_layer->output_size());
+
+        // Inputs interleaved with padding give the same outputs.
+        std::vector<NumType> strided{1.0, 0.0, 2.0, 0.0, 3.0, 0.0, 4.0, 0.0};
+        input_layer->forward(ConstTensorView{strided.data(), 4, 2});
+        ARIADNE_TEST_ASSERT(std::equal(expected.begin(), expected.end(), 
+            input_layer->output()));
+
+        ConstTensorView short_input{input.data(), 3};
+        ARIADNE_TEST_FAIL(input_layer->forward(short_input));
+        ARIADNE_TEST_FAIL(loss_layer->forward(short_input));
+    }
+
     Model _create_binary_classifier_model(DenseLayer** first_layer, 
         CCELossLayer** loss_layer)
     {
@@ -225,6 +883,25 @@ private:
         m.create_edge(**loss_layer, output_layer);
         return m;
     }
+
+    /**
+     * \brief Bytes planned for the training state of a model: the arena, 
+     * the parameter gradients and the optimizer state, that GDOptimizer 
+     * does not have.
+     */
+    size_t _planned_bytes(Model& m)
+    {
+        size_t values = m.arena_size();
+        for (size_t i = 0; i < m.node_count(); ++i)
+        {
+            Layer& layer = m.node(i);
+            if (layer.gradient(0) != nullptr)
+            {
+                values += layer.param_block_size();
+            }
+        }
+        return values * sizeof(NumType);
+    }
 };
 
 int main() {
@@ -0,0 +1,388 @@
+/***************************************************************************
+ *            test_trainer.cpp
+ *
+ *  Copyright  2021  Mirco De Marchi
+ *
+ ****************************************************************************/
+
+/*
+ *  This file is part of Ariadne.
+ *
+ *  Ariadne is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ariadne is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ariadne.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.hpp"
+#include "dnn/layer.hpp"
+#include "dnn/model.hpp"
+#include "dnn/dense.hpp"
+#include "dnn/mse_loss.hpp"
+#include "dnn/gd_optimizer.hpp"
+#include "dnn/trainer.hpp"
+#include "dnn/parallel_trainer.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+using namespace Ariadne;
+
+class TestTrainer {
+public:
+    void test() {
+        ARIADNE_TEST_CALL(test_step());
+        ARIADNE_TEST_CALL(test_step_for());
+        ARIADNE_TEST_CALL(test_step_for_resume());
+        ARIADNE_TEST_CALL(test_step_for_outlier());
+        ARIADNE_TEST_CALL(test_parallel_single_thread());
+        ARIADNE_TEST_CALL(test_parallel_deterministic());
+        ARIADNE_TEST_CALL(test_hogwild());
+        ARIADNE_TEST_CALL(test_precision());
+    }
+
+private:
+    const size_t BATCH_SIZE = 2;
+    const RneType::result_type SEED = 1;
+
+    const std::vector<std::vector<NumType>> inputs = {
+        {10.0, 1.0, 10.0, 1.0},
+        {1.0,  3.0, 8.0,  3.0},
+        {8.0,  1.0, 8.0,  1.0},
+        {1.0,  1.5, 8.0,  1.5},
+        {9.0,  1.0, 9.0,  1.0},
+    };
+
+    const std::vector<std::vector<NumType>> targets = {
+        {1.0, 0.0},
+        {0.0, 1.0},
+        {1.0, 0.0},
+        {0.0, 1.0},
+        {1.0, 0.0},
+    };
+
+    void test_step() {
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        GDOptimizer o{NumType{0.1}};
+        Model m = _create_regressor_model(&input_layer, &loss_layer);
+        m.init(SEED);
+
+        Trainer t{m, *loss_layer, o, inputs, targets,
+            BATCH_SIZE};
+
+        // 5 samples in batches of 2: the last batch of the epoch is partial.
+        t.step();
+        ARIADNE_TEST_EQUALS(t.cursor(), 2);
+        t.step();
+        t.step();
+        ARIADNE_TEST_EQUALS(t.epoch(), 1);
+        ARIADNE_TEST_EQUALS(t.batches(), 3);
+        ARIADNE_TEST_EQUALS(t.cursor(), 0);
+    }
+
+    void test_step_for() {
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        GDOptimizer o{NumType{0.1}};
+        Model m = _create_regressor_model(&input_layer, &loss_layer);
+        m.init(SEED);
+
+        Trainer t{m, *loss_layer, o, inputs, targets,
+            BATCH_SIZE};
+
+        // Simulated time: each reading of the clock advances it by 100us, 
+        // so every unit of work is measured as 100us.
+        const auto tick = std::chrono::microseconds{100};
+        Trainer::Clock::time_point time{};
+        t.set_clock([&time, tick]() { return time += tick; });
+
+        // A unit never measured runs to be measured, beyond the budget.
+        ARIADNE_TEST_EQUALS(t.step_for(tick / 2), 0);
+        ARIADNE_TEST_EQUALS(t.cursor(), 1);
+
+        // A budget smaller than a unit runs nothing and halves its estimate,
+        // that fits in the next call: sample 2 and the update never measured.
+        ARIADNE_TEST_EQUALS(t.step_for(tick / 2), 0);
+        ARIADNE_TEST_EQUALS(t.cursor(), 1);
+        ARIADNE_TEST_EQUALS(t.step_for(tick / 2), 1);
+        ARIADNE_TEST_EQUALS(t.cursor(), 2);
+
+        // 10 units fit in 1ms: samples 3 and 4, update, sample 5, update 
+        // at the end of the epoch, samples 1 and 2, update, samples 3 and 4.
+        ARIADNE_TEST_EQUALS(t.step_for(tick * 10), 3);
+        ARIADNE_TEST_EQUALS(t.batches(), 4);
+        ARIADNE_TEST_EQUALS(t.epoch(), 1);
+        ARIADNE_TEST_EQUALS(t.cursor(), 4);
+    }
+
+    void test_step_for_resume() {
+        // Training in slices must give the same parameters as training in
+        // whole mini-batches.
+        DenseLayer* ref_input;
+        MSELossLayer* ref_loss;
+        GDOptimizer ref_o{NumType{0.1}};
+        Model ref = _create_regressor_model(&ref_input, &ref_loss);
+        ref.init(SEED);
+        Trainer ref_t{ref, *ref_loss, ref_o, inputs, targets,
+            BATCH_SIZE};
+
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        GDOptimizer o{NumType{0.1}};
+        Model m = _create_regressor_model(&input_layer, &loss_layer);
+        m.init(SEED);
+        Trainer t{m, *loss_layer, o, inputs, targets,
+            BATCH_SIZE};
+
+        // Slices of two units of 30us of simulated time, cutting the 
+        // mini-batches of two samples and an update in different places.
+        Trainer::Clock::time_point time{};
+        t.set_clock([&time]() 
+        { 
+            return time += std::chrono::microseconds{30}; 
+        });
+        while (t.batches() < 12)
+        {
+            t.step_for(std::chrono::microseconds{80});
+        }
+        // Complete the mini-batch left partially evaluated, if any.
+        t.step();
+        while (ref_t.batches() < t.batches())
+        {
+            ref_t.step();
+        }
+
+        ARIADNE_TEST_EQUALS(t.epoch(), ref_t.epoch());
+        ARIADNE_TEST_EQUALS(t.cursor(), ref_t.cursor());
+        for (size_t i = 0; i < input_layer->param_count(); ++i)
+        {
+            ARIADNE_TEST_EQUAL(*input_layer->param(i), *ref_input->param(i));
+        }
+    }
+
+    void test_step_for_outlier() {
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        GDOptimizer o{NumType{0.1}};
+        Model m = _create_regressor_model(&input_layer, &loss_layer);
+        m.init(SEED);
+
+        Trainer t{m, *loss_layer, o, inputs, targets,
+            BATCH_SIZE};
+
+        // Every unit is measured as 100us, but one that takes 100ms.
+        const auto budget = std::chrono::milliseconds{1};
+        Trainer::Clock::duration tick = std::chrono::microseconds{100};
+        Trainer::Clock::time_point time{};
+        t.set_clock([&time, &tick]() { return time += tick; });
+        for (size_t i = 0; i < 4; ++i)
+        {
+            t.step_for(budget);
+        }
+
+        tick = std::chrono::milliseconds{100};
+        t.step_for(budget);
+        tick = std::chrono::microseconds{100};
+
+        // The estimate of the outlier is above the budget: it is halved by 
+        // the calls that run nothing until the unit runs again and is 
+        // measured back to its cost.
+        size_t const batches = t.batches();
+        size_t empty = 0;
+        for (size_t i = 0; i < 12; ++i)
+        {
+            size_t const cursor = t.cursor();
+            size_t const before = t.batches();
+            t.step_for(budget);
+            if (t.cursor() == cursor && t.batches() == before)
+            {
+                empty++;
+            }
+        }
+        ARIADNE_TEST_PRINT(empty);
+        ARIADNE_TEST_ASSERT(empty > 0 && empty < 8);
+        ARIADNE_TEST_ASSERT(t.batches() > batches + 2);
+
+        // Once recovered, a call runs as many units as before the outlier.
+        ARIADNE_TEST_ASSERT(t.step_for(budget) >= 2);
+    }
+
+    void test_parallel_single_thread() {
+        // One worker has to evaluate exactly as the serial trainer.
+        DenseLayer* ref_input;
+        MSELossLayer* ref_loss;
+        GDOptimizer ref_o{NumType{0.1}};
+        Model ref = _create_regressor_model(&ref_input, &ref_loss);
+        ref.init(SEED);
+        Trainer ref_t{ref, *ref_loss, ref_o, inputs, targets,
+            BATCH_SIZE};
+
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        GDOptimizer o{NumType{0.1}};
+        Model m = _create_regressor_model(&input_layer, &loss_layer);
+        m.init(SEED);
+        ParallelTrainer t{m, *loss_layer, o, inputs, targets,
+            BATCH_SIZE, 1};
+
+        for (size_t i = 0; i < 9; ++i)
+        {
+            t.step();
+            ref_t.step();
+        }
+
+        ARIADNE_TEST_EQUALS(t.epoch(), ref_t.epoch());
+        ARIADNE_TEST_EQUALS(t.cursor(), ref_t.cursor());
+        for (size_t i = 0; i < input_layer->param_count(); ++i)
+        {
+            ARIADNE_TEST_EQUAL(*input_layer->param(i), *ref_input->param(i));
+        }
+    }
+
+    void test_parallel_deterministic() {
+        // Two runs with the same amount of threads are bitwise identical.
+        const size_t THREADS = 3;
+        const size_t PARALLEL_BATCH_SIZE = 4;
+
+        DenseLayer* input_layer1;
+        MSELossLayer* loss_layer1;
+        GDOptimizer o1{NumType{0.1}};
+        Model m1 = _create_regressor_model(&input_layer1, &loss_layer1);
+        m1.init(SEED);
+        ParallelTrainer t1{m1, *loss_layer1, o1, inputs,
+            targets, PARALLEL_BATCH_SIZE, THREADS};
+
+        DenseLayer* input_layer2;
+        MSELossLayer* loss_layer2;
+        GDOptimizer o2{NumType{0.1}};
+        Model m2 = _create_regressor_model(&input_layer2, &loss_layer2);
+        m2.init(SEED);
+        ParallelTrainer t2{m2, *loss_layer2, o2, inputs,
+            targets, PARALLEL_BATCH_SIZE, THREADS};
+
+        for (size_t e = 0; e < 10; ++e)
+        {
+            t1.run_epoch();
+            t2.run_epoch();
+        }
+        ARIADNE_TEST_PRINT(t1.avg_loss());
+        ARIADNE_TEST_EQUAL(t1.avg_loss(), t2.avg_loss());
+        for (size_t i = 0; i < input_layer1->param_count(); ++i)
+        {
+            ARIADNE_TEST_EQUAL(*input_layer1->param(i),
+                *input_layer2->param(i));
+        }
+    }
+
+    void test_hogwild() {
+        DenseLayer* input_layer;
+        MSELossLayer* loss_layer;
+        GDOptimizer o{NumType{0.05}};
+        Model m = _create_regressor_model(&input_layer, &loss_layer);
+        m.init(SEED);
+        ParallelTrainer t{m, *loss_layer, o, inputs, targets,
+            BATCH_SIZE, 2, ParallelMode::Hogwild};
+
+        t.run_epoch();
+        NumType first_loss = t.avg_loss();
+        for (size_t e = 0; e < 50; ++e)
+        {
+            t.run_epoch();
+        }
+        ARIADNE_TEST_EQUALS(t.epoch(), 51);
+        ARIADNE_TEST_PRINT(first_loss);
+        ARIADNE_TEST_PRINT(t.avg_loss());
+        ARIADNE_TEST_ASSERT(t.avg_loss() < first_loss);
+    }
+
+    void test_precision() {
+        // float and double models coexist and learn the same function.
+        auto [f64_begin, f64_end] = _train_regressor<double>();
+        auto f32_end = _train_regressor<float>().second;
+        ARIADNE_TEST_PRINT(f64_end);
+        ARIADNE_TEST_PRINT(f32_end);
+        ARIADNE_TEST_ASSERT(f64_end < 0.01 * f64_begin);
+        ARIADNE_TEST_WITHIN(f32_end, f64_end, 0.001);
+    }
+
+    /**
+     * \brief Train a regressor with a scalar type.
+     * \return std::pair<double, double> Mean squared error of the 
+     * predictions before and after the training.
+     */
+    template <typename T>
+    std::pair<double, double> _train_regressor()
+    {
+        BasicModel<T> m{"regressor"};
+        auto& hidden = m.template add_node<BasicDenseLayer<T>>("hidden",
+            Activation::ReLU, 8, 4);
+        auto& output = m.template add_node<BasicDenseLayer<T>>("output",
+            Activation::Linear, 2, 8);
+        auto& loss = m.template add_node<BasicMSELossLayer<T>>("loss", 2, 
+            BATCH_SIZE, 0.5);
+        m.create_edge(output, hidden);
+        m.create_edge(loss, output);
+        m.init(SEED);
+
+        std::vector<std::vector<T>> x, y;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            x.emplace_back(inputs[i].begin(), inputs[i].end());
+            y.emplace_back(targets[i].begin(), targets[i].end());
+        }
+
+        auto error = [&]()
+        {
+            double sum = 0.0;
+            for (size_t i = 0; i < x.size(); ++i)
+            {
+                T* prediction = m.predict(x[i].data());
+                for (size_t j = 0; j < y[i].size(); ++j)
+                {
+                    sum += std::pow(prediction[j] - y[i][j], 2);
+                }
+            }
+            return sum / static_cast<double>(x.size());
+        };
+
+        double begin = error();
+        BasicGDOptimizer<T> o{T{0.001}};
+        BasicTrainer<T> t{m, loss, o, x, y, BATCH_SIZE};
+        while (t.epoch() < 2000)
+        {
+            t.step();
+        }
+        return {begin, error()};
+    }
+
+    Model _create_regressor_model(DenseLayer** first_layer,
+        MSELossLayer** loss_layer)
+    {
+        Model m{"regressor"};
+        *first_layer = &m.add_node<DenseLayer>("hidden",
+            Activation::ReLU, 8, 4);
+        DenseLayer& output_layer = m.add_node<DenseLayer>("output",
+            Activation::Linear, 2, 8);
+
+        *loss_layer = &m.add_node<MSELossLayer>("loss", 2, BATCH_SIZE, 0.5);
+        m.create_edge(output_layer, **first_layer);
+        m.create_edge(**loss_layer, output_layer);
+        return m;
+    }
+};
+
+int main() {
+    TestTrainer().test();
+    return ARIADNE_TEST_FAILURES;
+}